@@ -0,0 +1,36 @@
+# Writes every file in ASSETS (| separated, relative to SOURCE_DIR) into OUTPUT as a constexpr
+# byte array plus a table to look them up by their relative path.
+# Run in script mode: cmake -DSOURCE_DIR=... -DOUTPUT=... -DASSETS=a|b -P embed.cmake
+
+string(REPLACE "|" ";" ASSETS "${ASSETS}")
+
+# CMake regular expressions have no {n} repetition so the 32 byte pattern is spelled out
+string(REPEAT "0x..," 32 ROW)
+
+set(ARRAYS "")
+set(TABLE "")
+set(INDEX 0)
+foreach(ASSET ${ASSETS})
+   file(READ "${SOURCE_DIR}/${ASSET}" HEX HEX)
+   # Every byte becomes "0x..," with a line break every 32 bytes to keep the file readable
+   string(REGEX REPLACE "([0-9a-f][0-9a-f])" "0x\\1," BYTES "${HEX}")
+   string(REGEX REPLACE "(${ROW})" "\\1\n   " BYTES "${BYTES}")
+   string(LENGTH "${HEX}" SIZE)
+   math(EXPR SIZE "${SIZE} / 2")
+   # Null terminated so text assets can be used as C strings, the size excludes it
+   string(APPEND ARRAYS "// ${ASSET}\nstatic constexpr unsigned char asset${INDEX}[] = {\n   ${BYTES}0x00};\n\n")
+   string(APPEND TABLE "   {\"${ASSET}\", asset${INDEX}, ${SIZE}},\n")
+   math(EXPR INDEX "${INDEX} + 1")
+endforeach()
+
+set(CONTENT "// Generated by cmake/embed.cmake, do not edit\n#include \"utils/assets.hpp\"\n\n${ARRAYS}")
+string(APPEND CONTENT "const embeddedAsset embeddedAssets[] = {\n${TABLE}};\n\n")
+string(APPEND CONTENT "const std::size_t embeddedAssetCount = ${INDEX};\n")
+
+# Only touch the output when something changed so the game is not recompiled for nothing
+if(EXISTS "${OUTPUT}")
+   file(READ "${OUTPUT}" OLD)
+endif()
+if(NOT "${OLD}" STREQUAL "${CONTENT}")
+   file(WRITE "${OUTPUT}" "${CONTENT}")
+endif()
@@ -1,4 +1,5 @@
 #include "gl.hpp"
+#include "utils/assets.hpp"
 
 #include <glad/glad.h>
 #include <GL/gl.h>
@@ -7,6 +8,8 @@
 #include <math.h>
 #include <string>
 #include <fstream>
+#include <algorithm>
+#include <sstream>
 
 GLFWwindow* gl_initWindow(){
    // Start up GLFW
@@ -38,87 +41,88 @@ GLFWwindow* gl_initWindow(){
    return window;
 }
 
-GLuint gl_createVertShader(std::string filename){
-   // ------------------------------ CREATE VERTEX SHADER -------------------------------
-   // Work around string vertex shader that just adds a 4th value to the vertex
-   std::string vertexSource = readShaderFile(filename).c_str();
-   const char *vertexShaderSource = vertexSource.c_str();
-
-   // Create a shder object for the vertex shader
-   GLuint vertexShader;
-   vertexShader = glCreateShader(GL_VERTEX_SHADER);
-   // This attatches the shader string to the shader, 2nd parameter is how many strings
-   glShaderSource(vertexShader, 1, &vertexShaderSource, NULL);
-   glCompileShader(vertexShader);
-
-   // Check if the compilation of the shader was successfull
-   int  success;
-   char infoLog[512];
-   glGetShaderiv(vertexShader, GL_COMPILE_STATUS, &success);
-   // If the compilation was not successful then retrieve the error message
-   if(!success){
-      glGetShaderInfoLog(vertexShader, 512, NULL, infoLog);
-      std::cout << filename << "--- Failed Compilation ---" << infoLog <<  std::endl;
-   }
+// Resize the viewport on window resize during the pollEvents
+void framebuffer_size_callback(GLFWwindow* window, int width, int height){
+   glViewport(0, 0, width, height);
+} 
+
 
-   return vertexShader;
+// Get keyboard inputs
+void processInput(GLFWwindow *window){
+   if(glfwGetKey(window, GLFW_KEY_ESCAPE) == GLFW_PRESS) glfwSetWindowShouldClose(window, true);
 }
 
 
+// Function to get the source of shader files (embedded in the executable unless GL_ASSET_DIR is set)
+std::string readShaderFile(const std::string& filePath) {
+   return readAsset(filePath);
+}
 
 
-GLuint gl_createFragShader(std::string filename){
-   // ------------------------------ CREATE FRAGMENT SHADER -------------------------------
-   // Work around string vertex shader that just adds a 4th value to the vertex
-   std::string fragmentSource = readShaderFile(filename).c_str();
-   const char *fragmentShaderSource = fragmentSource.c_str();
-   // Create a shder object for the vertex shader
-   GLuint fragmentShader = glCreateShader(GL_FRAGMENT_SHADER);
-   // This attatches the shader string to the shader, 2nd parameter is how many strings
-   glShaderSource(fragmentShader, 1, &fragmentShaderSource, NULL);
-   glCompileShader(fragmentShader);
+// Recursive part of gl_preprocessShader. Every file gets its own source string number (its
+// index in files) so compile errors inside an included file point at the right line
+static void preprocessFile(const std::string& filePath, std::string& out, std::vector<std::string>& files, const std::vector<std::string>& defines){
+   unsigned int fileIndex = files.size();
+   files.push_back(filePath);
 
-   int  success;
-   char infoLog[512];
+   std::string directory = filePath.substr(0, filePath.find_last_of('/') + 1);
+   std::stringstream source(readShaderFile(filePath));
 
-   // Check if the compilation of the shader was successfull
-   glGetShaderiv(fragmentShader, GL_COMPILE_STATUS, &success);
-   // If the compilation was not successful then retrieve the error message
-   if(!success){
-      glGetShaderInfoLog(fragmentShader, 512, NULL, infoLog);
-      std::cout << filename << "--- Failed Compilation ---" << infoLog <<  std::endl;
+   std::string line;
+   unsigned int lineNumber = 0;
+   while (std::getline(source, line)) {
+      lineNumber++;
+      std::size_t start = line.find_first_not_of(" \t");
+      std::string directive = start == std::string::npos ? "" : line.substr(start);
+
+      // The defines have to come right after #version, which must stay the first line
+      if (directive.compare(0, 8, "#version") == 0) {
+         out += line + '\n';
+         for (const std::string& define : defines) out += "#define " + define + '\n';
+         out += "#line " + std::to_string(lineNumber + 1) + " " + std::to_string(fileIndex) + '\n';
+         continue;
+      }
+
+      if (directive.compare(0, 8, "#include") == 0) {
+         std::size_t open = directive.find('"');
+         std::size_t close = directive.find('"', open + 1);
+         if (open == std::string::npos || close == std::string::npos) {
+            std::cerr << filePath << ":" << lineNumber << " malformed #include" << std::endl;
+            continue;
+         }
+         std::string include = directory + directive.substr(open + 1, close - open - 1);
+         // Every file is only included once, like #pragma once, which also stops include loops
+         if (std::find(files.begin(), files.end(), include) != files.end()) continue;
+
+         out += "#line 1 " + std::to_string(files.size()) + '\n';
+         preprocessFile(include, out, files, defines);
+         out += "#line " + std::to_string(lineNumber + 1) + " " + std::to_string(fileIndex) + '\n';
+         continue;
+      }
+
+      out += line + '\n';
    }
-   return fragmentShader;
 }
 
 
-
-// Resize the viewport on window resize during the pollEvents
-void framebuffer_size_callback(GLFWwindow* window, int width, int height){
-   glViewport(0, 0, width, height);
-} 
+std::string gl_preprocessShader(const std::string& filePath, const std::vector<std::string>& defines, std::vector<std::string>* files){
+   std::string out;
+   std::vector<std::string> included;
+   preprocessFile(filePath, out, included, defines);
+   if (files) *files = included;
+   return out;
+}
 
 
-// Get keyboard inputs
-void processInput(GLFWwindow *window){
-   if(glfwGetKey(window, GLFW_KEY_ESCAPE) == GLFW_PRESS) glfwSetWindowShouldClose(window, true);
+// mat3x4 is stored by rows, with transpose set it is exactly a GLSL mat4x3 (4 columns of 3 rows)
+void gl_uploadMatrices(gl_programBuilder& programs, unsigned int program, const sceneGraph& scene, unsigned int node){
+   glUniformMatrix4fv(programs.uniform(program, "mvp"), 1, GL_FALSE, &scene.mvp(node).m[0][0]);
+   glUniformMatrix4x3fv(programs.uniform(program, "modelView"), 1, GL_TRUE, &scene.modelView(node).m[0][0]);
+   glUniformMatrix4x3fv(programs.uniform(program, "normalMatrix"), 1, GL_TRUE, &scene.normalMatrix(node).m[0][0]);
 }
 
 
-// Function to parse shader files
-std::string readShaderFile(const std::string& filePath) {
-   // Input file stream
-   std::ifstream shaderFile(filePath);
-   if (!shaderFile.is_open()) {
-      std::cerr << "Could not open shader file: " << filePath << std::endl;
-      return "";
-   }
-   // Copy all lines into "shaderCode" as one long string
-   std::string line;
-   std::string shaderCode;
-   while (std::getline(shaderFile, line)) {
-      shaderCode += line + '\n';
-   }
-   shaderFile.close();
-   return shaderCode;
+void gl_uploadCamera(gl_programBuilder& programs, unsigned int program, const sceneGraph& scene){
+   glUniformMatrix4x3fv(programs.uniform(program, "view"), 1, GL_TRUE, &scene.view().m[0][0]);
+   glUniformMatrix4fv(programs.uniform(program, "viewProject"), 1, GL_FALSE, &scene.viewProject().m[0][0]);
 }
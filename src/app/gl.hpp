@@ -7,6 +7,9 @@
 #include <math.h>
 #include <string>
 #include <fstream>
+#include <vector>
+#include "glProgram.hpp"
+#include "utils/scene.hpp"
 
 
 GLFWwindow* gl_initWindow();
@@ -17,6 +20,27 @@ void processInput(GLFWwindow *window);
 
 std::string readShaderFile(const std::string& filePath);
 
-GLuint gl_createVertShader(std::string filename);
-
-GLuint gl_createFragShader(std::string filename);
+/// @brief: Reads a shader file and resolves its #include "file" directives (relative to the
+/// including file, each file included once). The defines are inserted right after #version so
+/// one file can be compiled into several permutations
+/// @param filePath: Shader file
+/// @param defines: Macros to define, "NAME" or "NAME VALUE"
+/// @param files: Optional output of every file that went into the source (for hot reload)
+/// @return: Complete shader source
+std::string gl_preprocessShader(const std::string& filePath, const std::vector<std::string>& defines = {}, std::vector<std::string>* files = nullptr);
+
+/// @brief: Uploads the matrices of one draw, all composed on the CPU by the scene graph so the
+/// vertex shader does a single multiply for the position, view space position and normal.
+/// Sets the mvp, modelView and normalMatrix uniforms (missing ones are skipped)
+/// @param programs: Builder the program comes from (for the cached uniform locations)
+/// @param program: Handle of the program, must be in use
+/// @param scene: Scene graph after update
+/// @param node: Node that is drawn
+void gl_uploadMatrices(gl_programBuilder& programs, unsigned int program, const sceneGraph& scene, unsigned int node);
+
+/// @brief: Uploads the view and viewProject uniforms for programs that combine them with a per
+/// instance model matrix (the INSTANCED permutation of vertex.glsl)
+/// @param programs: Builder the program comes from
+/// @param program: Handle of the program, must be in use
+/// @param scene: Scene graph with the camera
+void gl_uploadCamera(gl_programBuilder& programs, unsigned int program, const sceneGraph& scene);
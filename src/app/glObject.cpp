@@ -1,9 +1,11 @@
 #include "glObject.hpp"
 
 #include "utils/matrix.hpp"
+#include "utils/assets.hpp"
 #include <iostream>
 #include <fstream>
 #include <sstream>
+#include <utility>
 
 gl_vao::gl_vao(){
    // This is the VAO that is used to bind the VBO
@@ -18,10 +20,10 @@ unsigned int gl_vao::createVBO (std::vector<GLfloat> _vertices){
 
    gl_object newObject;
    newObject.vbo = vbo;
-   newObject.vertices = _vertices;
+   newObject.vertices = std::move(_vertices);
 
    unsigned int index = objects.size();
-   objects.push_back(newObject);
+   objects.push_back(std::move(newObject));
 
    return index;
 }
@@ -40,11 +42,11 @@ unsigned int gl_vao::createVBO (std::vector<GLfloat> _vertices, std::vector<GLin
    newObject.vbo = vbo;
    newObject.ebo = ebo;
    newObject.isEbo = true;
-   newObject.vertices = _vertices;
-   newObject.indices = _indices;
+   newObject.vertices = std::move(_vertices);
+   newObject.indices = std::move(_indices);
 
    unsigned int index = objects.size();
-   objects.push_back(newObject);
+   objects.push_back(std::move(newObject));
 
    return index;
 }
@@ -121,8 +123,8 @@ unsigned int gl_vao::load(std::string filename) {
    //    newObject.vertices.push_back(0);
    // }
 
-   // Try to open the file
-   std::ifstream obj(filename);
+   // Get the file (embedded in the executable unless GL_ASSET_DIR is set)
+   std::istringstream obj(readAsset(filename));
 
    // Create an array to hold the chars of each line
    // cycle through all the lines in the file until we are at the end
@@ -196,12 +198,22 @@ unsigned int gl_vao::load(std::string filename) {
 
 
    unsigned int index = objects.size();
-   objects.push_back(newObject);
+   objects.push_back(std::move(newObject));
 
    return index;
 }
 
 
+unsigned int gl_vao::load(planetMesh&& mesh) {
+
+   // The generator already wrote the layout gl_object uses, the vectors are moved instead of copied
+   unsigned int index = createVBO(std::move(mesh.vertices), std::move(mesh.indices));
+   addAttribute(index, 0, 3, GL_FLOAT, GL_FALSE, planetMesh::stride * sizeof(GLfloat), (void*)0);
+   addAttribute(index, 2, 3, GL_FLOAT, GL_FALSE, planetMesh::stride * sizeof(GLfloat), (void*)(3 * sizeof(GLfloat)));
+   return index;
+}
+
+
 void gl_vao::bind(){
    glBindVertexArray(vao);
 }
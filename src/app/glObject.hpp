@@ -1,6 +1,7 @@
 #pragma once
 
 #include "utils/matrix.hpp"
+#include "utils/planet.hpp"
 #include <cstddef>
 #include <glad/glad.h>
 #include <GL/gl.h>
@@ -21,6 +22,8 @@ public:
    unsigned int createVBO (std::vector<GLfloat>, std::vector<GLint>);
 
    unsigned int load (std::string filename);
+   // Takes over the buffers of a generated planet, positions at location 0 and normals at 2
+   unsigned int load (planetMesh&& mesh);
 
    void addAttribute(unsigned int object, unsigned int id, unsigned int count, int type, int normalized, std::size_t stride, void* offset);
 
@@ -0,0 +1,320 @@
+#include "glProgram.hpp"
+#include "gl.hpp"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <sys/stat.h>
+
+// GL_KHR_parallel_shader_compile is not part of the generated glad loader
+#ifndef GL_COMPLETION_STATUS_KHR
+#define GL_COMPLETION_STATUS_KHR 0x91B1
+#endif
+typedef void (APIENTRYP PFNGLMAXSHADERCOMPILERTHREADSKHRPROC)(GLuint count);
+
+
+// Header written in front of every cached binary
+struct cacheHeader {
+   char magic[4];
+   std::uint32_t format;
+   std::uint64_t key;
+   std::uint32_t driverLength;
+   std::uint32_t binaryLength;
+};
+
+
+// 64 bit FNV-1a hash, continued from the given hash so several strings can be chained
+static std::uint64_t fnv1a(const std::string& s, std::uint64_t hash = 0xcbf29ce484222325ull){
+   for (unsigned char c : s){
+      hash ^= c;
+      hash *= 0x100000001b3ull;
+   }
+   return hash;
+}
+
+
+gl_programCache::gl_programCache(std::string _directory) : directory(_directory) {
+
+   const char* env = std::getenv("GL_PROGRAM_CACHE");
+   if (env && std::strcmp(env, "0") == 0) enabled = false;
+
+   // Binaries are only valid for the exact driver that created them
+   const char* vendor = (const char*)glGetString(GL_VENDOR);
+   const char* renderer = (const char*)glGetString(GL_RENDERER);
+   const char* version = (const char*)glGetString(GL_VERSION);
+   driver = std::string(vendor ? vendor : "") + '\n' + (renderer ? renderer : "") + '\n' + (version ? version : "");
+
+   // Without any supported binary format there is nothing to cache
+   GLint formats = 0;
+   glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS, &formats);
+   if (formats == 0) enabled = false;
+}
+
+
+std::uint64_t gl_programCache::key(const std::vector<std::string>& sources){
+   std::uint64_t hash = fnv1a(driver);
+   for (const std::string& source : sources){
+      // Hash the length as well so moving text between two shaders changes the key
+      hash = fnv1a(std::to_string(source.size()), hash);
+      hash = fnv1a(source, hash);
+   }
+   return hash;
+}
+
+
+std::string gl_programCache::path(std::uint64_t key){
+   char name[17];
+   std::snprintf(name, sizeof(name), "%016llx", (unsigned long long)key);
+   return directory + "/" + name + ".bin";
+}
+
+
+GLuint gl_programCache::load(const std::vector<std::string>& sources){
+   if (!enabled) return 0;
+
+   std::uint64_t k = key(sources);
+   std::ifstream file(path(k), std::ios::binary);
+   if (!file.is_open()) { misses++; return 0; }
+
+   // Reject anything that does not match the current sources and driver exactly
+   cacheHeader header;
+   file.read((char*)&header, sizeof(header));
+   if (!file || std::memcmp(header.magic, "GLPB", 4) != 0 || header.key != k || header.driverLength != driver.size()){
+      misses++;
+      return 0;
+   }
+   std::string cachedDriver(header.driverLength, '\0');
+   file.read(&cachedDriver[0], header.driverLength);
+   std::vector<char> binary(header.binaryLength);
+   file.read(binary.data(), header.binaryLength);
+   if (!file || cachedDriver != driver){
+      misses++;
+      return 0;
+   }
+
+   GLuint program = glCreateProgram();
+   glProgramBinary(program, header.format, binary.data(), header.binaryLength);
+
+   // The driver can still refuse the binary (eg. it was built by a different GPU), compile instead
+   int success;
+   glGetProgramiv(program, GL_LINK_STATUS, &success);
+   if (!success){
+      glDeleteProgram(program);
+      misses++;
+      return 0;
+   }
+   hits++;
+   return program;
+}
+
+
+void gl_programCache::store(const std::vector<std::string>& sources, GLuint program){
+   if (!enabled) return;
+
+   GLint length = 0;
+   glGetProgramiv(program, GL_PROGRAM_BINARY_LENGTH, &length);
+   if (length <= 0) return;
+
+   std::vector<char> binary(length);
+   GLenum format;
+   glGetProgramBinary(program, length, &length, &format, binary.data());
+
+   mkdir(directory.c_str(), 0755);
+   std::uint64_t k = key(sources);
+   std::ofstream file(path(k), std::ios::binary | std::ios::trunc);
+   if (!file.is_open()){
+      std::cerr << "Could not write program cache: " << path(k) << std::endl;
+      return;
+   }
+
+   cacheHeader header;
+   std::memcpy(header.magic, "GLPB", 4);
+   header.format = format;
+   header.key = k;
+   header.driverLength = driver.size();
+   header.binaryLength = length;
+   file.write((const char*)&header, sizeof(header));
+   file.write(driver.data(), driver.size());
+   file.write(binary.data(), length);
+}
+
+
+
+// The stage types are part of the cache key too, the same file could be used as two stages
+static std::vector<std::string> cacheKey(const std::vector<std::string>& sources, const std::vector<gl_shaderStage>& stages){
+   std::vector<std::string> key = sources;
+   for (const gl_shaderStage& stage : stages) key.push_back(std::to_string(stage.type));
+   return key;
+}
+
+
+gl_programBuilder::gl_programBuilder(gl_programCache& _cache) : cache(_cache) {
+
+   if (glfwExtensionSupported("GL_KHR_parallel_shader_compile")){
+      PFNGLMAXSHADERCOMPILERTHREADSKHRPROC glMaxShaderCompilerThreadsKHR =
+         (PFNGLMAXSHADERCOMPILERTHREADSKHRPROC)glfwGetProcAddress("glMaxShaderCompilerThreadsKHR");
+      // 0xFFFFFFFF lets the driver pick as many threads as it wants
+      if (glMaxShaderCompilerThreadsKHR) glMaxShaderCompilerThreadsKHR(0xFFFFFFFF);
+      parallel = true;
+   }
+}
+
+
+GLuint gl_programBuilder::compile(GLenum type, const std::string& source){
+   const char* src = source.c_str();
+   GLuint shader = glCreateShader(type);
+   glShaderSource(shader, 1, &src, NULL);
+   // The status is not checked here, that would force the driver to finish the compile right away
+   glCompileShader(shader);
+   return shader;
+}
+
+
+void gl_programBuilder::start(entry& e){
+   build& b = e.pending;
+   e.building = true;
+   e.files.clear();
+   for (const gl_shaderStage& stage : e.stages){
+      std::vector<std::string> files;
+      b.sources.push_back(gl_preprocessShader(stage.file, e.defines, &files));
+      e.files.insert(e.files.end(), files.begin(), files.end());
+   }
+
+   b.program = cache.load(cacheKey(b.sources, e.stages));
+   if (b.program) return;
+
+   b.program = glCreateProgram();
+   for (unsigned int i = 0; i < e.stages.size(); i++){
+      GLuint shader = compile(e.stages[i].type, b.sources[i]);
+      glAttachShader(b.program, shader);
+      b.shaders.push_back(shader);
+   }
+   // Ask the driver to keep the binary around so it can be written to the cache
+   glProgramParameteri(b.program, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);
+   glLinkProgram(b.program);
+}
+
+
+unsigned int gl_programBuilder::add(const std::vector<gl_shaderStage>& stages, std::vector<std::string> defines){
+   std::sort(defines.begin(), defines.end());
+
+   std::string key;
+   for (const gl_shaderStage& stage : stages) key += std::to_string(stage.type) + ":" + stage.file + ";";
+   for (const std::string& define : defines) key += "#" + define;
+
+   auto it = permutations.find(key);
+   if (it != permutations.end()) return it->second;
+
+   entry e;
+   e.stages = stages;
+   e.defines = defines;
+   e.name = key;
+   start(e);
+
+   programs.push_back(e);
+   permutations[key] = programs.size() - 1;
+   return programs.size() - 1;
+}
+
+
+void gl_programBuilder::reload(const std::string& file){
+   for (entry& e : programs){
+      if (std::find(e.files.begin(), e.files.end(), file) == e.files.end()) continue;
+
+      // A newer edit replaces a build that is still in flight
+      if (e.building) discard(e.pending);
+      std::cout << "Reloading " << e.name << std::endl;
+      start(e);
+   }
+}
+
+
+bool gl_programBuilder::update(){
+   bool swapped = false;
+   for (unsigned int i = 0; i < programs.size(); i++){
+      entry& e = programs[i];
+      // First builds are finished by get, only replacements are swapped in here
+      if (!e.building || !e.program || !ready(i)) continue;
+      GLuint old = e.program;
+      finish(e);
+      swapped |= e.program != old;
+   }
+   return swapped;
+}
+
+
+bool gl_programBuilder::ready(unsigned int handle){
+   entry& e = programs[handle];
+   if (!e.building || !parallel || e.pending.shaders.empty()) return true;
+
+   int done;
+   glGetProgramiv(e.pending.program, GL_COMPLETION_STATUS_KHR, &done);
+   return done;
+}
+
+
+GLuint gl_programBuilder::get(unsigned int handle){
+   entry& e = programs[handle];
+   if (!e.program && e.building) finish(e);
+   return e.program;
+}
+
+
+GLint gl_programBuilder::uniform(unsigned int handle, const std::string& name){
+   entry& e = programs[handle];
+   auto it = e.uniforms.find(name);
+   if (it != e.uniforms.end()) return it->second;
+
+   GLint location = glGetUniformLocation(get(handle), name.c_str());
+   e.uniforms[name] = location;
+   return location;
+}
+
+
+void gl_programBuilder::finish(entry& e){
+   build& b = e.pending;
+   e.building = false;
+
+   int  success;
+   char infoLog[512];
+   // The link status of a program covers its shaders, only look at them when something failed
+   glGetProgramiv(b.program, GL_LINK_STATUS, &success);
+   if(!success) {
+      for (GLuint shader : b.shaders){
+         glGetShaderiv(shader, GL_COMPILE_STATUS, &success);
+         if (!success){
+            glGetShaderInfoLog(shader, 512, NULL, infoLog);
+            std::cout << e.name << " --- Failed Compilation ---" << infoLog << std::endl;
+         }
+      }
+      glGetProgramInfoLog(b.program, 512, NULL, infoLog);
+      std::cout << e.name << " --- Failed Linking ---" << infoLog << std::endl;
+
+      // Keep drawing with the last working program, a broken first build is still returned
+      // so the error shows up the same way it always has
+      if (e.program){
+         discard(b);
+         return;
+      }
+   }
+   else if (!b.shaders.empty()) cache.store(cacheKey(b.sources, e.stages), b.program);
+
+   // Swap in the new program, locations can change between builds so they are looked up again
+   if (e.program) glDeleteProgram(e.program);
+   e.program = b.program;
+   e.uniforms.clear();
+
+   // After the shaders are linked in the program we no longer need them
+   b.program = 0;
+   discard(b);
+}
+
+
+void gl_programBuilder::discard(build& b){
+   if (b.program) glDeleteProgram(b.program);
+   for (GLuint shader : b.shaders) glDeleteShader(shader);
+   b = build();
+}
@@ -0,0 +1,136 @@
+#pragma once
+
+#include <glad/glad.h>
+#include <GL/gl.h>
+#include <GLFW/glfw3.h>
+#include <cstdint>
+#include <map>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+
+/// @brief: On disk cache of linked shader program binaries (glGetProgramBinary).
+/// Entries are keyed by a hash of the shader sources and the driver vendor/renderer/version
+/// strings so a driver update or an edited shader simply misses and falls back to compiling.
+/// The cache can be turned off by setting the environment variable GL_PROGRAM_CACHE=0
+/// which is useful to measure the startup time without it.
+/// @param directory: Folder the binaries are stored in, created on the first store (Default: "shader_cache")
+class gl_programCache {
+
+public:
+
+   gl_programCache(std::string directory = "shader_cache");
+
+   /// @brief: Try to create a program from a cached binary
+   /// @param sources: Every shader source that goes into the program (in attach order)
+   /// @return: Linked program or 0 if there was no usable binary
+   GLuint load(const std::vector<std::string>& sources);
+
+   /// @brief: Save the binary of a linked program. The program must have been linked with
+   /// GL_PROGRAM_BINARY_RETRIEVABLE_HINT set for some drivers to return a binary
+   /// @param sources: Same sources that were passed to load
+   /// @param program: Successfully linked program
+   void store(const std::vector<std::string>& sources, GLuint program);
+
+   bool enabled = true;
+
+   unsigned int hits = 0;
+   unsigned int misses = 0;
+
+private:
+
+   std::uint64_t key(const std::vector<std::string>& sources);
+   std::string path(std::uint64_t key);
+
+   std::string directory;
+   // Vendor, renderer and version strings of the current context
+   std::string driver;
+};
+
+
+/// @brief: One shader file of a program and the stage it is compiled as
+/// @param type: GL_VERTEX_SHADER, GL_FRAGMENT_SHADER, GL_COMPUTE_SHADER ...
+/// @param file: Path to the shader, #include is resolved by gl_preprocessShader
+struct gl_shaderStage {
+   GLenum type;
+   std::string file;
+};
+
+
+/// @brief: Issues shader compiles and program links up front without waiting for them.
+/// The compile and link status is only queried when a program is first needed, so the driver
+/// can compile in the background (GL_KHR_parallel_shader_compile) while assets are loading.
+/// Programs found in the cache are ready immediately.
+/// @param cache: Program binary cache to load from and store to
+class gl_programBuilder {
+
+public:
+
+   gl_programBuilder(gl_programCache& cache);
+
+   /// @brief: Starts building a program from any set of stages (a single GL_COMPUTE_SHADER
+   /// stage makes a compute program). Asking for the same stages and defines again returns the
+   /// existing handle, so permutations can be requested lazily wherever they are first needed
+   /// @param stages: Shader files and their stage
+   /// @param defines: Macros for this permutation, "NAME" or "NAME VALUE" (order does not matter)
+   /// @return: Handle used with ready and get
+   unsigned int add(const std::vector<gl_shaderStage>& stages, std::vector<std::string> defines = {});
+
+   /// @brief: Starts rebuilding every program that uses the given shader file (directly or
+   /// through #include). The current
+   /// program stays in use until the new one is swapped in by update
+   void reload(const std::string& file);
+
+   /// @brief: Swaps in rebuilt programs that have finished compiling. Call between frames.
+   /// A build that fails is reported and the previous program is kept
+   /// @return: True if any program changed
+   bool update();
+
+   /// @brief: Checks without blocking whether a program has finished compiling and linking.
+   /// Always true when the driver does not support GL_KHR_parallel_shader_compile
+   bool ready(unsigned int handle);
+
+   /// @brief: Returns the linked program, waiting for the driver if it is still compiling.
+   /// Errors are reported the first time a program is requested
+   GLuint get(unsigned int handle);
+
+   /// @brief: Location of a uniform in the current program. Locations are cached per program
+   /// and looked up again after a reload swaps the program
+   GLint uniform(unsigned int handle, const std::string& name);
+
+   // True if the driver compiles on its own threads
+   bool parallel = false;
+
+private:
+
+   // A program that is still being compiled and linked
+   struct build {
+      GLuint program = 0;
+      std::vector<GLuint> shaders;
+      std::vector<std::string> sources;
+   };
+
+   struct entry {
+      std::string name;
+      std::vector<gl_shaderStage> stages;
+      std::vector<std::string> defines;
+      // Every file the sources were made from, including the #include files
+      std::vector<std::string> files;
+      // Program currently in use
+      GLuint program = 0;
+      bool building = false;
+      build pending;
+      std::unordered_map<std::string, GLint> uniforms;
+   };
+
+   GLuint compile(GLenum type, const std::string& source);
+   void start(entry& e);
+   void finish(entry& e);
+   void discard(build& b);
+
+   gl_programCache& cache;
+   std::vector<entry> programs;
+   // Handle of every stage and define combination that was added
+   std::map<std::string, unsigned int> permutations;
+};
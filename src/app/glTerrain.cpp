@@ -0,0 +1,153 @@
+#include "glTerrain.hpp"
+
+#include <algorithm>
+#include <iostream>
+#include <limits>
+#include <string>
+
+
+gl_terrain::gl_terrain(terrainTree& _tree, gl_programBuilder* _programs) : tree(_tree), programs(_programs) {
+
+   chunkVertices = tree.vertexCount();
+   glGenVertexArrays(1, &vao);
+   glGenBuffers(1, &vbo);
+   glGenBuffers(1, &ebo);
+   glBindVertexArray(vao);
+
+   // Room for every chunk the tree can hold, filled slot by slot as chunks finish
+   glBindBuffer(GL_ARRAY_BUFFER, vbo);
+   glBufferData(GL_ARRAY_BUFFER, tree.capacity() * chunkVertices * 6 * sizeof(GLfloat), nullptr, GL_DYNAMIC_DRAW);
+   glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 6 * sizeof(GLfloat), (void*)0);
+   glEnableVertexAttribArray(0);
+   glVertexAttribPointer(2, 3, GL_FLOAT, GL_FALSE, 6 * sizeof(GLfloat), (void*)(3 * sizeof(GLfloat)));
+   glEnableVertexAttribArray(2);
+
+   // Every chunk has the same grid and skirts, the base vertex of the draw picks the slot
+   glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, ebo);
+   glBufferData(GL_ELEMENT_ARRAY_BUFFER, tree.indices().size() * sizeof(GLint), tree.indices().data(), GL_STATIC_DRAW);
+   glBindVertexArray(0);
+
+   // The compute programs write the chunks straight into the vertex buffer, through a scratch
+   // buffer of samples with one more row and column all around each chunk
+   if (!tree.parameters().vertices){
+      if (!programs) std::cerr << "gl_terrain: the tree leaves the vertices to the GPU but there is no program builder" << std::endl;
+      else {
+         std::string size = "TERRAIN_BATCH " + std::to_string(batch);
+         heightsProgram = programs->add({{GL_COMPUTE_SHADER, "src/shaders/terrainCompute.glsl"}}, {"HEIGHTS", size});
+         verticesProgram = programs->add({{GL_COMPUTE_SHADER, "src/shaders/terrainCompute.glsl"}}, {size});
+         std::size_t side = tree.parameters().resolution + 3;
+         glGenBuffers(1, &samples);
+         glBindBuffer(GL_SHADER_STORAGE_BUFFER, samples);
+         glBufferData(GL_SHADER_STORAGE_BUFFER, batch * side * side * 4 * sizeof(GLfloat), nullptr, GL_DYNAMIC_COPY);
+      }
+   }
+
+   for (std::size_t slot = tree.capacity(); slot > 0; slot--) freeSlots.push_back(GLint(slot - 1));
+   update(std::numeric_limits<std::size_t>::max());
+}
+
+
+gl_terrain::~gl_terrain(){
+   glDeleteBuffers(1, &vbo);
+   glDeleteBuffers(1, &ebo);
+   if (samples) glDeleteBuffers(1, &samples);
+   glDeleteVertexArrays(1, &vao);
+}
+
+
+std::size_t gl_terrain::update(std::size_t uploads){
+   tree.collect(uploads, finished, evicted);
+   for (std::uint64_t key : evicted){
+      auto it = slots.find(key);
+      freeSlots.push_back(it->second);
+      slots.erase(it);
+   }
+   if (finished.empty()) return 0;
+
+   // The tree never holds more chunks than there are slots
+   glBindBuffer(GL_ARRAY_BUFFER, vbo);
+   const std::size_t bytes = chunkVertices * 6 * sizeof(GLfloat);
+   std::vector<const terrainChunk*> compute;
+   for (const terrainChunk& chunk : finished){
+      GLint slot = freeSlots.back();
+      freeSlots.pop_back();
+      slots[chunk.key] = slot;
+      if (chunk.vertices.empty()) compute.push_back(&chunk);
+      else glBufferSubData(GL_ARRAY_BUFFER, slot * bytes, bytes, chunk.vertices.data());
+   }
+   if (compute.empty() || !samples) return finished.size();
+
+   for (std::size_t first = 0; first < compute.size(); first += batch)
+      dispatch(std::vector<const terrainChunk*>(compute.begin() + first, compute.begin() + std::min(compute.size(), first + batch)));
+   // The draws read the new vertices as vertex attributes
+   glMemoryBarrier(GL_VERTEX_ATTRIB_ARRAY_BARRIER_BIT);
+   return finished.size();
+}
+
+
+void gl_terrain::dispatch(const std::vector<const terrainChunk*>& chunks){
+   const terrainSettings& settings = tree.parameters();
+   const int side = settings.resolution + 3;
+   GLfloat corners[batch * 4];
+   GLint chunkSlots[batch];
+   for (std::size_t c = 0; c < chunks.size(); c++){
+      std::uint64_t key = chunks[c]->key;
+      float size = 2.0f / float(1u << terrainTree::level(key));
+      corners[c * 4] = float(terrainTree::face(key));
+      corners[c * 4 + 1] = -1.0f + float(terrainTree::x(key)) * size;
+      corners[c * 4 + 2] = -1.0f + float(terrainTree::y(key)) * size;
+      corners[c * 4 + 3] = size;
+      chunkSlots[c] = slots[key];
+   }
+
+   glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 0, samples);
+   glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 1, vbo);
+   for (unsigned int program : {heightsProgram, verticesProgram}){
+      glUseProgram(programs->get(program));
+      glUniform1i(programs->uniform(program, "terrain.type"), settings.terrain.type);
+      glUniform1i(programs->uniform(program, "terrain.fractal"), settings.terrain.fractal);
+      glUniform1i(programs->uniform(program, "terrain.octaves"), settings.terrain.octaves);
+      glUniform1f(programs->uniform(program, "terrain.frequency"), settings.terrain.frequency);
+      glUniform1f(programs->uniform(program, "terrain.lacunarity"), settings.terrain.lacunarity);
+      glUniform1f(programs->uniform(program, "terrain.gain"), settings.terrain.gain);
+      glUniform1f(programs->uniform(program, "terrain.warp"), settings.terrain.warp);
+      glUniform1ui(programs->uniform(program, "terrain.seed"), settings.terrain.seed);
+      glUniform1i(programs->uniform(program, "resolution"), settings.resolution);
+      glUniform1f(programs->uniform(program, "radius"), settings.radius);
+      glUniform1f(programs->uniform(program, "amplitude"), settings.amplitude);
+      glUniform1f(programs->uniform(program, "skirt"), settings.skirt);
+      glUniform4fv(programs->uniform(program, "chunks"), GLsizei(chunks.size()), corners);
+      glUniform1iv(programs->uniform(program, "slots"), GLsizei(chunks.size()), chunkSlots);
+      glUniform1i(programs->uniform(program, "count"), GLint(chunks.size()));
+
+      if (program == heightsProgram) glDispatchCompute((side + 7) / 8, (side + 7) / 8, GLuint(chunks.size()));
+      else glDispatchCompute(GLuint((chunkVertices + 63) / 64), 1, GLuint(chunks.size()));
+      // The second pass reads the samples of the first, the next batch writes over them
+      glMemoryBarrier(GL_SHADER_STORAGE_BARRIER_BIT);
+   }
+}
+
+
+std::vector<float> gl_terrain::readBack(std::uint64_t key){
+   std::vector<float> vertices(chunkVertices * 6);
+   auto it = slots.find(key);
+   if (it == slots.end()) return {};
+   glMemoryBarrier(GL_BUFFER_UPDATE_BARRIER_BIT);
+   glBindBuffer(GL_ARRAY_BUFFER, vbo);
+   glGetBufferSubData(GL_ARRAY_BUFFER, it->second * vertices.size() * sizeof(GLfloat), vertices.size() * sizeof(GLfloat), vertices.data());
+   return vertices;
+}
+
+
+void gl_terrain::draw(){
+   const std::vector<std::uint64_t>& selection = tree.selection();
+   if (selection.empty()) return;
+
+   counts.assign(selection.size(), GLsizei(tree.indices().size()));
+   offsets.assign(selection.size(), nullptr);
+   baseVertices.clear();
+   for (std::uint64_t key : selection) baseVertices.push_back(slots[key] * GLint(chunkVertices));
+
+   glBindVertexArray(vao);
+   glMultiDrawElementsBaseVertex(GL_TRIANGLES, counts.data(), GL_UNSIGNED_INT, offsets.data(), GLsizei(selection.size()), baseVertices.data());
+}
@@ -0,0 +1,76 @@
+#pragma once
+
+#include <glad/glad.h>
+#include <GL/gl.h>
+#include <GLFW/glfw3.h>
+#include <cstddef>
+#include <cstdint>
+#include <unordered_map>
+#include <vector>
+#include "glProgram.hpp"
+#include "utils/terrain.hpp"
+
+
+/// @brief: GPU side of a terrainTree. One vertex buffer has a slot for every chunk the tree keeps
+/// ready and one index buffer is shared by all chunks, so a finished chunk is a single
+/// glBufferSubData into a free slot and the whole selection is one multi draw.
+/// With a tree made with terrainSettings::vertices off the chunks come without vertices and a
+/// compute program (src/shaders/terrainCompute.glsl) writes them into their slot instead, the
+/// CPU only works out the bounds
+class gl_terrain {
+
+public:
+
+   /// @brief: Creates the buffers and uploads the root chunks
+   /// @param programs: Builds the compute programs, needed when the tree leaves the vertices to
+   /// the GPU (Default: nullptr)
+   gl_terrain(terrainTree& tree, gl_programBuilder* programs = nullptr);
+   ~gl_terrain();
+
+   gl_terrain(const gl_terrain&) = delete;
+   gl_terrain& operator=(const gl_terrain&) = delete;
+
+   /// @brief: Frees the slots of evicted chunks and uploads finished ones, call after
+   /// terrainTree::select every frame. Chunks without vertices are dispatched to the compute
+   /// program, with a barrier so the draws after see them (leaves the compute program bound)
+   /// @param uploads: Most chunks uploaded this frame, keeps the frame time even while flying
+   /// @return: Chunks uploaded
+   std::size_t update(std::size_t uploads = 8);
+
+   /// @brief: Draws the chunks of the last select, with the program already bound
+   void draw();
+
+   /// @brief: Reads the vertices of a ready chunk back from its slot (waits for the GPU, only
+   /// meant for checks against terrainTree::generate)
+   std::vector<float> readBack(std::uint64_t key);
+
+   // Chunks per compute dispatch, the size of the chunk arrays in the shader
+   static const int batch = 16;
+
+   GLuint vao;
+
+private:
+
+   void dispatch(const std::vector<const terrainChunk*>& chunks);
+
+   terrainTree& tree;
+   GLuint vbo;
+   GLuint ebo;
+   std::size_t chunkVertices;
+
+   std::unordered_map<std::uint64_t, GLint> slots;
+   std::vector<GLint> freeSlots;
+
+   // Kept between frames so the vectors are not allocated again
+   std::vector<terrainChunk> finished;
+   std::vector<std::uint64_t> evicted;
+   std::vector<GLsizei> counts;
+   std::vector<const void*> offsets;
+   std::vector<GLint> baseVertices;
+
+   // Compute path, the samples are a scratch buffer for one batch
+   gl_programBuilder* programs;
+   unsigned int heightsProgram = 0;
+   unsigned int verticesProgram = 0;
+   GLuint samples = 0;
+};
@@ -0,0 +1,106 @@
+#include "glTileMap.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <string>
+
+
+gl_tileMap::gl_tileMap(const tileGrid& grid, float radius, gl_programBuilder& _programs) : programs(_programs) {
+
+   program = programs.add({{GL_VERTEX_SHADER, "src/shaders/tileVertex.glsl"}, {GL_FRAGMENT_SHADER, "src/shaders/tileFragment.glsl"}},
+                          {"TILE_OWNERS " + std::to_string(owners), "TILE_TERRAINS " + std::to_string(terrains)});
+
+   // Ocean, plains, forest, desert, hills, mountains and snow, then grey for whatever the game adds
+   const vec3 ground[] = {{0.10f, 0.25f, 0.55f}, {0.45f, 0.65f, 0.25f}, {0.15f, 0.40f, 0.15f}, {0.85f, 0.75f, 0.45f},
+                          {0.50f, 0.45f, 0.30f}, {0.45f, 0.42f, 0.40f}, {0.95f, 0.95f, 0.95f}};
+   for (int t = 0; t < terrains; t++) terrainColors[t] = t < 7 ? ground[t] : vec3(0.5f, 0.5f, 0.5f);
+   // Hues the golden ratio apart so the first players are easy to tell apart
+   for (int o = 0; o < owners; o++){
+      float h = std::fmod(float(o) * 0.618034f, 1.0f) * 6.0f;
+      float r = std::clamp(std::fabs(h - 3.0f) - 1.0f, 0.0f, 1.0f);
+      float g = std::clamp(2.0f - std::fabs(h - 2.0f), 0.0f, 1.0f);
+      float b = std::clamp(2.0f - std::fabs(h - 4.0f), 0.0f, 1.0f);
+      ownerColors[o] = vec3(r, g, b);
+   }
+
+   std::vector<tileVertex> vertices;
+   std::vector<int> indices;
+   tiles_mesh(grid, radius, vertices, indices);
+   indexCount = GLsizei(indices.size());
+
+   glGenVertexArrays(1, &vao);
+   glGenBuffers(1, &vbo);
+   glGenBuffers(1, &ebo);
+   glBindVertexArray(vao);
+
+   glBindBuffer(GL_ARRAY_BUFFER, vbo);
+   glBufferData(GL_ARRAY_BUFFER, vertices.size() * sizeof(tileVertex), vertices.data(), GL_STATIC_DRAW);
+   glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, sizeof(tileVertex), (void*)offsetof(tileVertex, x));
+   glEnableVertexAttribArray(0);
+   glVertexAttribPointer(1, 1, GL_FLOAT, GL_FALSE, sizeof(tileVertex), (void*)offsetof(tileVertex, edge));
+   glEnableVertexAttribArray(1);
+   // The tile index stays an integer all the way to the shader
+   glVertexAttribIPointer(2, 1, GL_UNSIGNED_INT, sizeof(tileVertex), (void*)offsetof(tileVertex, tile));
+   glEnableVertexAttribArray(2);
+
+   glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, ebo);
+   glBufferData(GL_ELEMENT_ARRAY_BUFFER, indices.size() * sizeof(GLint), indices.data(), GL_STATIC_DRAW);
+   glBindVertexArray(0);
+
+   // One RGBA8UI texel per tile, read with texelFetch
+   states.assign(grid.size(), gl_tileState{});
+   marked.assign(grid.size(), 0);
+   glGenBuffers(1, &stateBuffer);
+   glBindBuffer(GL_TEXTURE_BUFFER, stateBuffer);
+   glBufferData(GL_TEXTURE_BUFFER, states.size() * sizeof(gl_tileState), states.data(), GL_DYNAMIC_DRAW);
+   glGenTextures(1, &stateTexture);
+   glBindTexture(GL_TEXTURE_BUFFER, stateTexture);
+   glTexBuffer(GL_TEXTURE_BUFFER, GL_RGBA8UI, stateBuffer);
+}
+
+
+gl_tileMap::~gl_tileMap(){
+   glDeleteTextures(1, &stateTexture);
+   glDeleteBuffers(1, &stateBuffer);
+   glDeleteBuffers(1, &vbo);
+   glDeleteBuffers(1, &ebo);
+   glDeleteVertexArrays(1, &vao);
+}
+
+
+void gl_tileMap::set(int tile, gl_tileState state){
+   states[tile] = state;
+   if (marked[tile]) return;
+   marked[tile] = 1;
+   dirty.push_back(tile);
+}
+
+
+std::size_t gl_tileMap::upload(){
+   if (dirty.empty()) return 0;
+   for (int tile : dirty) marked[tile] = 0;
+   tiles_ranges(dirty, mergeGap, sizeof(gl_tileState), ranges);
+   dirty.clear();
+
+   glBindBuffer(GL_TEXTURE_BUFFER, stateBuffer);
+   std::size_t bytes = 0;
+   for (const tileRange& range : ranges){
+      glBufferSubData(GL_TEXTURE_BUFFER, range.offset, range.size, reinterpret_cast<const char*>(states.data()) + range.offset);
+      bytes += range.size;
+   }
+   return bytes;
+}
+
+
+void gl_tileMap::draw(GLint unit){
+   upload();
+   glUniform3fv(programs.uniform(program, "ownerColors"), owners, &ownerColors[0].x);
+   glUniform3fv(programs.uniform(program, "terrainColors"), terrains, &terrainColors[0].x);
+   glUniform1i(programs.uniform(program, "tileStates"), unit);
+   glActiveTexture(GL_TEXTURE0 + unit);
+   glBindTexture(GL_TEXTURE_BUFFER, stateTexture);
+
+   glBindVertexArray(vao);
+   glDrawElements(GL_TRIANGLES, indexCount, GL_UNSIGNED_INT, nullptr);
+}
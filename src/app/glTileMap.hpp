@@ -0,0 +1,82 @@
+#pragma once
+
+#include <glad/glad.h>
+#include <GL/gl.h>
+#include <GLFW/glfw3.h>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+#include "glProgram.hpp"
+#include "utils/tiles.hpp"
+
+
+/// @brief: State of one tile as the shader sees it, 4 bytes so a texel of the state buffer
+/// @param owner: Player owning the tile, an index in ownerColors (0: nobody)
+/// @param terrain: Index in terrainColors
+/// @param highlight: 0 is off, 255 is fully lit (selection, hover, reachable...)
+/// @param flags: Free for the game, the shader does not read it
+struct gl_tileState {
+   std::uint8_t owner = 0;
+   std::uint8_t terrain = 0;
+   std::uint8_t highlight = 0;
+   std::uint8_t flags = 0;
+};
+
+
+/// @brief: Draws every tile of a tileGrid in one call. The mesh is static (see tiles_mesh) and
+/// every vertex carries the index of its tile, the shader (src/shaders/tileVertex.glsl) looks the
+/// state of the tile up in a texture buffer of one gl_tileState per tile. Changing tiles only
+/// marks them, upload sends the changed ones as a few glBufferSubData of neighbouring tiles
+class gl_tileMap {
+
+public:
+
+   /// @brief: Builds the mesh and the program, every tile starts as gl_tileState{}
+   /// @param radius: Radius of the sphere the tiles are drawn on
+   gl_tileMap(const tileGrid& grid, float radius, gl_programBuilder& programs);
+   ~gl_tileMap();
+
+   gl_tileMap(const gl_tileMap&) = delete;
+   gl_tileMap& operator=(const gl_tileMap&) = delete;
+
+   /// @brief: Changes a tile, it goes to the GPU with the next upload
+   void set(int tile, gl_tileState state);
+
+   const gl_tileState& get(int tile) const { return states[tile]; }
+
+   /// @brief: Sends the tiles changed since the last upload, runs of changed tiles at most
+   /// mergeGap apart as one range (tiles_ranges)
+   /// @return: Bytes uploaded
+   std::size_t upload();
+
+   /// @brief: Draws the map (uploads first if tiles changed), with the program of the map already
+   /// bound and its matrices and light uploaded (gl_uploadMatrices)
+   /// @param unit: Texture unit the state buffer is bound to (Default: 0)
+   void draw(GLint unit = 0);
+
+   // Colors of the owners and the terrains, the size of the palettes in the shader
+   static const int owners = 32;
+   static const int terrains = 16;
+   vec3 ownerColors[owners];
+   vec3 terrainColors[terrains];
+
+   // Unchanged tiles sent between two changed ones rather than starting another range
+   static const int mergeGap = 16;
+
+   unsigned int program;
+   GLuint vao;
+
+private:
+
+   gl_programBuilder& programs;
+   GLuint vbo;
+   GLuint ebo;
+   GLuint stateBuffer;
+   GLuint stateTexture;
+   GLsizei indexCount;
+
+   std::vector<gl_tileState> states;
+   std::vector<int> dirty;
+   std::vector<std::uint8_t> marked;
+   std::vector<tileRange> ranges;
+};
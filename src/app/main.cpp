@@ -1,12 +1,19 @@
 #include <glad/glad.h>
 #include <GL/gl.h>
 #include <GLFW/glfw3.h>
+#include <chrono>
+#include <filesystem>
 #include <iostream>
+#include <memory>
 #include <math.h>
 #include <string>
 #include "gl.hpp"
 #include "glObject.hpp"
 #include "utils/matrix.hpp"
+#include "utils/quaternion.hpp"
+#include "utils/scene.hpp"
+#include "utils/assets.hpp"
+#include "utils/watcher.hpp"
 #include <vector>
 
 
@@ -29,53 +36,23 @@ int main(){
    int window_height = mode->height;
 
 
-   // ------------------------------ CREATE SHADER PROGRAM -------------------------------
-   // Create the shader program to link all of the shders together for excecution
-   GLuint shaderProgram = glCreateProgram();
-   GLuint vertexShader =  gl_createVertShader("../src/shaders/vertex.glsl");
-   GLuint fragmentShader =  gl_createFragShader("../src/shaders/fragment.glsl");
+   // ------------------------------ START SHADER PROGRAMS -------------------------------
+   // Linked programs are cached on disk so only the first launch (or a changed shader) pays for
+   // the compile. Run with GL_PROGRAM_CACHE=0 to compare the startup time without the cache
+   auto shaderStart = std::chrono::steady_clock::now();
+   gl_programCache programCache;
+   gl_programBuilder programBuilder(programCache);
 
-   // Attatch both of the shaders to the program and link the program
-   glAttachShader(shaderProgram, vertexShader);
-   glAttachShader(shaderProgram, fragmentShader);
-   glLinkProgram(shaderProgram); // This links all the previously attatched shaders with outputs and inputs
-
-   int  success;
-   char infoLog[512];
-   glGetProgramiv(shaderProgram, GL_LINK_STATUS, &success);
-   if(!success) {
-      glGetProgramInfoLog(shaderProgram, 512, NULL, infoLog);
-      std::cout << "--- Program 1 Failed Compilation ---" << infoLog <<  std::endl;
-   }
-   // After the shaders are linked in the program we no longer need them
-   glDeleteShader(vertexShader);
-   glDeleteShader(fragmentShader);  
-
-   // ------------------------------ CREATE SHADER PROGRAM -------------------------------
-   // Create the shader program to link all of the shders together for excecution
-   GLuint UIshaderProgram = glCreateProgram();
-   GLuint UIvertexShader =  gl_createVertShader("../src/shaders/uiVertex.glsl");
-   GLuint UIfragmentShader =  gl_createFragShader("../src/shaders/uiFragment.glsl");
-
-   // Attatch both of the shaders to the program and link the program
-   glAttachShader(UIshaderProgram, UIvertexShader);
-   glAttachShader(UIshaderProgram, UIfragmentShader);
-   glLinkProgram(UIshaderProgram); // This links all the previously attatched shaders with outputs and inputs
-
-   glGetProgramiv(UIshaderProgram, GL_LINK_STATUS, &success);
-   if(!success) {
-      glGetProgramInfoLog(UIshaderProgram, 512, NULL, infoLog);
-      std::cout << "--- Program 2 Failed Compilation ---" << infoLog << std::endl;
-   }
-   // After the shaders are linked in the program we no longer need them
-   glDeleteShader(UIvertexShader);
-   glDeleteShader(UIfragmentShader);  
+   // All compiles and links are issued here but nothing waits on them until the programs are
+   // needed, so the driver can compile while the meshes below are loading
+   unsigned int mainProgram = programBuilder.add({{GL_VERTEX_SHADER, "src/shaders/vertex.glsl"}, {GL_FRAGMENT_SHADER, "src/shaders/fragment.glsl"}});
+   unsigned int UIprogram = programBuilder.add({{GL_VERTEX_SHADER, "src/shaders/uiVertex.glsl"}, {GL_FRAGMENT_SHADER, "src/shaders/uiFragment.glsl"}});
 
 
    gl_vao vao;
    
    // unsigned int vbo = vao.createVBO(vertices,indices);
-   unsigned int vbo = vao.load("../resources/cow.obj");
+   unsigned int vbo = vao.load("resources/cow.obj");
    unsigned int verticeCount = vao.objects[vbo].indices.size();
    // 1) Id position of attribute. if you have 3 floats for position and 3 for color, position would be 0 and color 2
    // 2) Number of components in attribute, eg position with 3 floats would be 3
@@ -107,21 +84,33 @@ int main(){
    UIvao.bindObjects();
 
 
+   // ------------------------------ FINISH SHADER PROGRAMS -------------------------------
+   programBuilder.get(mainProgram);
+   programBuilder.get(UIprogram);
+
+   std::chrono::duration<double, std::milli> shaderTime = std::chrono::steady_clock::now() - shaderStart;
+   std::cout << "Shader programs and meshes ready in " << shaderTime.count() << " ms (cache " << (programCache.enabled ? "on" : "off")
+             << ", " << programCache.hits << " hits, " << programCache.misses << " misses, parallel compile "
+             << (programBuilder.parallel ? "on" : "off") << ")" << std::endl;
+
+
    vec3 camPos(0.0f,0.0f,0.0f);
    vec3 camForward(0.0f,0.0f,1.0f);
    vec3 camUp(0.0f,1.0f,0.0f);
 
-   vec3 objPos(0.0f, 0.2f, -5.0f);
-   vec3 objRot(0.5f, 0.3f, 0.0f);
+   quat camRot;
 
-   camForward *= matrix_transform(0.0f, 0.0f, 0.0f, 0.0f, 0.0f, 0.0f);
+   camForward *= camRot;
+   camUp *= camRot;
 
-   mat4x4 scale = matrix_scale(0.5f, 0.5f, 0.5f);
-   mat4x4 transform = matrix_transform(objPos.x, objPos.y, objPos.z, objRot.x, objRot.y, objRot.z);
-   mat4x4 lookAt = matrix_pointAt(camPos, camForward, camUp);
-   mat4x4 view = matrix_view(lookAt);
+   mat3x4 lookAt = matrix_pointAt(camPos, camForward, camUp);
    mat4x4 project = matrix_project(70.0f, (float)window_width/(float)window_height, 0.1f, 1000.0f);
 
+   // Object transforms live in the scene graph, its world matrices are only rebuilt when a node moved
+   sceneGraph scene;
+   scene.setCamera(matrix_view(lookAt), project);
+   unsigned int cow = scene.add(sceneGraph::none, vec3(0.0f, 0.2f, -5.0f), quat_euler(0.5f, 0.3f, 0.0f), vec3(0.5f, 0.5f, 0.5f));
+
    float lightPos[3]{0.0f,0.0f,0.0f};
    float lightColor[3]{1.6f,1.0f,1.8f};
    float objColor[3]{0.6f,0.4f,0.2f};
@@ -166,6 +155,11 @@ int main(){
    glBindTexture(GL_TEXTURE_2D, 0);
    glBindFramebuffer(GL_FRAMEBUFFER, 0);
 
+   // Edited shaders are rebuilt while the game keeps running (only when they are read from
+   // GL_ASSET_DIR, the embedded copies can not change)
+   std::unique_ptr<fileWatcher> shaderWatcher;
+   if (!assetDirectory().empty()) shaderWatcher.reset(new fileWatcher(assetDirectory() + "/src/shaders", ".glsl"));
+
    // ------------------------------ MAIN WINDOW LOOP ---------------------------------
    // Main loop for the window
    while(!glfwWindowShouldClose(window)){
@@ -173,27 +167,31 @@ int main(){
       // Get keyboard inputs
       processInput(window);
 
-      glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
-      if (glfwGetKey(window, GLFW_KEY_A) == GLFW_PRESS) {
-         objRot.y += 0.01;
-         transform = matrix_transform(objPos.x, objPos.y, objPos.z, objRot.x, objRot.y, objRot.z);
-      }
-      if (glfwGetKey(window, GLFW_KEY_D) == GLFW_PRESS) {
-         objRot.y -= 0.01;
-         transform = matrix_transform(objPos.x, objPos.y, objPos.z, objRot.x, objRot.y, objRot.z);
+      // Start rebuilding programs whose shader files changed and swap in any that finished
+      // (the builder knows them by their path under the asset directory, with or without a slash at
+      // the end of GL_ASSET_DIR)
+      if (shaderWatcher) {
+         for (const std::string& file : shaderWatcher->poll())
+            programBuilder.reload(std::filesystem::path(file).lexically_relative(assetDirectory()).generic_string());
       }
-      if (glfwGetKey(window, GLFW_KEY_W) == GLFW_PRESS) {
-         objRot.x += 0.01;
-         transform = matrix_transform(objPos.x, objPos.y, objPos.z, objRot.x, objRot.y, objRot.z);
-      }
-      if (glfwGetKey(window, GLFW_KEY_S) == GLFW_PRESS) {
-         objRot.x -= 0.01;
-         transform = matrix_transform(objPos.x, objPos.y, objPos.z, objRot.x, objRot.y, objRot.z);
+      programBuilder.update();
+
+      glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+      // Held keys turn the object around the world y and x axes. The small rotations are stacked
+      // on the quaternion so there is no gimbal lock and the matrix is only rebuilt when it turned
+      quat turn;
+      if (glfwGetKey(window, GLFW_KEY_A) == GLFW_PRESS) turn *= quat_axisAngle(vec3(0.0f, 1.0f, 0.0f), -0.01f);
+      if (glfwGetKey(window, GLFW_KEY_D) == GLFW_PRESS) turn *= quat_axisAngle(vec3(0.0f, 1.0f, 0.0f), 0.01f);
+      if (glfwGetKey(window, GLFW_KEY_W) == GLFW_PRESS) turn *= quat_axisAngle(vec3(1.0f, 0.0f, 0.0f), 0.01f);
+      if (glfwGetKey(window, GLFW_KEY_S) == GLFW_PRESS) turn *= quat_axisAngle(vec3(1.0f, 0.0f, 0.0f), -0.01f);
+      if (turn.w != 1.0f) {
+         scene.setRotation(cow, (scene.rotation(cow) * turn).normal());
       }
+      scene.update();
 
       glBindFramebuffer(GL_FRAMEBUFFER, fbo);
       glViewport(0, 0, fbwidth, fbheight);
-      glUseProgram(shaderProgram);
+      glUseProgram(programBuilder.get(mainProgram));
       vao.bind();
       glEnable(GL_DEPTH_TEST);
       glDepthFunc(GL_LESS);
@@ -201,27 +199,17 @@ int main(){
       glClearColor(0.0f, 0.5f, 0.1f, 1.0f);
       glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
 
-      // update the uniform color
-      int m_scale = glGetUniformLocation(shaderProgram, "scale");
-      glUniformMatrix4fv(m_scale,1,GL_FALSE,&scale.m[0][0]);
-
-      int m_trans = glGetUniformLocation(shaderProgram, "transform");
-      glUniformMatrix4fv(m_trans,1,GL_FALSE,&transform.m[0][0]);
-
-      int m_view = glGetUniformLocation(shaderProgram, "view");
-      glUniformMatrix4fv(m_view,1,GL_FALSE,&view.m[0][0]);
-
-      int m_project = glGetUniformLocation(shaderProgram, "project");
-      glUniformMatrix4fv(m_project,1,GL_FALSE,&project.m[0][0]);
+      // One precomputed mvp, model-view and normal matrix per draw
+      gl_uploadMatrices(programBuilder, mainProgram, scene, cow);
 
 
-      int m_light = glGetUniformLocation(shaderProgram, "light");
+      int m_light = programBuilder.uniform(mainProgram, "light");
       glUniform3fv(m_light,1,&lightPos[0]);
 
-      int m_lightCol = glGetUniformLocation(shaderProgram, "lightCol");
+      int m_lightCol = programBuilder.uniform(mainProgram, "lightCol");
       glUniform3fv(m_lightCol,1,&lightColor[0]);
 
-      int m_objCol = glGetUniformLocation(shaderProgram, "objCol");
+      int m_objCol = programBuilder.uniform(mainProgram, "objCol");
       glUniform3fv(m_objCol,1,&objColor[0]);
 
 
@@ -237,7 +225,7 @@ int main(){
       glClearColor(0.1f, 0.1f, 0.2f, 1.0f);
       glClear(GL_COLOR_BUFFER_BIT);
 
-      glUseProgram(UIshaderProgram);
+      glUseProgram(programBuilder.get(UIprogram));
       UIvao.bind();
       // glBindFramebuffer(GL_FRAMEBUFFER, 0);
       // trigger mipmaps generation explicitly
@@ -253,7 +241,7 @@ int main(){
       // glBindTexture(GL_TEXTURE_2D, textureColorbuffer);
       // glGenerateMipmap(GL_TEXTURE_2D);
       // glBindTexture(GL_TEXTURE_2D, 0);
-      // glUniform1i(glGetUniformLocation(UIshaderProgram, "screenTexture"), 0);
+      // glUniform1i(programBuilder.uniform(UIprogram, "screenTexture"), 0);
       // glDrawArrays(GL_TRIANGLES, 0, 6);
 
       glfwSwapBuffers(window);
@@ -0,0 +1,74 @@
+#pragma once
+
+//////////////////////////////////////////////////////////////////
+// Shared by the benchmarks in src/bench: the repetitions from the command line, the best time of
+// a few runs, the timing lines and the checks that make the exit code
+//////////////////////////////////////////////////////////////////
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+
+inline int bench_repetitions = 5;
+inline int bench_failed = 0;
+
+//////////////////////////////////////////////////////////////////
+/// \brief Reads the repetitions from the first argument, if any
+//////////////////////////////////////////////////////////////////
+inline void bench_start(int argc, char** argv) {
+   if (argc > 1) bench_repetitions = std::max(1, std::atoi(argv[1]));
+   std::printf("Best of %d repetitions after a warmup\n", bench_repetitions);
+}
+
+//////////////////////////////////////////////////////////////////
+/// \brief Best time in milliseconds of f over the repetitions, after a
+/// warmup run
+//////////////////////////////////////////////////////////////////
+template <typename F>
+double bench_time(F f) {
+   f();
+   double best = 1e30;
+   for (int rep = 0; rep < bench_repetitions; rep++) {
+      auto start = std::chrono::steady_clock::now();
+      f();
+      std::chrono::duration<double, std::milli> time = std::chrono::steady_clock::now() - start;
+      best = std::fmin(best, time.count());
+   }
+   return best;
+}
+
+//////////////////////////////////////////////////////////////////
+/// \brief One timing line, with the baseline and the speedup over it
+/// when there is one (before > 0)
+/// \param unit: Unit of value and before (eg. "ms", "ns/call")
+//////////////////////////////////////////////////////////////////
+inline void bench_report(const char* name, double value, double before, double speedup, const char* unit) {
+   if (before > 0.0) std::printf("%-30s %9.2f %s   before %9.2f %s   speedup %6.1fx\n", name, value, unit, before, unit, speedup);
+   else std::printf("%-30s %9.2f %s\n", name, value, unit);
+}
+
+//////////////////////////////////////////////////////////////////
+/// \brief Timing line of two times in milliseconds
+//////////////////////////////////////////////////////////////////
+inline void bench_report(const char* name, double ms, double before) {
+   bench_report(name, ms, before, before / ms, "ms");
+}
+
+//////////////////////////////////////////////////////////////////
+/// \brief Prints ok or FAILED with the measured value, a failure makes
+/// bench_finish return 1
+//////////////////////////////////////////////////////////////////
+inline void bench_check(const char* name, bool pass, double value) {
+   std::printf("%-30s %s (%g)\n", name, pass ? "ok" : "FAILED", value);
+   if (!pass) bench_failed++;
+}
+
+//////////////////////////////////////////////////////////////////
+/// \brief Prints the result of the checks
+/// \return: Exit code, 1 if a check failed
+//////////////////////////////////////////////////////////////////
+inline int bench_finish(const char* suite) {
+   std::printf("%s: %s\n", suite, bench_failed ? "FAILED" : "all passed");
+   return bench_failed ? 1 : 0;
+}
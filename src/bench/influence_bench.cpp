@@ -0,0 +1,166 @@
+//////////////////////////////////////////////////////////////////
+// Microbenchmark of the influence map on a tile grid with cities placed by randObj: the full solve
+// against a plain loop over the tiles of one player at a time, and turns where a few cities move,
+// incremental update against a full solve. Checks that the solve matches the plain loop and that
+// turns of updates end where a solve does, influence and territory.
+// Exits with 1 if a check fails
+// Usage: influence_bench [repetitions] (Default: 5, the best repetition is reported)
+//////////////////////////////////////////////////////////////////
+#include "utils/influence.hpp"
+#include "utils/random.hpp"
+#include "utils/tiles.hpp"
+#include "bench.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <vector>
+
+
+struct city {
+   int player, tile;
+   float strength;
+};
+
+// Cities of every player on random tiles
+static std::vector<city> place(const tileGrid& grid, int players, int perPlayer, int seed) {
+   randObj random(seed);
+   std::vector<city> cities;
+   for (int p = 0; p < players; p++)
+      for (int c = 0; c < perPlayer; c++) cities.push_back({p, random.iRand(0, int(grid.size()) - 1), random.fRand(1.0f, 4.0f)});
+   return cities;
+}
+
+// The plain loop: one player at a time, every step over every tile on one thread
+static std::vector<std::vector<float>> reference(const tileGrid& grid, int players, const std::vector<city>& cities, influenceSettings settings) {
+   std::vector<std::vector<float>> fields(players);
+   for (int p = 0; p < players; p++) {
+      std::vector<float> source(grid.size(), 0.0f);
+      for (const city& c : cities)
+         if (c.player == p) source[c.tile] = c.strength;
+      std::vector<float> field = source, next(grid.size());
+      for (int step = 1; step < settings.steps; step++) {
+         for (std::size_t t = 0; t < grid.size(); t++) {
+            float sum = 0.0f;
+            for (int k = grid.offsets[t]; k < grid.offsets[t + 1]; k++) sum += field[grid.neighbors[k]];
+            next[t] = source[t] + settings.decay / float(grid.degree(int(t))) * sum;
+         }
+         field.swap(next);
+      }
+      fields[p] = field;
+   }
+   return fields;
+}
+
+// Largest difference between the fields of two maps, and tiles with another owner where the
+// influence of the two best players is not a near tie
+static double difference(const influenceMap& a, const influenceMap& b, int& owners) {
+   double largest = 0.0;
+   owners = 0;
+   for (int p = 0; p < a.players(); p++)
+      for (std::size_t t = 0; t < a.field(p).size(); t++) largest = std::fmax(largest, std::fabs(a.field(p)[t] - b.field(p)[t]));
+   for (std::size_t t = 0; t < a.owners().size(); t++) {
+      int oa = a.owners()[t], ob = b.owners()[t];
+      if (oa == ob) continue;
+      float va = oa ? a.value(oa - 1, int(t)) : 0.0f, vb = ob ? b.value(ob - 1, int(t)) : 0.0f;
+      owners += std::fabs(va - vb) > 1e-3f;
+   }
+   return largest;
+}
+
+
+int main(int argc, char** argv) {
+   bench_start(argc, argv);
+
+   const int players = 8;
+   influenceSettings settings;
+
+   // ------------------------------ SPEED -------------------------------
+   tileGrid grid = tiles_generate(8);
+   std::vector<city> cities = place(grid, players, 64, 11);
+   influenceMap map(grid, players, settings);
+   for (const city& c : cities) map.source(c.player, c.tile, c.strength);
+   double plain = bench_time([&] { reference(grid, players, cities, settings); });
+   bench_report("solve level 8, 8 players", bench_time([&] { map.solve(); }), plain);
+
+   // A turn: one city of every player moves to a neighbouring tile
+   randObj random(5);
+   auto turn = [&] {
+      for (int p = 0; p < players; p++) {
+         city& c = cities[std::size_t(p) * 64 + std::size_t(random.iRand(0, 63))];
+         map.source(c.player, c.tile, 0.0f);
+         c.tile = grid.neighbors[grid.offsets[c.tile] + random.iRand(0, grid.degree(c.tile) - 1)];
+         map.source(c.player, c.tile, c.strength);
+      }
+   };
+   // Two cities of a player on one tile is fine for the timing, the last one wins
+   double full = bench_time([&] {
+      turn();
+      map.solve();
+   });
+   std::size_t reached = 0;
+   double incremental = bench_time([&] {
+      turn();
+      reached = map.update();
+   });
+   bench_report("turn: 8 cities move", incremental, full);
+   std::printf("%-30s %9zu tiles of %zu\n", "tiles reached by a turn", reached, grid.size());
+
+   // ------------------------------ CHECKS -------------------------------
+   {
+      tileGrid g = tiles_generate(5);
+      std::vector<city> c = place(g, 4, 16, 3);
+      influenceMap m(g, 4, settings);
+      for (const city& s : c) m.source(s.player, s.tile, s.strength);
+      m.solve();
+      // The last city on a tile is its source in both
+      std::vector<std::vector<float>> expected = reference(g, 4, c, settings);
+      double error = 0.0;
+      for (int p = 0; p < 4; p++)
+         for (std::size_t t = 0; t < g.size(); t++) error = std::fmax(error, std::fabs(expected[p][t] - m.value(p, int(t))));
+      bench_check("solve = plain loop", error < 1e-5, error);
+   }
+   {
+      // Falls off with every tile away from a lone city, and reaches steps - 1 tiles
+      tileGrid g = tiles_generate(5);
+      influenceMap m(g, 1, settings);
+      m.source(0, 0, 1.0f);
+      m.solve();
+      std::vector<int> distance(g.size(), -1), queue{0};
+      distance[0] = 0;
+      for (std::size_t i = 0; i < queue.size(); i++)
+         for (int k = g.offsets[queue[i]]; k < g.offsets[queue[i] + 1]; k++)
+            if (distance[g.neighbors[k]] < 0) {
+               distance[g.neighbors[k]] = distance[queue[i]] + 1;
+               queue.push_back(g.neighbors[k]);
+            }
+      // Every tile in reach has a neighbour one step closer with more influence
+      int wrong = 0;
+      for (std::size_t t = 1; t < g.size(); t++) {
+         float closer = 0.0f;
+         for (int k = g.offsets[t]; k < g.offsets[t + 1]; k++)
+            if (distance[g.neighbors[k]] == distance[t] - 1) closer = std::fmax(closer, m.value(0, g.neighbors[k]));
+         if (distance[t] < settings.steps) wrong += !(m.value(0, int(t)) > 0.0f && m.value(0, int(t)) < closer);
+         else wrong += m.value(0, int(t)) != 0.0f;
+      }
+      bench_check("falls off with distance", wrong == 0, wrong);
+   }
+   {
+      // Turns of updates against solving the same sources
+      influenceMap solved(grid, players, settings);
+      for (int rep = 0; rep < 20; rep++) turn();
+      map.update();
+      // Cities that share a tile: the last one set is the source, the same order in both
+      for (const city& c : cities) map.source(c.player, c.tile, c.strength);
+      map.update();
+      for (const city& c : cities) solved.source(c.player, c.tile, c.strength);
+      solved.solve();
+      int owners = 0;
+      double error = difference(map, solved, owners);
+      bench_check("updates = solve", error < 1e-3, error);
+      bench_check("updates territory = solve", owners == 0, owners);
+   }
+
+   return bench_finish("Influence");
+}
@@ -0,0 +1,585 @@
+//////////////////////////////////////////////////////////////////
+// Microbenchmark of the SIMD math in matrix.hpp against the original scalar code, and an accuracy
+// suite: every error is checked against a tolerance and math_bench exits with 1 if any is over it.
+// Usage: math_bench [repetitions] (Default: 5, the best repetition is reported)
+//////////////////////////////////////////////////////////////////
+#include "utils/matrix.hpp"
+#include "utils/quaternion.hpp"
+#include "utils/scene.hpp"
+#include "utils/transform.hpp"
+#include "bench.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <string>
+#include <vector>
+
+
+// The scalar code as it was before the SIMD paths, used as the baseline and the reference result
+namespace scalar {
+
+mat4x4 multiply(const mat4x4 &a, const mat4x4 &b) {
+   mat4x4 matrix;
+   for (int i = 0; i < 4; i++)
+      for (int j = 0; j < 4; j++)
+         matrix.m[j][i] = a.m[j][0] * b.m[0][i] + a.m[j][1] * b.m[1][i] + a.m[j][2] * b.m[2][i] + a.m[j][3] * b.m[3][i];
+   return matrix;
+}
+
+vec3 transform(const vec3 &p, const mat4x4 &m) {
+   vec3 v;
+   v.x = p.x * m.m[0][0] + p.y * m.m[1][0] + p.z * m.m[2][0] + m.m[3][0];
+   v.y = p.x * m.m[0][1] + p.y * m.m[1][1] + p.z * m.m[2][1] + m.m[3][1];
+   v.z = p.x * m.m[0][2] + p.y * m.m[1][2] + p.z * m.m[2][2] + m.m[3][2];
+   float w = p.x * m.m[0][3] + p.y * m.m[1][3] + p.z * m.m[2][3] + m.m[3][3];
+   if ( w != 0.0f) {v.x /= w; v.y /= w; v.z /= w;}
+   return v;
+}
+
+// matrix_transform before it used sincos, every entry calls the trig functions again
+mat3x4 transformEuler(float x, float y, float z, float u, float v, float w) {
+   mat3x4 m;
+   m.m[0][0] = (cosf(v)*cosf(w));  m.m[0][1] = ((sinf(u)*-sinf(v))*cosf(w)) + (cosf(u)*-sinf(w));
+   m.m[1][0] = (cosf(v)*sinf(w));  m.m[1][1] = ((sinf(u)*-sinf(v))*sinf(w)) + (cosf(u)*cosf(w));
+   m.m[2][0] = sinf(v);            m.m[2][1] = (sinf(u)*cos(v));
+
+   m.m[0][2] = ((cosf(u)*-sinf(v))*cosf(w)) + (-sinf(u)*-sinf(w)); m.m[0][3] = x;
+   m.m[1][2] = ((cosf(u)*-sinf(v))*sinf(w)) + (-sinf(u)*cosf(w));  m.m[1][3] = y;
+   m.m[2][2] = (cos(u)*cos(v));                                    m.m[2][3] = z;
+   return m;
+}
+
+mat4x4 transpose(const mat4x4 &m) {
+   mat4x4 m2;
+   for (int i = 0; i < 4; i++)
+      for (int j = 0; j < 4; j++)
+         m2.m[i][j] = m.m[j][i];
+   return m2;
+}
+
+// matrix_project as it was before sincos
+mat4x4 project(float fov, float a, float n, float f) {
+   float tanHalfFOV = tanf(fov * (M_PI / 180.0f) / 2.0f);
+   float t = tanHalfFOV * n;
+   float r = t * a;
+   mat4x4 m;
+   m.m[0][0] = n / r;
+   m.m[1][1] = n / t;
+   m.m[2][2] = -(f + n) / (f - n);  m.m[2][3] = -1.0f;
+   m.m[3][2] = -(2.0f * f * n) / (f - n);  m.m[3][3] = 0.0f;
+   return m;
+}
+
+// matrix_pointAt in double precision
+mat4x4 pointAt(const vec3 &pos, const vec3 &target, const vec3 &up) {
+   double f[3] = {target.x, target.y, target.z}, u[3] = {up.x, up.y, up.z};
+   double d = u[0] * f[0] + u[1] * f[1] + u[2] * f[2], length = 0.0;
+   for (int i = 0; i < 3; i++) { u[i] -= f[i] * d; length += u[i] * u[i]; }
+   for (int i = 0; i < 3; i++) u[i] /= std::sqrt(length);
+   double r[3] = {u[1] * f[2] - u[2] * f[1], u[2] * f[0] - u[0] * f[2], u[0] * f[1] - u[1] * f[0]};
+   mat4x4 m;
+   for (int i = 0; i < 3; i++) { m.m[0][i] = r[i]; m.m[1][i] = u[i]; m.m[2][i] = f[i]; }
+   m.m[3][0] = pos.x; m.m[3][1] = pos.y; m.m[3][2] = pos.z; m.m[3][3] = 1.0f;
+   return m;
+}
+
+// Gauss-Jordan elimination in double precision
+mat4x4 inverse(const mat4x4 &m) {
+   double a[4][8];
+   for (int i = 0; i < 4; i++)
+      for (int j = 0; j < 4; j++) { a[i][j] = m.m[i][j]; a[i][j + 4] = i == j; }
+   for (int c = 0; c < 4; c++) {
+      int pivot = c;
+      for (int r = c + 1; r < 4; r++) if (std::fabs(a[r][c]) > std::fabs(a[pivot][c])) pivot = r;
+      for (int j = 0; j < 8; j++) std::swap(a[c][j], a[pivot][j]);
+      double p = a[c][c];
+      for (int j = 0; j < 8; j++) a[c][j] /= p;
+      for (int r = 0; r < 4; r++) {
+         if (r == c) continue;
+         double f = a[r][c];
+         for (int j = 0; j < 8; j++) a[r][j] -= f * a[c][j];
+      }
+   }
+   mat4x4 m2;
+   for (int i = 0; i < 4; i++)
+      for (int j = 0; j < 4; j++) m2.m[i][j] = (float)a[i][j + 4];
+   return m2;
+}
+
+// Gribb-Hartmann planes in double precision, (a,b,c,d) with a unit normal
+void frustum(const mat4x4 &m, double planes[6][4]) {
+   for (int i = 0; i < 6; i++) {
+      double sign = i % 2 == 0 ? 1.0 : -1.0, length = 0.0;
+      for (int c = 0; c < 4; c++) planes[i][c] = (double)m.m[c][3] + sign * m.m[c][i / 2];
+      for (int c = 0; c < 3; c++) length += planes[i][c] * planes[i][c];
+      for (int c = 0; c < 4; c++) planes[i][c] /= std::sqrt(length);
+   }
+}
+
+}
+
+
+// The whole library is constexpr, these are built by the compiler (it fails to compile if not)
+constexpr mat3x4 constantScale = matrix_scale(1.0f, 2.0f, 3.0f);
+constexpr mat4x4 constantModel = (constantScale * matrix_transform(1.0f, 2.0f, 3.0f, 0.5f, 0.25f, 0.125f)).toMat4();
+constexpr mat4x4 constantProject = matrix_project(70.0f, 1.5f, 0.1f, 1000.0f);
+static_assert(constantScale.m[1][1] == 2.0f && constantModel.m[3][3] == 1.0f && constantProject.m[2][3] == -1.0f);
+static_assert((vec3(1.0f, 0.0f, 0.0f) * matrix_rotate(quat_axisAngle(vec3(0.0f, 0.0f, 1.0f), 1.57079632f))).y > 0.9999f);
+
+
+static float maxError(const mat4x4 &a, const mat4x4 &b) {
+   float e = 0.0f;
+   for (int i = 0; i < 4; i++)
+      for (int j = 0; j < 4; j++) e = std::fmax(e, std::fabs(a.m[i][j] - b.m[i][j]));
+   return e;
+}
+
+static float maxError(const vec3 &a, const vec3 &b) {
+   return std::fmax(std::fabs(a.x - b.x), std::fmax(std::fabs(a.y - b.y), std::fabs(a.z - b.z)));
+}
+
+
+// Runs f over every input many times and returns the best time per call in nanoseconds. The
+// inputs are small enough to stay in L1 so the arithmetic is measured and not the memory
+template <typename F>
+static double bench(std::size_t count, F f) {
+   const int passes = 200;
+   return bench_time([&] {
+      for (int pass = 0; pass < passes; pass++)
+         for (std::size_t i = 0; i < count; i++) {
+            f(i);
+            // Stops the compiler from hoisting the work out of the passes since the inputs never change
+            asm volatile("" ::: "memory");
+         }
+   }) * 1e6 / double(count * passes);
+}
+
+
+// Every error measured is checked at the end against the largest error that is still acceptable,
+// after the timings so they stay one table
+struct accuracy {
+   std::string name;
+   float error;
+   float tolerance;
+};
+static std::vector<accuracy> accuracies;
+
+static void expect(const std::string& name, float error, float tolerance) {
+   accuracies.push_back({name, error, tolerance});
+}
+
+// Timing and error of an operation against the code it replaces
+static void report(const char* name, double simd, const char* baseline, double reference, float error, float tolerance) {
+   std::printf("%-22s %8.2f ns/op   %6s %8.2f ns/op   speedup %5.2fx   max error %g\n", name, simd, baseline, reference, reference / simd, error);
+   expect(name, error, tolerance);
+}
+
+// Timing and error of an operation with nothing to compare the speed to
+static void report(const char* name, double ns, float error, float tolerance) {
+   std::printf("%-22s %8.2f ns/op   max error %g\n", name, ns, error);
+   expect(name, error, tolerance);
+}
+
+
+int main(int argc, char** argv) {
+#if defined(MATH_AVX2)
+   std::printf("SIMD path: AVX2 + SSE4.1\n");
+#elif defined(MATH_SSE)
+   std::printf("SIMD path: SSE4.1\n");
+#elif defined(MATH_NEON)
+   std::printf("SIMD path: NEON\n");
+#else
+   std::printf("SIMD path: none (scalar)\n");
+#endif
+   bench_start(argc, argv);
+
+   // Random well conditioned matrices (rotation + translation + projection like terms) and points
+   const std::size_t count = 128;
+   std::mt19937 gen(1234);
+   std::uniform_real_distribution<float> distr(-1.0f, 1.0f);
+   std::vector<mat4x4> matrices(count);
+   std::vector<vec3> points(count);
+   for (std::size_t i = 0; i < count; i++) {
+      for (int c = 0; c < 4; c++)
+         for (int r = 0; r < 4; r++) matrices[i].m[c][r] = distr(gen) + (c == r ? 4.0f : 0.0f);
+      points[i] = vec3(distr(gen), distr(gen), distr(gen));
+   }
+   std::vector<mat4x4> out(count);
+   std::vector<vec3> outPoints(count);
+   std::vector<float> outFloats(count);
+
+   // ------------------------------ VECTORS -------------------------------
+   // Against the same operation done in double precision
+   std::vector<vec3> others(count);
+   std::vector<float> scalars(count);
+   for (std::size_t i = 0; i < count; i++) {
+      others[i] = vec3(distr(gen), distr(gen), distr(gen));
+      scalars[i] = distr(gen) + 2.0f;
+   }
+   auto vectorOp = [&](const char* name, auto op, auto exact) {
+      float e = 0.0f;
+      for (std::size_t i = 0; i < count; i++) {
+         const vec3 &a = points[i], &b = others[i];
+         double r[3];
+         exact(a.x, a.y, a.z, b.x, b.y, b.z, (double)scalars[i], r);
+         e = std::fmax(e, maxError(op(a, b, scalars[i]), vec3(r[0], r[1], r[2])));
+      }
+      report(name, bench(count, [&](std::size_t i) { outPoints[i] = op(points[i], others[i], scalars[i]); }), e, 1e-6f);
+   };
+   vectorOp("vec3 + vec3", [](const vec3 &a, const vec3 &b, float) { return a + b; },
+            [](double ax, double ay, double az, double bx, double by, double bz, double, double* r) { r[0] = ax + bx; r[1] = ay + by; r[2] = az + bz; });
+   vectorOp("vec3 - vec3", [](const vec3 &a, const vec3 &b, float) { return a - b; },
+            [](double ax, double ay, double az, double bx, double by, double bz, double, double* r) { r[0] = ax - bx; r[1] = ay - by; r[2] = az - bz; });
+   vectorOp("vec3 * float", [](const vec3 &a, const vec3 &, float f) { return a * f; },
+            [](double ax, double ay, double az, double, double, double, double f, double* r) { r[0] = ax * f; r[1] = ay * f; r[2] = az * f; });
+   vectorOp("vec3 / float", [](const vec3 &a, const vec3 &, float f) { return a / f; },
+            [](double ax, double ay, double az, double, double, double, double f, double* r) { r[0] = ax / f; r[1] = ay / f; r[2] = az / f; });
+   vectorOp("vec3 cross", [](const vec3 &a, const vec3 &b, float) { return a.cross(b); },
+            [](double ax, double ay, double az, double bx, double by, double bz, double, double* r) { r[0] = ay * bz - az * by; r[1] = az * bx - ax * bz; r[2] = ax * by - ay * bx; });
+   vectorOp("vec3 normal", [](const vec3 &a, const vec3 &, float) { return a.normal(); },
+            [](double ax, double ay, double az, double, double, double, double, double* r) { double m = std::sqrt(ax * ax + ay * ay + az * az); r[0] = ax / m; r[1] = ay / m; r[2] = az / m; });
+
+   float error = 0.0f;
+   for (std::size_t i = 0; i < count; i++) {
+      const vec3 &a = points[i], &b = others[i];
+      error = std::fmax(error, std::fabs(a.dot(b) - ((double)a.x * b.x + (double)a.y * b.y + (double)a.z * b.z)));
+   }
+   report("vec3 dot", bench(count, [&](std::size_t i) { outFloats[i] = points[i].dot(others[i]); }), error, 1e-6f);
+
+   error = 0.0f;
+   for (std::size_t i = 0; i < count; i++) {
+      const vec3 &a = points[i];
+      error = std::fmax(error, std::fabs(a.mag() - std::sqrt((double)a.x * a.x + (double)a.y * a.y + (double)a.z * a.z)));
+   }
+   report("vec3 mag", bench(count, [&](std::size_t i) { outFloats[i] = points[i].mag(); }), error, 1e-6f);
+
+   // ------------------------------ BUILDERS -------------------------------
+   std::vector<mat3x4> outAffines(count);
+   std::vector<vec3> forwards(count);
+   for (std::size_t i = 0; i < count; i++) forwards[i] = others[i].normal();
+
+   error = 0.0f;
+   for (std::size_t i = 0; i < count; i++) {
+      mat4x4 reference;
+      reference.m[0][0] = scalars[i]; reference.m[1][1] = scalars[i] * 2.0f; reference.m[2][2] = scalars[i] * 0.5f; reference.m[3][3] = 1.0f;
+      error = std::fmax(error, maxError(matrix_scale(scalars[i], scalars[i] * 2.0f, scalars[i] * 0.5f).toMat4(), reference));
+   }
+   report("matrix_scale", bench(count, [&](std::size_t i) { outAffines[i] = matrix_scale(scalars[i], scalars[i] * 2.0f, scalars[i] * 0.5f); }), error, 0.0f);
+
+   // The old tanf version is the reference. The far plane is small since the z terms grow with it
+   error = 0.0f;
+   for (std::size_t i = 0; i < count; i++) error = std::fmax(error, maxError(matrix_project(60.0f + 20.0f * scalars[i], 1.5f, 0.1f, 100.0f), scalar::project(60.0f + 20.0f * scalars[i], 1.5f, 0.1f, 100.0f)));
+   double simd = bench(count, [&](std::size_t i) { out[i] = matrix_project(60.0f + 20.0f * scalars[i], 1.5f, 0.1f, 100.0f); });
+   double reference = bench(count, [&](std::size_t i) { out[i] = scalar::project(60.0f + 20.0f * scalars[i], 1.5f, 0.1f, 100.0f); });
+   report("matrix_project", simd, "tanf", reference, error, 1e-5f);
+
+   const vec3 up(0.0f, 1.0f, 0.0f);
+   error = 0.0f;
+   for (std::size_t i = 0; i < count; i++) error = std::fmax(error, maxError(matrix_pointAt(points[i], forwards[i], up).toMat4(), scalar::pointAt(points[i], forwards[i], up)));
+   report("matrix_pointAt", bench(count, [&](std::size_t i) { outAffines[i] = matrix_pointAt(points[i], forwards[i], up); }), error, 1e-5f);
+
+   // pointAt is orthonormal so the view matrix has to be its full inverse
+   error = 0.0f;
+   for (std::size_t i = 0; i < count; i++) error = std::fmax(error, maxError(matrix_view(matrix_pointAt(points[i], forwards[i], up)).toMat4(), scalar::inverse(scalar::pointAt(points[i], forwards[i], up))));
+   std::vector<mat3x4> cameraAffines(count);
+   for (std::size_t i = 0; i < count; i++) cameraAffines[i] = matrix_pointAt(points[i], forwards[i], up);
+   report("matrix_view", bench(count, [&](std::size_t i) { outAffines[i] = matrix_view(cameraAffines[i]); }), error, 1e-5f);
+
+   // ------------------------------ MATRICES -------------------------------
+
+   error = 0.0f;
+   for (std::size_t i = 0; i + 1 < count; i++) error = std::fmax(error, maxError(matrices[i] * matrices[i + 1], scalar::multiply(matrices[i], matrices[i + 1])));
+   simd = bench(count - 1, [&](std::size_t i) { out[i] = matrices[i] * matrices[i + 1]; });
+   reference = bench(count - 1, [&](std::size_t i) { out[i] = scalar::multiply(matrices[i], matrices[i + 1]); });
+   report("mat4x4 * mat4x4", simd, "scalar", reference, error, 1e-5f);
+
+   error = 0.0f;
+   for (std::size_t i = 0; i < count; i++) error = std::fmax(error, maxError(points[i] * matrices[i], scalar::transform(points[i], matrices[i])));
+   simd = bench(count, [&](std::size_t i) { outPoints[i] = points[i] * matrices[i]; });
+   reference = bench(count, [&](std::size_t i) { outPoints[i] = scalar::transform(points[i], matrices[i]); });
+   report("vec3 * mat4x4", simd, "scalar", reference, error, 1e-5f);
+
+   error = 0.0f;
+   for (std::size_t i = 0; i < count; i++) error = std::fmax(error, maxError(matrix_transpose(matrices[i]), scalar::transpose(matrices[i])));
+   simd = bench(count, [&](std::size_t i) { out[i] = matrix_transpose(matrices[i]); });
+   reference = bench(count, [&](std::size_t i) { out[i] = scalar::transpose(matrices[i]); });
+   report("matrix_transpose", simd, "scalar", reference, error, 0.0f);
+
+   // The reference inverse is double precision Gauss-Jordan so it is only the accuracy baseline and
+   // there is no speedup to print. The scalar cofactor fallback is the time of a MATH_NO_SIMD build
+   error = 0.0f;
+   for (std::size_t i = 0; i < count; i++) error = std::fmax(error, maxError(matrix_inverse(matrices[i]), scalar::inverse(matrices[i])));
+   simd = bench(count, [&](std::size_t i) { out[i] = matrix_inverse(matrices[i]); });
+   report("matrix_inverse", simd, error, 1e-5f);
+
+   // ------------------------------ AFFINE MATRICES -------------------------------
+   // Compared against the mat4x4 operations they replace (the error is against the same math in 4x4)
+   std::vector<mat3x4> affines(count);
+   for (std::size_t i = 0; i < count; i++) {
+      affines[i] = matrix_transform(distr(gen), distr(gen), distr(gen), distr(gen) * 3.0f, distr(gen) * 3.0f, distr(gen) * 3.0f) * matrix_scale(1.5f, 0.5f, 2.0f);
+      matrices[i] = affines[i].toMat4();
+   }
+
+   error = 0.0f;
+   for (std::size_t i = 0; i < count; i++) error = std::fmax(error, maxError(points[i] * affines[i], scalar::transform(points[i], matrices[i])));
+   simd = bench(count, [&](std::size_t i) { outPoints[i] = points[i] * affines[i]; });
+   reference = bench(count, [&](std::size_t i) { outPoints[i] = points[i] * matrices[i]; });
+   report("vec3 * mat3x4", simd, "mat4x4", reference, error, 1e-5f);
+
+   error = 0.0f;
+   for (std::size_t i = 0; i + 1 < count; i++) error = std::fmax(error, maxError((affines[i] * affines[i + 1]).toMat4(), scalar::multiply(matrices[i], matrices[i + 1])));
+   simd = bench(count - 1, [&](std::size_t i) { outAffines[i] = affines[i] * affines[i + 1]; });
+   reference = bench(count - 1, [&](std::size_t i) { out[i] = matrices[i] * matrices[i + 1]; });
+   report("mat3x4 * mat3x4", simd, "mat4x4", reference, error, 1e-5f);
+
+   error = 0.0f;
+   for (std::size_t i = 0; i < count; i++) error = std::fmax(error, maxError(matrix_inverse(affines[i]).toMat4(), scalar::inverse(matrices[i])));
+   simd = bench(count, [&](std::size_t i) { outAffines[i] = matrix_inverse(affines[i]); });
+   reference = bench(count, [&](std::size_t i) { out[i] = matrix_inverse(matrices[i]); });
+   report("matrix_inverse(mat3x4)", simd, "mat4x4", reference, error, 1e-5f);
+
+   // ------------------------------ INVERSE, NORMAL MATRIX AND FRUSTUM -------------------------------
+   // Full camera matrices (model-view * projection) with a different field of view each
+   std::vector<mat4x4> cameras(count);
+   for (std::size_t i = 0; i < count; i++)
+      cameras[i] = matrices[i] * matrix_project(50.0f + 40.0f * distr(gen), 1.5f, 0.1f, 100.0f);
+
+   error = 0.0f;
+   for (std::size_t i = 0; i < count; i++) error = std::fmax(error, maxError(matrix_inverse(cameras[i]), scalar::inverse(cameras[i])));
+   simd = bench(count, [&](std::size_t i) { out[i] = matrix_inverse(cameras[i]); });
+   report("matrix_inverse(camera)", simd, error, 1e-4f);
+
+   // Every random matrix is invertible, matrices with a flattened axis are not and neither are
+   // ones with a row that is the sum of two others (their determinant rounds to a tiny value
+   // rather than 0)
+   unsigned int wrong = 0;
+   for (std::size_t i = 0; i < count; i++) {
+      bool invertible4, invertible3, singular4, singular3, dependent4, dependent3;
+      mat3x4 flat = affines[i] * matrix_scale(1.0f, 0.0f, 1.0f);
+      mat4x4 sum4 = cameras[i];
+      for (int c = 0; c < 4; c++) sum4.m[c][2] = sum4.m[c][0] + sum4.m[c][1];
+      mat3x4 sum3 = affines[i];
+      for (int c = 0; c < 3; c++) sum3.m[2][c] = sum3.m[0][c] + sum3.m[1][c];
+      matrix_inverse(cameras[i], &invertible4);
+      matrix_inverse(affines[i], &invertible3);
+      matrix_inverse(flat.toMat4(), &singular4);
+      matrix_inverse(flat, &singular3);
+      matrix_inverse(sum4, &dependent4);
+      matrix_inverse(sum3, &dependent3);
+      wrong += !invertible4 + !invertible3 + singular4 + singular3 + dependent4 + dependent3;
+   }
+   std::printf("%-22s %u of %zu wrong\n", "determinant check", wrong, count * 6);
+   expect("determinant check", wrong, 0.0f);
+
+   // Against the transpose of the double precision inverse
+   error = 0.0f;
+   for (std::size_t i = 0; i < count; i++) {
+      mat3x4 n = matrix_normal(affines[i]);
+      mat4x4 inverse = scalar::inverse(matrices[i]);
+      for (int r = 0; r < 3; r++)
+         for (int c = 0; c < 3; c++) error = std::fmax(error, std::fabs(n.m[r][c] - inverse.m[r][c]));
+   }
+   simd = bench(count, [&](std::size_t i) { outAffines[i] = matrix_normal(affines[i]); });
+   report("matrix_normal", simd, error, 1e-5f);
+
+   // Planes against the double version, and the corners of the view volume (unprojected in double)
+   // must lie on the 3 planes that meet there
+   std::vector<frustum> frustums(count);
+   float cornerError = 0.0f;
+   error = 0.0f;
+   for (std::size_t i = 0; i < count; i++) {
+      frustum f = matrix_frustum(cameras[i]);
+      double planes[6][4];
+      scalar::frustum(cameras[i], planes);
+      for (int p = 0; p < 6; p++) {
+         const vec4 &plane = f.planes[p];
+         error = std::fmax(error, std::fmax(std::fmax(std::fabs(plane.x - planes[p][0]), std::fabs(plane.y - planes[p][1])),
+                                            std::fmax(std::fabs(plane.z - planes[p][2]), std::fabs(plane.w - planes[p][3]))));
+      }
+      mat4x4 inverse = scalar::inverse(cameras[i]);
+      for (int corner = 0; corner < 8; corner++) {
+         float ndc[3] = {corner & 1 ? 1.0f : -1.0f, corner & 2 ? 1.0f : -1.0f, corner & 4 ? 1.0f : -1.0f};
+         vec3 world = vec3(ndc[0], ndc[1], ndc[2]) * inverse;
+         // Scaled by the distance so the far corners (100 units away) are compared fairly
+         float scale = 1.0f + world.mag();
+         for (int axis = 0; axis < 3; axis++)
+            cornerError = std::fmax(cornerError, std::fabs(frustum::distance(f.planes[axis * 2 + (ndc[axis] > 0.0f)], world)) / scale);
+      }
+   }
+   simd = bench(count, [&](std::size_t i) { frustums[i] = matrix_frustum(cameras[i]); });
+   report("matrix_frustum", simd, error, 1e-4f);
+   std::printf("%-22s %8s               max error %g\n", "frustum corners", "", cornerError);
+   expect("frustum corners", cornerError, 1e-4f);
+
+   unsigned int visible = 0;
+   simd = bench(count, [&](std::size_t i) { visible += frustums[i].sphereVisible(points[i], 0.5f); });
+   std::printf("%-22s %8.2f ns/op\n", "sphereVisible", simd);
+
+   // ------------------------------ QUATERNIONS -------------------------------
+   // Compared against the Euler matrix_transform as it was before sincos
+   std::vector<vec3> angles(count);
+   std::vector<quat> rotations(count);
+   for (std::size_t i = 0; i < count; i++) {
+      angles[i] = vec3(distr(gen) * 3.0f, distr(gen) * 3.0f, distr(gen) * 3.0f);
+      rotations[i] = quat_euler(angles[i].x, angles[i].y, angles[i].z);
+   }
+
+   error = 0.0f;
+   for (std::size_t i = 0; i < count; i++) {
+      mat4x4 reference = scalar::transformEuler(1.0f, 2.0f, 3.0f, angles[i].x, angles[i].y, angles[i].z).toMat4();
+      error = std::fmax(error, maxError(matrix_transform(1.0f, 2.0f, 3.0f, angles[i].x, angles[i].y, angles[i].z).toMat4(), reference));
+      error = std::fmax(error, maxError(matrix_transform(vec3(1.0f, 2.0f, 3.0f), rotations[i]).toMat4(), reference));
+   }
+   simd = bench(count, [&](std::size_t i) { outAffines[i] = matrix_transform(1.0f, 2.0f, 3.0f, angles[i].x, angles[i].y, angles[i].z); });
+   reference = bench(count, [&](std::size_t i) { outAffines[i] = scalar::transformEuler(1.0f, 2.0f, 3.0f, angles[i].x, angles[i].y, angles[i].z); });
+   report("matrix_transform Euler", simd, "before", reference, error, 1e-5f);
+   simd = bench(count, [&](std::size_t i) { outAffines[i] = matrix_transform(vec3(1.0f, 2.0f, 3.0f), rotations[i]); });
+   report("matrix_transform quat", simd, "before", reference, error, 1e-5f);
+
+   error = 0.0f;
+   for (std::size_t i = 0; i < count; i++) error = std::fmax(error, maxError(points[i] * rotations[i], points[i] * matrix_rotate(rotations[i])));
+   simd = bench(count, [&](std::size_t i) { outPoints[i] = points[i] * rotations[i]; });
+   reference = bench(count, [&](std::size_t i) { outPoints[i] = points[i] * matrix_rotate(rotations[i]); });
+   report("vec3 * quat", simd, "matrix", reference, error, 1e-5f);
+
+   // Slerp between two rotations around the same axis has to be the rotation by the blended angle
+   error = 0.0f;
+   std::vector<quat> outRotations(count);
+   for (std::size_t i = 0; i < count; i++) {
+      vec3 axis(distr(gen), distr(gen), distr(gen));
+      float a = distr(gen) * 1.5f, b = distr(gen) * 1.5f, t = (distr(gen) + 1.0f) * 0.5f;
+      quat q = quat_slerp(quat_axisAngle(axis, a), quat_axisAngle(axis, b), t);
+      error = std::fmax(error, maxError(matrix_rotate(q).toMat4(), matrix_rotate(quat_axisAngle(axis, a + (b - a) * t)).toMat4()));
+   }
+   simd = bench(count - 1, [&](std::size_t i) { outRotations[i] = quat_slerp(rotations[i], rotations[i + 1], 0.25f); });
+   report("quat_slerp", simd, error, 1e-5f);
+
+   // The compile time sqrt/sincos are not the same code as the C library ones
+   volatile float angle = 0.5f;
+   error = maxError((matrix_scale(1.0f, 2.0f, 3.0f) * matrix_transform(1.0f, 2.0f, 3.0f, angle, angle * 0.5f, angle * 0.25f)).toMat4(), constantModel);
+   error = std::fmax(error, maxError(matrix_project(70.0f + angle - 0.5f, 1.5f, 0.1f, 1000.0f), constantProject));
+   std::printf("%-22s %8s               max error %g\n", "constexpr vs runtime", "", error);
+   expect("constexpr vs runtime", error, 1e-5f);
+
+   // ------------------------------ BATCH TRANSFORMS -------------------------------
+   // Large enough to be far out of cache, so the numbers show how close to memory bandwidth it is
+   const std::size_t batch = 1 << 24;
+   std::vector<float> x(batch), y(batch), z(batch), ox(batch), oy(batch), oz(batch);
+   std::vector<vec3> aos(batch), outAos(batch);
+   std::vector<vec4> aos4(batch), outAos4(batch);
+   for (std::size_t i = 0; i < batch; i++) {
+      x[i] = distr(gen); y[i] = distr(gen); z[i] = distr(gen);
+      aos[i] = vec3(x[i], y[i], z[i]);
+      aos4[i] = vec4(aos[i]);
+   }
+   soa3 in = {x.data(), y.data(), z.data(), batch};
+   soa3 result = {ox.data(), oy.data(), oz.data(), batch};
+   mat4x4 affine = matrices[0];
+   affine.m[0][3] = affine.m[1][3] = affine.m[2][3] = 0.0f;
+   affine.m[3][3] = 1.0f;
+   mat4x4 projective = matrices[1];
+
+   // Per point reference results for a sample of the points
+   auto check = [&](const mat4x4 &m) {
+      float e = 0.0f;
+      for (std::size_t i = 0; i < batch; i += 997) {
+         vec3 r = scalar::transform(vec3(x[i], y[i], z[i]), m);
+         e = std::fmax(e, maxError(r, vec3(ox[i], oy[i], oz[i])));
+         e = std::fmax(e, maxError(r, outAos[i]));
+         e = std::fmax(e, maxError(r, outAos4[i].xyz()));
+      }
+      return e;
+   };
+   auto time = [&](auto f) { return bench_time(f) * 1e6; };
+   auto batchReport = [&](const char* name, double ns, std::size_t bytesPerPoint, float e) {
+      std::printf("%-30s %8.3f ns/point %8.1f Mpoints/s %7.2f GB/s   max error %g\n", name, ns / batch, batch / ns * 1e3,
+                  (double)bytesPerPoint * batch / ns, e);
+      expect(name, e, 1e-5f);
+   };
+
+   for (int parallel = 0; parallel < 2; parallel++) {
+      const char* suffix = parallel ? " (parallel)" : "";
+      double soaAffine = time([&] { transform_affine(affine, in, result, parallel); });
+      double aosAffine = time([&] { transform_affine(affine, aos.data(), outAos.data(), batch, parallel); });
+      double aos4Affine = time([&] { transform_affine(affine, aos4.data(), outAos4.data(), batch, parallel); });
+      float e = check(affine);
+      batchReport((std::string("SoA affine") + suffix).c_str(), soaAffine, 24, e);
+      batchReport((std::string("vec3 affine") + suffix).c_str(), aosAffine, 24, e);
+      batchReport((std::string("vec4 affine") + suffix).c_str(), aos4Affine, 32, e);
+
+      double soaProject = time([&] { transform_project(projective, in, result, parallel); });
+      double aosProject = time([&] { transform_project(projective, aos.data(), outAos.data(), batch, parallel); });
+      double aos4Project = time([&] { transform_project(projective, aos4.data(), outAos4.data(), batch, parallel); });
+      e = check(projective);
+      batchReport((std::string("SoA project") + suffix).c_str(), soaProject, 24, e);
+      batchReport((std::string("vec3 project") + suffix).c_str(), aosProject, 24, e);
+      batchReport((std::string("vec4 project") + suffix).c_str(), aos4Project, 32, e);
+   }
+   double loop = time([&] { for (std::size_t i = 0; i < batch; i++) outAos[i] = scalar::transform(aos[i], projective); });
+   batchReport("scalar vec3 * mat4x4 loop", loop, 24, 0.0f);
+
+   // ------------------------------ SCENE GRAPH -------------------------------
+   // A forest of nodes with random parents close before them, like objects made of parts
+   const unsigned int nodes = 50000;
+   sceneGraph scene;
+   std::uniform_int_distribution<unsigned int> back(1, 64);
+   for (unsigned int i = 0; i < nodes; i++) {
+      unsigned int parent = (i < 64 || i % 50 == 0) ? sceneGraph::none : i - back(gen);
+      scene.add(parent, vec3(distr(gen), distr(gen), distr(gen)), quat_euler(distr(gen), distr(gen), distr(gen)), vec3(1.0f, 1.0f, 1.0f));
+   }
+   scene.setCamera(matrix_view(affines[0]), matrix_project(70.0f, 1.5f, 0.1f, 1000.0f));
+
+   auto sceneTime = [&](const char* name, auto change) {
+      double best = 1e30;
+      std::size_t recomputed = 0;
+      for (int rep = 0; rep < bench_repetitions; rep++) {
+         change();
+         auto start = std::chrono::steady_clock::now();
+         recomputed = scene.update();
+         std::chrono::duration<double, std::micro> t = std::chrono::steady_clock::now() - start;
+         best = std::fmin(best, t.count());
+      }
+      std::printf("%-30s %8.1f us  %6zu of %u world matrices recomputed\n", name, best, recomputed, nodes);
+   };
+   sceneTime("scene update all roots moved", [&] { for (unsigned int i = 0; i < nodes; i += 50) scene.setPosition(i, scene.position(i)); });
+   sceneTime("scene update 1% roots moved", [&] { for (unsigned int i = 0; i < nodes; i += 5000) scene.setPosition(i, scene.position(i)); });
+   sceneTime("scene update camera moved", [&] { scene.setCamera(matrix_view(affines[1]), matrix_project(70.0f, 1.5f, 0.1f, 1000.0f)); });
+   sceneTime("scene update static", [&] {});
+
+   // World matrices against walking up the parent chain for every node
+   error = 0.0f;
+   for (unsigned int i = 0; i < nodes; i += 97) {
+      mat3x4 world;
+      for (unsigned int n = i; n != sceneGraph::none; n = scene.parent(n))
+         world = world * matrix_transform(scene.position(n), scene.rotation(n), scene.scale(n));
+      error = std::fmax(error, maxError(world.toMat4(), scene.world(i).toMat4()));
+   }
+   std::printf("%-30s max error %g\n", "scene world matrices", error);
+   expect("scene world matrices", error, 1e-4f);
+
+   // The normal matrix is the inverse transpose of the model-view, so transpose(normal) * modelView = identity
+   error = 0.0f;
+   for (unsigned int i = 0; i < nodes; i += 97) {
+      const mat3x4 &n = scene.normalMatrix(i), &mv = scene.modelView(i);
+      for (int r = 0; r < 3; r++)
+         for (int c = 0; c < 3; c++)
+            error = std::fmax(error, std::fabs(n.m[0][r] * mv.m[0][c] + n.m[1][r] * mv.m[1][c] + n.m[2][r] * mv.m[2][c] - (r == c ? 1.0f : 0.0f)));
+   }
+   std::printf("%-30s max error %g\n", "scene normal matrices", error);
+   expect("scene normal matrices", error, 1e-4f);
+
+   // Keep the results alive so the loops are not optimized away
+   float sink = 0.0f;
+   for (std::size_t i = 0; i < count; i++) sink += out[i].m[0][0] + outPoints[i].x + outAffines[i].m[0][0];
+   for (std::size_t i = 0; i < count; i++) sink += outFloats[i];
+   sink += visible;
+   std::printf("(checksum %g)\n", sink);
+
+   // ------------------------------ ACCURACY -------------------------------
+   for (const accuracy& a : accuracies) bench_check(a.name.c_str(), a.error <= a.tolerance, a.error);
+   return bench_finish("Accuracy");
+}
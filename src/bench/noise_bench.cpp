@@ -0,0 +1,127 @@
+//////////////////////////////////////////////////////////////////
+// Microbenchmark of noise.hpp, one sample at a time against noise_batch and noise_grid (SIMD and all
+// threads), with checks of the range, continuity and that the batches give the same values as the
+// single samples. Exits with 1 if a check fails
+// Usage: noise_bench [repetitions] (Default: 5, the best repetition is reported)
+//////////////////////////////////////////////////////////////////
+#include "utils/noise.hpp"
+#include "utils/random.hpp"
+#include "bench.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <vector>
+
+
+// Millions of samples per second from the best times in milliseconds
+static void report(const char* name, double samples, double ms, double before) {
+   bench_report(name, samples / ms * 1e-3, before > 0.0 ? samples / before * 1e-3 : 0.0, before / ms, "Msamples/s");
+}
+
+// Points spread over a few hundred noise cells, with negative coordinates too
+template <typename V>
+static std::vector<V> points(std::size_t count, std::uint64_t seed) {
+   randCounter counter(seed);
+   std::vector<V> p(count);
+   for (std::size_t i = 0; i < count; i++) {
+      std::uint32_t b[4];
+      counter.block(i, b);
+      float c[4];
+      for (int k = 0; k < 4; k++) c[k] = float(b[k] >> 8) * (200.0f / 16777216.0f) - 100.0f;
+      if constexpr (sizeof(V) == sizeof(vec2)) p[i] = V(c[0], c[1]);
+      else if constexpr (sizeof(V) == sizeof(vec3)) p[i] = V(c[0], c[1], c[2]);
+      else p[i] = V(c[0], c[1], c[2], c[3]);
+   }
+   return p;
+}
+
+
+// Speed and checks of one layer in one dimension count
+template <typename V>
+static void run(const char* name, const noiseSettings& settings, std::size_t count) {
+   std::vector<V> p = points<V>(count, 1234);
+   std::vector<float> single(count), batch(count);
+
+   double before = bench_time([&] { for (std::size_t i = 0; i < count; i++) single[i] = noise_sample(settings, p[i]); });
+   double now = bench_time([&] { noise_batch(settings, p.data(), batch.data(), count); });
+   report(name, double(count), now, before);
+
+   char label[64];
+   double error = 0.0, mean = 0.0, extreme = 0.0;
+   for (std::size_t i = 0; i < count; i++) {
+      error = std::fmax(error, std::fabs(single[i] - batch[i]));
+      extreme = std::fmax(extreme, std::fabs(single[i]));
+      mean += single[i];
+   }
+   mean /= count;
+   std::snprintf(label, sizeof(label), "%s batch = single", name);
+   bench_check(label, error < 1e-4, error);
+   std::snprintf(label, sizeof(label), "%s in [-1, 1]", name);
+   bench_check(label, extreme <= 1.0, extreme);
+   // Ridged noise spends more time near its peaks, only the others are centered
+   if (settings.fractal != NOISE_RIDGED) {
+      std::snprintf(label, sizeof(label), "%s mean", name);
+      bench_check(label, std::fabs(mean) < 0.05, mean);
+   }
+
+   // Continuous: a tiny step only moves the value a little
+   double jump = 0.0;
+   for (std::size_t i = 0; i < std::min<std::size_t>(count, 1 << 16); i++) {
+      V q = p[i];
+      q.x += 1e-3f;
+      jump = std::fmax(jump, std::fabs(noise_sample(settings, q) - single[i]));
+   }
+   std::snprintf(label, sizeof(label), "%s continuous", name);
+   bench_check(label, jump < 0.05 * std::max(1, settings.fractal == NOISE_SINGLE ? 1 : 1 << (settings.octaves - 1)), jump);
+}
+
+
+int main(int argc, char** argv) {
+   bench_start(argc, argv);
+
+   const std::size_t count = 1 << 20;
+   noiseSettings single;
+   single.fractal = NOISE_SINGLE;
+   run<vec2>("simplex 2D", single, count);
+   run<vec3>("simplex 3D", single, count);
+   run<vec4>("simplex 4D", single, count);
+   single.type = NOISE_VALUE;
+   run<vec2>("value 2D", single, count);
+   run<vec3>("value 3D", single, count);
+   run<vec4>("value 4D", single, count);
+
+   // Typical terrain layers, 5 octaves each
+   noiseSettings fbm;
+   run<vec3>("fbm 3D", fbm, count / 4);
+   noiseSettings ridged;
+   ridged.fractal = NOISE_RIDGED;
+   run<vec3>("ridged 3D", ridged, count / 4);
+   noiseSettings warped;
+   warped.warp = 0.5f;
+   run<vec3>("warped fbm 3D", warped, count / 4);
+
+   // A whole height map, rows over all threads
+   const int size = 1024;
+   std::vector<float> map(size * size);
+   double ms = bench_time([&] { noise_grid(fbm, map.data(), size, size, vec2(-3.0f, 7.0f), 0.01f); });
+   report("grid 1024x1024 fbm", double(size) * size, ms, 0.0);
+   double error = 0.0;
+   for (int y = 0; y < size; y += 37)
+      for (int x = 0; x < size; x += 13)
+         error = std::fmax(error, std::fabs(map[y * size + x] - noise_sample(fbm, vec2(-3.0f + x * 0.01f, 7.0f + y * 0.01f))));
+   bench_check("grid = single", error < 1e-4, error);
+
+   // Another seed is another noise (only lattice points, where gradient noise is always 0, could match)
+   noiseSettings other = fbm;
+   other.seed = 1;
+   int same = 0;
+   for (int i = 1; i <= 1000; i++) {
+      vec3 p(i * 0.3711f, i * 0.1137f, -i * 0.2329f);
+      same += noise_sample(fbm, p) == noise_sample(other, p);
+   }
+   bench_check("seeds differ", same == 0, same);
+
+   return bench_finish("Noise");
+}
@@ -0,0 +1,268 @@
+//////////////////////////////////////////////////////////////////
+// Microbenchmark of the planet generation against a plain subdivision with a midpoint cache, with
+// checks of the mesh (closed, no duplicate vertices, outward winding and the same points as the
+// plain subdivision), and of the terrain level of detail (triangles drawn from different heights,
+// no holes, no cracks). Exits with 1 if a check fails
+// Usage: planet_bench [repetitions] (Default: 5, the best repetition is reported)
+//////////////////////////////////////////////////////////////////
+#include "utils/planet.hpp"
+#include "utils/random.hpp"
+#include "utils/terrain.hpp"
+#include "bench.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <unordered_map>
+#include <vector>
+
+
+// The usual way: split every triangle of the whole mesh in 4 per level, the midpoints looked up in
+// a hash map of edges so shared edges get one vertex
+namespace reference {
+
+struct mesh {
+   std::vector<vec3> positions;
+   std::vector<int> indices;
+};
+
+mesh icosphere(int level) {
+   const float t = 1.61803398875f;
+   mesh m;
+   const float corners[12][3] = {{-1, t, 0}, {1, t, 0}, {-1, -t, 0}, {1, -t, 0}, {0, -1, t}, {0, 1, t},
+                                 {0, -1, -t}, {0, 1, -t}, {t, 0, -1}, {t, 0, 1}, {-t, 0, -1}, {-t, 0, 1}};
+   for (const auto& c : corners) m.positions.push_back(vec3(c[0], c[1], c[2]).normal());
+   m.indices = {0, 11, 5, 0, 5, 1, 0, 1, 7, 0, 7, 10, 0, 10, 11, 1, 5, 9, 5, 11, 4, 11, 10, 2, 10, 7, 6, 7, 1, 8,
+                3, 9, 4, 3, 4, 2, 3, 2, 6, 3, 6, 8, 3, 8, 9, 4, 9, 5, 2, 4, 11, 6, 2, 10, 8, 6, 7, 9, 8, 1};
+   for (int l = 0; l < level; l++) {
+      std::unordered_map<std::uint64_t, int> cache;
+      auto midpoint = [&](int a, int b) {
+         std::uint64_t key = (std::uint64_t(std::min(a, b)) << 32) | std::uint32_t(std::max(a, b));
+         auto it = cache.find(key);
+         if (it != cache.end()) return it->second;
+         m.positions.push_back((m.positions[a] + m.positions[b]).normal());
+         return cache[key] = int(m.positions.size()) - 1;
+      };
+      std::vector<int> next;
+      for (std::size_t i = 0; i < m.indices.size(); i += 3) {
+         int a = m.indices[i], b = m.indices[i + 1], c = m.indices[i + 2];
+         int ab = midpoint(a, b), bc = midpoint(b, c), ca = midpoint(c, a);
+         next.insert(next.end(), {a, ab, ca, b, bc, ab, c, ca, bc, ab, bc, ca});
+      }
+      m.indices.swap(next);
+   }
+   return m;
+}
+
+}
+
+
+static bool less(const vec3& a, const vec3& b) {
+   if (a.x != b.x) return a.x < b.x;
+   if (a.y != b.y) return a.y < b.y;
+   return a.z < b.z;
+}
+
+static bool equal(const vec3& a, const vec3& b) { return a.x == b.x && a.y == b.y && a.z == b.z; }
+
+
+// Selects from a camera at a height above the highest ground looking at the center of the planet
+// until every chunk it asks for is there, returns the triangles drawn
+static std::size_t settle(terrainTree& tree, float height, float top) {
+   const float pixels = 1080.0f;
+   mat4x4 project = matrix_project(70.0f, 16.0f / 9.0f, 0.001f, 100.0f);
+   vec3 camera(0.0f, 0.3f * height, top + height);
+   // The view looks down -z of the pointAt frame, so z points away from the planet
+   mat3x4 view = matrix_view(matrix_pointAt(camera, camera.normal(), vec3(0.0f, 1.0f, 0.0f)));
+   frustum visible = matrix_frustum(view.toMat4() * project);
+   std::vector<terrainChunk> finished;
+   std::vector<std::uint64_t> evicted;
+   // Done once nothing new came in and nothing is asked for anymore
+   for (int frame = 0; frame < 100000; frame++) {
+      tree.select(camera, terrainTree::pixelScale(project, pixels), &visible);
+      tree.collect(64, finished, evicted);
+      if (finished.empty() && tree.idle()) break;
+   }
+   return tree.selection().size() * tree.triangleCount();
+}
+
+// Face and position on it of a direction, the inverse of terrainTree::direction
+static void cubePoint(const vec3& d, int& face, float& u, float& v) {
+   static const vec3 axes[6][3] = {{{1, 0, 0}, {0, 0, -1}, {0, 1, 0}}, {{-1, 0, 0}, {0, 0, 1}, {0, 1, 0}},
+                                   {{0, 1, 0}, {1, 0, 0}, {0, 0, -1}}, {{0, -1, 0}, {1, 0, 0}, {0, 0, 1}},
+                                   {{0, 0, 1}, {1, 0, 0}, {0, 1, 0}}, {{0, 0, -1}, {-1, 0, 0}, {0, 1, 0}}};
+   face = 0;
+   for (int f = 1; f < 6; f++)
+      if (d.dot(axes[f][0]) > d.dot(axes[face][0])) face = f;
+   float n = d.dot(axes[face][0]);
+   u = std::atan(d.dot(axes[face][1]) / n) / 0.78539816339f;
+   v = std::atan(d.dot(axes[face][2]) / n) / 0.78539816339f;
+}
+
+
+int main(int argc, char** argv) {
+   bench_start(argc, argv);
+
+   // ------------------------------ SPEED -------------------------------
+   for (int level : {6, 8}) {
+      char name[64];
+      std::snprintf(name, sizeof(name), "icosphere level %d", level);
+      bench_report(name, bench_time([&] { planet_generate(level, 1.0f); }), bench_time([&] { reference::icosphere(level); }));
+   }
+   noiseSettings terrain;
+   terrain.frequency = 2.0f;
+   bench_report("planet level 8 with fbm", bench_time([&] { planet_generate(8, 1.0f, terrain, 0.05f); }), 0.0);
+
+   // ------------------------------ MESH -------------------------------
+   for (int level : {0, 1, 4}) {
+      planetMesh mesh = planet_generate(level, 2.0f);
+      std::size_t vertices = mesh.vertexCount(), triangles = mesh.triangleCount();
+      char name[64];
+      std::snprintf(name, sizeof(name), "level %d counts", level);
+      bench_check(name, vertices == planet_vertexCount(level) && triangles == planet_triangleCount(level), double(vertices));
+
+      // Every edge is used once in each direction: closed, and the triangles all wind the same way
+      std::unordered_map<std::uint64_t, int> edges;
+      bool inRange = true;
+      for (std::size_t t = 0; t < triangles; t++)
+         for (int k = 0; k < 3; k++) {
+            int a = mesh.indices[t * 3 + k], b = mesh.indices[t * 3 + (k + 1) % 3];
+            inRange &= a >= 0 && std::size_t(a) < vertices;
+            edges[(std::uint64_t(std::uint32_t(a)) << 32) | std::uint32_t(b)]++;
+         }
+      bool closed = inRange;
+      for (const auto& [key, count] : edges) closed &= count == 1 && edges.count((key << 32) | (key >> 32)) == 1;
+      std::snprintf(name, sizeof(name), "level %d closed", level);
+      bench_check(name, closed, double(edges.size()));
+      // Euler: V - E + F = 2 on a sphere
+      std::snprintf(name, sizeof(name), "level %d euler", level);
+      bench_check(name, vertices - edges.size() / 2 + triangles == 2, double(vertices - edges.size() / 2 + triangles));
+
+      // Outward winding, radius and normals
+      bool outward = true;
+      double radius = 0.0, normal = 0.0;
+      for (std::size_t t = 0; t < triangles; t++) {
+         vec3 a = mesh.position(mesh.indices[t * 3]), b = mesh.position(mesh.indices[t * 3 + 1]), c = mesh.position(mesh.indices[t * 3 + 2]);
+         outward &= (b - a).cross(c - a).dot(a + b + c) > 0.0f;
+      }
+      for (std::size_t v = 0; v < vertices; v++) {
+         radius = std::fmax(radius, std::fabs(mesh.position(v).mag() - 2.0f));
+         normal = std::fmax(normal, 1.0 - mesh.normal(v).dot(mesh.position(v).normal()));
+      }
+      std::snprintf(name, sizeof(name), "level %d outward", level);
+      bench_check(name, outward, 0);
+      std::snprintf(name, sizeof(name), "level %d on the sphere", level);
+      bench_check(name, radius < 1e-5, radius);
+      std::snprintf(name, sizeof(name), "level %d normals", level);
+      bench_check(name, normal < 0.01, normal);
+
+      // No duplicates, and exactly the points of the plain subdivision
+      std::vector<vec3> points(vertices);
+      for (std::size_t v = 0; v < vertices; v++) points[v] = mesh.position(v) / 2.0f;
+      std::sort(points.begin(), points.end(), less);
+      bool unique = std::adjacent_find(points.begin(), points.end(), equal) == points.end();
+      std::snprintf(name, sizeof(name), "level %d no duplicates", level);
+      bench_check(name, unique, 0);
+      reference::mesh plain = reference::icosphere(level);
+      std::sort(plain.positions.begin(), plain.positions.end(), less);
+      bool same = plain.positions.size() == points.size() && std::equal(points.begin(), points.end(), plain.positions.begin(), equal);
+      std::snprintf(name, sizeof(name), "level %d = plain subdivision", level);
+      bench_check(name, same, double(plain.positions.size()));
+   }
+
+   // Heights move the vertices along their direction and the threads never change the result
+   planetMesh a = planet_generate(5, 1.0f, terrain, 0.05f), b = planet_generate(5, 1.0f, terrain, 0.05f);
+   double error = 0.0;
+   for (std::size_t v = 0; v < a.vertexCount(); v++) {
+      vec3 p = a.position(v);
+      error = std::fmax(error, std::fabs(p.mag() - (1.0f + 0.05f * noise_sample(terrain, p.normal()))));
+   }
+   bench_check("heights from the noise", error < 1e-4, error);
+   bench_check("same mesh every time", a.vertices == b.vertices && a.indices == b.indices, 0);
+
+
+   // ------------------------------ TERRAIN -------------------------------
+   terrainSettings lod;
+   lod.terrain = terrain;
+   lod.capacity = 4096;
+   bench_report("terrain chunk 32x32", bench_time([&] { terrainTree::generate(lod, terrainTree::key(4, 5, 11, 17)); }), 0.0);
+
+   // About the same number of triangles from low orbit down to the ground
+   std::size_t fewest = ~std::size_t(0), most = 0;
+   for (float height : {1.0f, 0.3f, 0.1f, 0.03f, 0.01f, 0.003f, 0.001f}) {
+      terrainTree tree(lod);
+      auto start = std::chrono::steady_clock::now();
+      std::size_t triangles = settle(tree, height, lod.radius + lod.amplitude);
+      std::chrono::duration<double, std::milli> time = std::chrono::steady_clock::now() - start;
+      std::printf("height %-8g %8zu triangles %5zu chunks   all made in %8.1f ms\n", height, triangles, tree.selection().size(), time.count());
+      fewest = std::min(fewest, triangles);
+      most = std::max(most, triangles);
+   }
+   bench_check("terrain triangles even", most < 4 * fewest, double(most) / double(fewest));
+
+   // Without a frustum every point in sight is under exactly one chunk
+   {
+      terrainTree tree(lod);
+      const vec3 camera(0.0f, 0.0f, lod.radius + lod.amplitude + 0.01f);
+      const float scale = terrainTree::pixelScale(matrix_project(70.0f, 16.0f / 9.0f, 0.001f, 100.0f), 1080.0f);
+      std::vector<terrainChunk> finished;
+      std::vector<std::uint64_t> evicted;
+      for (int frame = 0; frame < 100000; frame++) {
+         tree.select(camera, scale);
+         tree.collect(64, finished, evicted);
+         if (finished.empty() && tree.idle()) break;
+      }
+      const std::vector<std::uint64_t>& drawn = tree.select(camera, scale);
+      randCounter random(5);
+      int wrong = 0, deepest = 0;
+      for (std::uint64_t chunk : drawn) deepest = std::max(deepest, terrainTree::level(chunk));
+      for (std::uint64_t i = 0; i < 20000; i++) {
+         // Up to about 12 degrees around the camera, well inside its horizon
+         vec3 d = (random.box(i, vec3(-0.15f, -0.15f, -0.15f), vec3(0.15f, 0.15f, 0.15f)) + vec3(0.0f, 0.0f, 1.0f)).normal();
+         int face;
+         float u, v;
+         cubePoint(d, face, u, v);
+         int covering = 0;
+         for (std::uint64_t chunk : drawn) {
+            float size = 2.0f / float(1u << terrainTree::level(chunk));
+            float u0 = -1.0f + terrainTree::x(chunk) * size, v0 = -1.0f + terrainTree::y(chunk) * size;
+            covering += terrainTree::face(chunk) == face && u >= u0 && u < u0 + size && v >= v0 && v < v0 + size;
+         }
+         wrong += covering != 1;
+      }
+      bench_check("terrain covers the ground once", wrong == 0 && deepest > 4, wrong);
+   }
+
+   // Neighbours of the same level share their edge exactly, where the level changes the gap is
+   // smaller than the skirt
+   {
+      const int n = lod.resolution, row = n + 1;
+      auto position = [&](const terrainChunk& c, int i, int j) {
+         const float* p = &c.vertices[(j * row + i) * 6];
+         return vec3(p[0], p[1], p[2]);
+      };
+      terrainChunk left = terrainTree::generate(lod, terrainTree::key(4, 3, 2, 3)), right = terrainTree::generate(lod, terrainTree::key(4, 3, 3, 3));
+      double seam = 0.0;
+      for (int j = 0; j <= n; j++) seam = std::fmax(seam, (position(left, n, j) - position(right, 0, j)).mag());
+      bench_check("terrain seam same level", seam < 1e-5, seam);
+
+      terrainChunk coarse = terrainTree::generate(lod, terrainTree::key(4, 2, 1, 1));
+      double gap = 0.0;
+      for (int half = 0; half < 2; half++) {
+         terrainChunk fine = terrainTree::generate(lod, terrainTree::key(4, 3, 4, 2 + half));
+         for (int j = 0; j <= n; j++) {
+            // Fine vertex j sits at coarse j / 2 of its half, between two coarse vertices when odd
+            int c = half * n / 2 + j / 2;
+            vec3 edge = j & 1 ? (position(coarse, n, c) + position(coarse, n, c + 1)) * 0.5f : position(coarse, n, c);
+            gap = std::fmax(gap, (position(fine, 0, j) - edge).mag());
+         }
+      }
+      float skirt = lod.skirt * lod.radius * 1.5707963f * (2.0f / 4.0f);
+      bench_check("terrain gap under skirt", gap < skirt, gap / skirt);
+   }
+
+   return bench_finish("Planet");
+}
@@ -0,0 +1,348 @@
+//////////////////////////////////////////////////////////////////
+// Microbenchmark of random.hpp against the generators it replaced, of the bulk randBatch against
+// per value calls and of the counter based randCounter, with quality checks (uniformity, range and
+// reproducibility). Exits with 1 if a check fails
+// Usage: random_bench [repetitions] (Default: 5, the best repetition is reported)
+//////////////////////////////////////////////////////////////////
+#include "utils/parallel.hpp"
+#include "utils/random.hpp"
+#include "bench.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <vector>
+
+
+// The functions as they were, a random_device and a new engine for every number
+namespace legacy {
+
+int iRand(int min, int max) {
+   std::random_device rd;
+   std::minstd_rand gen(rd());
+   std::uniform_int_distribution<> distr(min, max);
+   return distr(gen);
+}
+
+float fRand(float min, float max) {
+   std::random_device rd;
+   std::minstd_rand gen(rd());
+   std::uniform_real_distribution<> distr(min, max);
+   return distr(gen);
+}
+
+// The old randObj, a seeded engine going through the std distributions
+struct randObj {
+   std::minstd_rand gen;
+   randObj(int seed) : gen(seed) {}
+   int iRand(int min, int max) { std::uniform_int_distribution<> distr(min, max); return distr(gen); }
+   float fRand(float min, float max) { std::uniform_real_distribution<> distr(min, max); return distr(gen); }
+};
+
+}
+
+
+// randBatch written out one lane at a time, the SIMD builds have to match it exactly
+namespace reference {
+
+struct batch {
+   std::uint32_t s[4][8];
+
+   batch(std::uint64_t seed) {
+      for (int lane = 0; lane < 8; lane++)
+         for (int word = 0; word < 4; word += 2) {
+            std::uint64_t z = xoshiro256::splitmix64(seed);
+            s[word][lane] = std::uint32_t(z);
+            s[word + 1][lane] = std::uint32_t(z >> 32);
+         }
+   }
+
+   std::uint32_t next(int lane) {
+      std::uint32_t* w[4] = {&s[0][lane], &s[1][lane], &s[2][lane], &s[3][lane]};
+      std::uint32_t x = *w[1] * 5;
+      std::uint32_t result = ((x << 7) | (x >> 25)) * 9;
+      std::uint32_t t = *w[1] << 9;
+      *w[2] ^= *w[0]; *w[3] ^= *w[1]; *w[1] ^= *w[2]; *w[0] ^= *w[3];
+      *w[2] ^= t;
+      *w[3] = (*w[3] << 11) | (*w[3] >> 21);
+      return result;
+   }
+
+   // Value i of a call comes from lane i % 8, the lanes of an unfinished last group are still stepped
+   void bits(std::uint32_t* out, std::size_t count) {
+      for (std::size_t first = 0; first < count; first += 8)
+         for (int lane = 0; lane < 8; lane++) {
+            std::uint32_t value = next(lane);
+            if (first + lane < count) out[first + lane] = value;
+         }
+   }
+};
+
+}
+
+
+// Best time per call in nanoseconds of calls numbers made by f
+template <typename F>
+static double perCall(std::size_t calls, F f) {
+   return bench_time([&] {
+      for (std::size_t i = 0; i < calls; i++) f();
+   }) * 1e6 / double(calls);
+}
+
+static void report(const char* name, double ns, double before) {
+   bench_report(name, ns, before, before / ns, "ns/call");
+}
+
+// Chi-squared of a histogram of iRand(0, bins - 1) against a uniform distribution
+template <typename F>
+static double chiSquared(int bins, std::size_t samples, F draw) {
+   std::vector<std::size_t> counts(bins, 0);
+   for (std::size_t i = 0; i < samples; i++) counts[draw(bins)]++;
+   double expected = double(samples) / bins, chi = 0.0;
+   for (std::size_t count : counts) chi += (count - expected) * (count - expected) / expected;
+   return chi;
+}
+
+
+int main(int argc, char** argv) {
+   bench_start(argc, argv);
+
+   const std::size_t calls = 1 << 22;
+   // Results are summed so the calls are not optimized away
+   volatile float floatSink = 0.0f;
+   volatile int intSink = 0;
+   float fs = 0.0f;
+   int is = 0;
+
+   // ------------------------------ SPEED -------------------------------
+   // The old free functions open the random device every call, far fewer calls are enough
+   double before = perCall(calls >> 8, [&] { is += legacy::iRand(0, 100); });
+   double now = perCall(calls, [&] { is += iRand(0, 100); });
+   report("iRand", now, before);
+   before = perCall(calls >> 8, [&] { fs += legacy::fRand(-1.0f, 1.0f); });
+   now = perCall(calls, [&] { fs += fRand(-1.0f, 1.0f); });
+   report("fRand", now, before);
+
+   legacy::randObj oldObj(1234);
+   randObj obj(1234);
+   before = perCall(calls, [&] { is += oldObj.iRand(0, 100); });
+   now = perCall(calls, [&] { is += obj.iRand(0, 100); });
+   report("randObj::iRand", now, before);
+   before = perCall(calls, [&] { fs += oldObj.fRand(-1.0f, 1.0f); });
+   now = perCall(calls, [&] { fs += obj.fRand(-1.0f, 1.0f); });
+   report("randObj::fRand", now, before);
+
+   // The bare generators, 64 bits per call
+   std::mt19937_64 mt(1234);
+   xoshiro256 xs(1234);
+   std::uint64_t bits = 0;
+   report("std::mt19937_64", perCall(calls, [&] { bits += mt(); }), 0.0);
+   report("xoshiro256", perCall(calls, [&] { bits += xs(); }), 0.0);
+
+   // Every thread has its own generator so the free functions scale with the cores
+   std::atomic<long long> total(0);
+   auto start = std::chrono::steady_clock::now();
+   const std::size_t parallelCalls = calls * 8;
+   parallel_for(parallelCalls, 1 << 16, [&](std::size_t begin, std::size_t end) {
+      long long sum = 0;
+      for (std::size_t i = begin; i < end; i++) sum += iRand(0, 100);
+      total += sum;
+   });
+   std::chrono::duration<double, std::nano> time = std::chrono::steady_clock::now() - start;
+   std::printf("%-30s %9.2f ns/call   (all threads)\n", "iRand parallel", time.count() / parallelCalls);
+   floatSink = fs;
+   intSink = is + int(bits) + int(total);
+
+   // ------------------------------ QUALITY -------------------------------
+   // Chi-squared limits at p = 0.001: 27.88 for 9 degrees of freedom and about 1143 for 999
+   const std::size_t samples = 1 << 22;
+   randObj quality(42);
+   double chi = chiSquared(10, samples, [&](int bins) { return quality.iRand(0, bins - 1); });
+   bench_check("iRand 10 bins chi-squared", chi < 27.88, chi);
+   chi = chiSquared(1000, samples, [&](int bins) { return quality.iRand(0, bins - 1); });
+   bench_check("iRand 1000 bins chi-squared", chi < 1143.0, chi);
+   chi = chiSquared(1000, samples, [&](int bins) { return std::min(bins - 1, int(quality.fRand(0.0f, float(bins)))); });
+   bench_check("fRand 1000 bins chi-squared", chi < 1143.0, chi);
+
+   // Ranges: iRand includes both ends, fRand never returns max
+   int low = 1 << 30, high = -(1 << 30);
+   float lowF = 1e30f, highF = -1e30f;
+   double mean = 0.0;
+   for (std::size_t i = 0; i < samples; i++) {
+      int n = quality.iRand(-3, 5);
+      low = std::min(low, n); high = std::max(high, n);
+      float f = quality.fRand(-3.0f, 5.0f);
+      lowF = std::fmin(lowF, f); highF = std::fmax(highF, f);
+      mean += f;
+   }
+   mean /= samples;
+   bench_check("iRand(-3, 5) range", low == -3 && high == 5, high - low);
+   bench_check("fRand(-3, 5) range", lowF >= -3.0f && highF < 5.0f, highF - lowF);
+   bench_check("fRand(-3, 5) mean", std::fabs(mean - 1.0) < 0.01, mean);
+   // The whole int range has no bound to apply, both signs have to show up
+   int negative = 0;
+   for (int i = 0; i < 1000; i++) negative += quality.iRand(std::numeric_limits<int>::min(), std::numeric_limits<int>::max()) < 0;
+   bench_check("iRand full int range", negative > 400 && negative < 600, negative);
+
+   // The same seed has to give the same numbers, different ones must not
+   randObj a(7), b(7), c(8);
+   bool same = true, different = false;
+   for (int i = 0; i < 1000; i++) {
+      int x = a.iRand(0, 1 << 20);
+      same &= x == b.iRand(0, 1 << 20);
+      different |= x != c.iRand(0, 1 << 20);
+   }
+   bench_check("same seed, same numbers", same && different, 1000);
+
+   // ------------------------------ BULK -------------------------------
+   const std::size_t bulk = 1 << 20;
+   std::vector<float> floats(bulk);
+   std::vector<int> ints(bulk);
+   std::vector<vec3> points(bulk);
+   randBatch batch(1234);
+   randObj single(1234);
+   std::normal_distribution<float> gaussian(0.0f, 1.0f);
+   auto bulkTime = [&](auto f) { return perCall(1, f) / bulk; };
+
+   report("randBatch::uniform float", bulkTime([&] { batch.uniform(floats.data(), bulk, -1.0f, 1.0f); }),
+          bulkTime([&] { for (float& f : floats) f = single.fRand(-1.0f, 1.0f); }));
+   report("randBatch::uniform int", bulkTime([&] { batch.uniform(ints.data(), bulk, 0, 999); }),
+          bulkTime([&] { for (int& n : ints) n = single.iRand(0, 999); }));
+   report("randBatch::normal", bulkTime([&] { batch.normal(floats.data(), bulk); }),
+          bulkTime([&] { for (float& f : floats) f = gaussian(single.gen); }));
+   report("randBatch::sphere", bulkTime([&] { batch.sphere(points.data(), bulk); }),
+          bulkTime([&] { for (vec3& p : points) p = vec3(gaussian(single.gen), gaussian(single.gen), gaussian(single.gen)).normal(); }));
+   report("randBatch::box", bulkTime([&] { batch.box(points.data(), bulk, vec3(-1.0f, 0.0f, 2.0f), vec3(1.0f, 5.0f, 3.0f)); }),
+          bulkTime([&] { for (vec3& p : points) p = vec3(single.fRand(-1.0f, 1.0f), single.fRand(0.0f, 5.0f), single.fRand(2.0f, 3.0f)); }));
+
+   // Same numbers as the one lane at a time version, across calls with partial groups too
+   randBatch lanes(99);
+   reference::batch expected(99);
+   bool match = true;
+   for (std::size_t count : {1003, 16, 5, 4096}) {
+      std::vector<std::uint32_t> got(count), want(count);
+      lanes.bits(got.data(), count);
+      expected.bits(want.data(), count);
+      match &= got == want;
+   }
+   bench_check("randBatch matches lanes", match, 0);
+
+   // The float transforms too: known answers (FNV-1a of the output bits) that AVX2, SSE and scalar
+   // builds all have to give. normal and sphere also depend on log, sin and cos of the C library
+   // (these are from glibc)
+   auto hash = [](const void* data, std::size_t bytes) {
+      std::uint64_t h = 0xcbf29ce484222325ull;
+      for (std::size_t i = 0; i < bytes; i++) h = (h ^ ((const unsigned char*)data)[i]) * 0x100000001b3ull;
+      return h;
+   };
+   const std::size_t knownCount = 1003;
+   randBatch fixed(2024);
+   fixed.uniform(floats.data(), knownCount, -3.0f, 5.0f);
+   std::uint64_t uniformHash = hash(floats.data(), knownCount * sizeof(float));
+   fixed.uniform(ints.data(), knownCount, -1000, 1000);
+   std::uint64_t intHash = hash(ints.data(), knownCount * sizeof(int));
+   fixed.normal(floats.data(), knownCount, 2.0f, 3.0f);
+   std::uint64_t normalHash = hash(floats.data(), knownCount * sizeof(float));
+   fixed.sphere(points.data(), knownCount);
+   std::uint64_t sphereHash = hash(points.data(), knownCount * sizeof(vec3));
+   fixed.box(points.data(), knownCount, vec3(-1.0f, 0.0f, 2.0f), vec3(1.0f, 5.0f, 3.0f));
+   std::uint64_t boxHash = hash(points.data(), knownCount * sizeof(vec3));
+   bench_check("randBatch float answers", uniformHash == 0xbf0d9369493d326dull, 0);
+   bench_check("randBatch int answers", intHash == 0xb01d2992944a6c8aull, 0);
+   bench_check("randBatch normal answers", normalHash == 0x25e289b48bb84456ull, 0);
+   bench_check("randBatch sphere answers", sphereHash == 0xd1f1faf86662b469ull, 0);
+   bench_check("randBatch box answers", boxHash == 0xf6fa13610fe5bbafull, 0);
+
+   randBatch quality2(42);
+   quality2.uniform(ints.data(), bulk, -3, 5);
+   bench_check("uniform int range", *std::min_element(ints.begin(), ints.end()) == -3 && *std::max_element(ints.begin(), ints.end()) == 5, 8);
+   quality2.uniform(ints.data(), bulk, 0, 999);
+   chi = chiSquared(1000, bulk, [&, i = std::size_t(0)](int) mutable { return ints[i++]; });
+   bench_check("uniform int chi-squared", chi < 1143.0, chi);
+   // A range of 3e9 makes 30% of the draws land in the biased part and go through the retries
+   quality2.uniform(ints.data(), bulk, -2000000000, 1000000000);
+   double positive = double(std::count_if(ints.begin(), ints.end(), [](int n) { return n > 0; })) / bulk;
+   bench_check("uniform int wide range", std::fabs(positive - 1.0 / 3.0) < 0.005, positive);
+
+   quality2.uniform(floats.data(), bulk, -3.0f, 5.0f);
+   bench_check("uniform float range", *std::min_element(floats.begin(), floats.end()) >= -3.0f && *std::max_element(floats.begin(), floats.end()) < 5.0f, 8);
+
+   quality2.normal(floats.data(), bulk, 2.0f, 3.0f);
+   double sum = 0.0, squares = 0.0;
+   for (float f : floats) { sum += f; squares += (f - 2.0) * (f - 2.0); }
+   bench_check("normal mean", std::fabs(sum / bulk - 2.0) < 0.02, sum / bulk);
+   bench_check("normal deviation", std::fabs(std::sqrt(squares / bulk) - 3.0) < 0.02, std::sqrt(squares / bulk));
+
+   quality2.sphere(points.data(), bulk);
+   double length = 0.0;
+   vec3 center;
+   for (const vec3& p : points) { length = std::fmax(length, std::fabs(p.mag() - 1.0f)); center += p / float(bulk); }
+   bench_check("sphere on unit sphere", length < 1e-5, length);
+   bench_check("sphere centered", center.mag() < 0.01f, center.mag());
+
+   quality2.box(points.data(), bulk, vec3(-1.0f, 0.0f, 2.0f), vec3(1.0f, 5.0f, 3.0f));
+   bool inside = true;
+   for (const vec3& p : points) inside &= p.x >= -1.0f && p.x < 1.0f && p.y >= 0.0f && p.y < 5.0f && p.z >= 2.0f && p.z < 3.0f;
+   bench_check("box inside", inside, 0);
+
+   // ------------------------------ COUNTER -------------------------------
+   // Known answers of Philox4x32-10 from the Random123 test vectors, counter (index, stream) and key seed
+   struct { std::uint64_t seed, stream, index; std::uint32_t out[4]; } known[] = {
+      {0, 0, 0, {0x6627e8d5, 0xe169c58d, 0xbc57ac4c, 0x9b00dbd8}},
+      {~std::uint64_t(0), ~std::uint64_t(0), ~std::uint64_t(0), {0x408f276d, 0x41c83b0e, 0xa20bc7c6, 0x6d5451fd}},
+      {0x299f31d0a4093822, 0x0370734413198a2e, 0x85a308d3243f6a88, {0xd16cfe09, 0x94fdcceb, 0x5001e420, 0x24126ea1}},
+   };
+   bool answers = true;
+   for (const auto& k : known) {
+      std::uint32_t out[4];
+      randCounter(k.seed, k.stream).block(k.index, out);
+      answers &= std::equal(out, out + 4, k.out);
+   }
+   bench_check("randCounter known answers", answers, 0);
+
+   // Split over threads in small uneven pieces (and across a wrap of the low counter word) it has
+   // to give exactly what one serial loop gives
+   randCounter counter(1234, 3);
+   std::vector<std::uint32_t> serial(bulk), threaded(bulk);
+   const std::uint64_t origin = 0xFFFFF000ull;
+   for (std::size_t i = 0; i < bulk; i++) serial[i] = counter.bits(origin + i);
+   parallel_for(bulk, 997, [&](std::size_t begin, std::size_t end) { counter.bits(threaded.data() + begin, origin + begin, end - begin); });
+   bench_check("randCounter parallel = serial", serial == threaded, 0);
+   counter.uniform(floats.data(), 5, bulk, -3.0f, 5.0f);
+   bool sameFloats = true;
+   for (std::size_t i = 0; i < bulk; i++) sameFloats &= floats[i] == counter.fRand(5 + i, -3.0f, 5.0f);
+   bench_check("randCounter uniform = fRand", sameFloats, 0);
+   bench_check("randCounter float range", *std::min_element(floats.begin(), floats.end()) >= -3.0f && *std::max_element(floats.begin(), floats.end()) < 5.0f, 8);
+
+   chi = chiSquared(1000, samples, [&, i = std::uint64_t(0)](int bins) mutable { return counter.iRand(i++, 0, bins - 1); });
+   bench_check("randCounter iRand chi-squared", chi < 1143.0, chi);
+   // Ranges above 2^31: up to half the words are biased, so some indices use up all 4 words of
+   // their block. Has to return, stay in range and keep the halves even
+   int inRange = 0, upper = 0;
+   for (std::uint64_t i = 0; i < 1 << 16; i++) {
+      int n = randCounter(12345).iRand(i + 25, std::numeric_limits<int>::min(), (1 << 30) - 1);
+      inRange += n >= std::numeric_limits<int>::min() && n <= (1 << 30) - 1;
+      upper += n >= -(1 << 30);
+   }
+   bench_check("randCounter iRand wide range", inRange == 1 << 16 && std::fabs(double(upper) / (1 << 16) - 2.0 / 3.0) < 0.01, upper);
+   // Neighbouring streams and seeds must not be related, one bit flip changes about half the bits
+   double flipped = 0.0;
+   randCounter nextStream(1234, 4), nextSeed(1235, 3);
+   for (std::uint64_t i = 0; i < 1 << 16; i++)
+      flipped += __builtin_popcount(counter.bits(i) ^ nextStream.bits(i)) + __builtin_popcount(counter.bits(i) ^ nextSeed.bits(i));
+   flipped /= 2.0 * 32.0 * (1 << 16);
+   bench_check("randCounter streams unrelated", std::fabs(flipped - 0.5) < 0.005, flipped);
+
+   report("randCounter::fRand", bulkTime([&] { for (std::size_t i = 0; i < bulk; i++) floats[i] = counter.fRand(i, -1.0f, 1.0f); }),
+          bulkTime([&] { for (float& f : floats) f = single.fRand(-1.0f, 1.0f); }));
+   report("randCounter::uniform", bulkTime([&] { counter.uniform(floats.data(), 0, bulk, -1.0f, 1.0f); }),
+          bulkTime([&] { batch.uniform(floats.data(), bulk, -1.0f, 1.0f); }));
+
+   (void)floatSink;
+   (void)intSink;
+   return bench_finish("Quality");
+}
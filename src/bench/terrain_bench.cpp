@@ -0,0 +1,169 @@
+//////////////////////////////////////////////////////////////////
+// Terrain chunks made by the compute program of gl_terrain against terrainTree::generate on the
+// CPU: the time per chunk and checks that both give the same vertices, for every kind of noise.
+// Then the tile map: its program links, a few changed tiles upload a few bytes and the picture
+// shows the state of the tiles.
+// Needs a GL 4.5 context, LIBGL_ALWAYS_SOFTWARE=1 runs it on Mesa llvmpipe without a GPU.
+// Exits with 1 if a check fails
+// Usage: terrain_bench
+//////////////////////////////////////////////////////////////////
+#include "glTerrain.hpp"
+#include "glTileMap.hpp"
+#include "bench.hpp"
+
+#include <glad/glad.h>
+#include <GLFW/glfw3.h>
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <vector>
+
+
+int main() {
+   // A small hidden window is enough for the context
+   glfwInit();
+   glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 4);
+   glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 5);
+   glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
+   glfwWindowHint(GLFW_VISIBLE, GLFW_FALSE);
+   GLFWwindow* window = glfwCreateWindow(64, 64, "terrain_bench", NULL, NULL);
+   if (!window) {
+      std::printf("No GL 4.5 context\n");
+      return 1;
+   }
+   glfwMakeContextCurrent(window);
+   gladLoadGL();
+   std::printf("%s, %s\n", (const char*)glGetString(GL_RENDERER), (const char*)glGetString(GL_VERSION));
+
+   gl_programCache cache;
+   cache.enabled = false;
+   gl_programBuilder programs(cache);
+
+   struct layer {
+      const char* name;
+      noiseSettings noise;
+   };
+   std::vector<layer> layers(3);
+   layers[0].name = "simplex fbm warped";
+   layers[0].noise.frequency = 2.0f;
+   layers[0].noise.warp = 0.3f;
+   layers[1].name = "simplex ridged";
+   layers[1].noise.fractal = NOISE_RIDGED;
+   layers[1].noise.frequency = 3.0f;
+   layers[1].noise.seed = 7;
+   layers[2].name = "value fbm";
+   layers[2].noise.type = NOISE_VALUE;
+   layers[2].noise.frequency = 4.0f;
+
+   for (const layer& l : layers) {
+      terrainSettings lod;
+      lod.terrain = l.noise;
+      lod.vertices = false;
+      terrainTree tree(lod);
+      gl_terrain terrain(tree, &programs);
+
+      // Down from a low orbit until every chunk it asks for is there, the GPU time is the
+      // dispatches up to the glFinish
+      const vec3 camera(0.3f, 0.2f, lod.radius + lod.amplitude + 0.05f);
+      const float scale = terrainTree::pixelScale(matrix_project(70.0f, 16.0f / 9.0f, 0.001f, 100.0f), 1080.0f);
+      double gpu = 0.0;
+      std::size_t made = 0;
+      for (int frame = 0; frame < 100000; frame++) {
+         tree.select(camera, scale);
+         auto start = std::chrono::steady_clock::now();
+         std::size_t uploaded = terrain.update(64);
+         glFinish();
+         std::chrono::duration<double, std::milli> time = std::chrono::steady_clock::now() - start;
+         gpu += time.count();
+         made += uploaded;
+         if (uploaded == 0 && tree.idle()) break;
+      }
+      const std::vector<std::uint64_t> drawn = tree.select(camera, scale);
+
+      // The same chunks on the CPU
+      terrainSettings reference = lod;
+      reference.vertices = true;
+      double position = 0.0, normal = 0.0, cpu = 0.0;
+      int deepest = 0;
+      for (std::uint64_t key : drawn) {
+         auto start = std::chrono::steady_clock::now();
+         terrainChunk chunk = terrainTree::generate(reference, key);
+         std::chrono::duration<double, std::milli> time = std::chrono::steady_clock::now() - start;
+         cpu += time.count();
+         std::vector<float> vertices = terrain.readBack(key);
+         for (std::size_t v = 0; v < vertices.size(); v += 6) {
+            const float* a = &vertices[v];
+            const float* b = &chunk.vertices[v];
+            position = std::fmax(position, vec3(a[0] - b[0], a[1] - b[1], a[2] - b[2]).mag());
+            normal = std::fmax(normal, 1.0 - vec3(a[3], a[4], a[5]).dot(vec3(b[3], b[4], b[5])));
+         }
+         deepest = std::max(deepest, terrainTree::level(key));
+      }
+
+      std::printf("%s: %zu chunks down to level %d   cpu %.3f ms per chunk   compute %.3f ms per chunk\n", l.name, drawn.size(), deepest,
+                  cpu / double(drawn.size()), gpu / double(std::max<std::size_t>(made, 1)));
+      char name[64];
+      std::snprintf(name, sizeof(name), "%s positions", l.name);
+      bench_check(name, position < 1e-5 * lod.radius && !drawn.empty(), position);
+      std::snprintf(name, sizeof(name), "%s normals", l.name);
+      bench_check(name, normal < 1e-3, normal);
+   }
+
+   {
+      tileGrid grid = tiles_generate(3);
+      gl_tileMap map(grid, 0.9f, programs);
+      GLint linked = GL_FALSE;
+      glGetProgramiv(programs.get(map.program), GL_LINK_STATUS, &linked);
+      bench_check("tile map program", linked == GL_TRUE, linked);
+
+      // Snow and fully lit on the tile facing the camera, ocean everywhere else
+      const int front = grid.locate(vec3(0.0f, 0.0f, 1.0f));
+      map.set(front, {1, 6, 255, 0});
+      map.set(front == 0 ? 1 : 0, {2, 0, 0, 0});
+      map.set(int(grid.size()) - 1, {3, 0, 0, 0});
+      std::size_t bytes = map.upload();
+      bench_check("tile map upload 3 tiles", bytes == 3 * sizeof(gl_tileState), double(bytes));
+
+      GLuint fbo, color, depth;
+      glGenFramebuffers(1, &fbo);
+      glGenRenderbuffers(1, &color);
+      glGenRenderbuffers(1, &depth);
+      glBindRenderbuffer(GL_RENDERBUFFER, color);
+      glRenderbufferStorage(GL_RENDERBUFFER, GL_RGBA8, 128, 128);
+      glBindRenderbuffer(GL_RENDERBUFFER, depth);
+      glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH_COMPONENT24, 128, 128);
+      glBindFramebuffer(GL_FRAMEBUFFER, fbo);
+      glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_RENDERBUFFER, color);
+      glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_RENDERBUFFER, depth);
+      glViewport(0, 0, 128, 128);
+      glEnable(GL_DEPTH_TEST);
+      glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+
+      // Straight down -z onto the sphere: the identity with z flipped so the near side wins
+      const GLfloat mvp[16] = {1, 0, 0, 0, 0, 1, 0, 0, 0, 0, -1, 0, 0, 0, 0, 1};
+      const GLfloat identity[12] = {1, 0, 0, 0, 0, 1, 0, 0, 0, 0, 1, 0};
+      const GLfloat light[3] = {0.0f, 0.0f, 5.0f}, white[3] = {1.0f, 1.0f, 1.0f};
+      glUseProgram(programs.get(map.program));
+      glUniformMatrix4fv(programs.uniform(map.program, "mvp"), 1, GL_FALSE, mvp);
+      glUniformMatrix4x3fv(programs.uniform(map.program, "modelView"), 1, GL_TRUE, identity);
+      glUniformMatrix4x3fv(programs.uniform(map.program, "normalMatrix"), 1, GL_TRUE, identity);
+      glUniform3fv(programs.uniform(map.program, "lightPos"), 1, light);
+      glUniform3fv(programs.uniform(map.program, "lightCol"), 1, white);
+      map.draw();
+
+      unsigned char middle[4], side[4];
+      glReadPixels(64, 64, 1, 1, GL_RGBA, GL_UNSIGNED_BYTE, middle);
+      glReadPixels(64, 90, 1, 1, GL_RGBA, GL_UNSIGNED_BYTE, side);
+      bench_check("tile map lit tile", middle[0] > 200 && middle[1] > 200 && middle[2] > 200, middle[0]);
+      bench_check("tile map ocean tile", side[2] > 2 * side[0] && side[2] > 60, side[2]);
+      bench_check("tile map no GL error", glGetError() == GL_NO_ERROR, 0);
+      glBindFramebuffer(GL_FRAMEBUFFER, 0);
+      glDeleteFramebuffers(1, &fbo);
+      glDeleteRenderbuffers(1, &color);
+      glDeleteRenderbuffers(1, &depth);
+   }
+
+   glfwTerminate();
+   return bench_finish("Terrain");
+}
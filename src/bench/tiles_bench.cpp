@@ -0,0 +1,179 @@
+//////////////////////////////////////////////////////////////////
+// Microbenchmark of the tile grid (build time, point lookups against a search over every tile and
+// a pass over the neighbours of every tile), with checks of the grid: counts, symmetric and
+// ordered neighbours, corners between them, lookups that find the closest tile, the mesh the
+// tile map draws and the ranges it uploads for changed tiles.
+// Exits with 1 if a check fails
+// Usage: tiles_bench [repetitions] (Default: 5, the best repetition is reported)
+//////////////////////////////////////////////////////////////////
+#include "utils/random.hpp"
+#include "utils/tiles.hpp"
+#include "bench.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <vector>
+
+
+// Closest tile by looking at every one of them
+static int closest(const tileGrid& grid, const vec3& d) {
+   int best = 0;
+   float bestDot = -2.0f;
+   for (std::size_t t = 0; t < grid.size(); t++) {
+      float dot = grid.x[t] * d.x + grid.y[t] * d.y + grid.z[t] * d.z;
+      if (dot > bestDot) {
+         bestDot = dot;
+         best = int(t);
+      }
+   }
+   return best;
+}
+
+
+int main(int argc, char** argv) {
+   bench_start(argc, argv);
+
+   // ------------------------------ SPEED -------------------------------
+   bench_report("tiles level 6 (40962)", bench_time([] { tiles_generate(6); }), 0.0);
+   bench_report("tiles level 8 (655362)", bench_time([] { tiles_generate(8); }), 0.0);
+   {
+      auto start = std::chrono::steady_clock::now();
+      tileGrid big = tiles_generate(9);
+      std::chrono::duration<double, std::milli> time = std::chrono::steady_clock::now() - start;
+      std::printf("%-30s %9.2f ms   (one run, %zu tiles)\n", "tiles level 9", time.count(), big.size());
+   }
+
+   tileGrid grid = tiles_generate(8);
+   randCounter random(3);
+   const std::size_t queries = 1 << 20;
+   std::vector<vec3> points(queries);
+   for (std::size_t i = 0; i < queries; i++) points[i] = random.box(i, vec3(-1.0f, -1.0f, -1.0f), vec3(1.0f, 1.0f, 1.0f));
+   std::vector<int> found(queries);
+   double lookup = bench_time([&] {
+      for (std::size_t i = 0; i < queries; i++) found[i] = grid.locate(points[i]);
+   });
+   double search = bench_time([&] {
+      for (std::size_t i = 0; i < 16; i++) found[i] = closest(grid, points[i]);
+   }) * double(queries) / 16.0;
+   bench_report("locate 1M points level 8", lookup, search);
+
+   // A pass that reads the neighbours of every tile, the way a simulation step does
+   std::vector<float> value(grid.size()), next(grid.size());
+   for (std::size_t t = 0; t < grid.size(); t++) value[t] = random.fRand(t, 0.0f, 1.0f);
+   double pass = bench_time([&] {
+      for (std::size_t t = 0; t < grid.size(); t++) {
+         float sum = 0.0f;
+         for (int k = grid.offsets[t]; k < grid.offsets[t + 1]; k++) sum += value[grid.neighbors[k]];
+         next[t] = sum / float(grid.degree(int(t)));
+      }
+   });
+   std::printf("%-30s %9.2f ms   %6.2f ns per tile\n", "neighbour pass level 8", pass, pass * 1e6 / double(grid.size()));
+
+   // ------------------------------ GRID -------------------------------
+   for (int level : {0, 1, 5}) {
+      tileGrid g = tiles_generate(level);
+      const std::size_t tiles = g.size();
+      char name[64];
+
+      int pentagons = 0, hexagons = 0;
+      for (std::size_t t = 0; t < tiles; t++) {
+         pentagons += g.degree(int(t)) == 5;
+         hexagons += g.degree(int(t)) == 6;
+      }
+      std::snprintf(name, sizeof(name), "level %d counts", level);
+      bench_check(name, tiles == tiles_count(level) && pentagons == 12 && std::size_t(hexagons) == tiles - 12, double(tiles));
+      // Euler with the corners as vertices and the tiles as faces: C - E + F = 2
+      std::snprintf(name, sizeof(name), "level %d euler", level);
+      long euler = long(g.cornerCount()) - long(g.neighbors.size() / 2) + long(tiles);
+      bench_check(name, euler == 2, double(euler));
+
+      // Every neighbour lists the tile back, and they go counter clockwise around it
+      int asymmetric = 0, clockwise = 0, misplaced = 0;
+      double corner = 0.0;
+      for (std::size_t t = 0; t < tiles; t++) {
+         vec3 c = g.center(int(t));
+         int first = g.offsets[t], count = g.degree(int(t));
+         for (int k = 0; k < count; k++) {
+            int n = g.neighbors[first + k], m = g.neighbors[first + (k + 1) % count];
+            bool back = false;
+            for (int l = g.offsets[n]; l < g.offsets[n + 1]; l++) back |= g.neighbors[l] == int(t);
+            asymmetric += !back;
+            clockwise += c.dot((g.center(n) - c).cross(g.center(m) - c)) <= 0.0f;
+            // The corner between two neighbours is the middle of the triangle of the three tiles
+            vec3 expected = (c + g.center(n) + g.center(m)).normal();
+            double error = (g.corner(g.corners[first + k]) - expected).mag();
+            corner = std::fmax(corner, error);
+            misplaced += error > 1e-5;
+         }
+      }
+      std::snprintf(name, sizeof(name), "level %d symmetric", level);
+      bench_check(name, asymmetric == 0, asymmetric);
+      std::snprintf(name, sizeof(name), "level %d counter clockwise", level);
+      bench_check(name, clockwise == 0, clockwise);
+      std::snprintf(name, sizeof(name), "level %d corners", level);
+      bench_check(name, misplaced == 0, corner);
+   }
+
+   // The lookup finds the closest center, also from a bad start (a tile as close as the closest
+   // one is fine, two centers can round to the same distance)
+   {
+      tileGrid g = tiles_generate(6);
+      auto farther = [](const tileGrid& grid, int tile, const vec3& d) { return grid.center(tile).dot(d) < grid.center(closest(grid, d)).dot(d); };
+      int wrong = 0;
+      for (std::size_t i = 0; i < 4000; i++) {
+         vec3 d = random.box(i + queries, vec3(-1.0f, -1.0f, -1.0f), vec3(1.0f, 1.0f, 1.0f));
+         wrong += farther(g, g.locate(d), d);
+         wrong += farther(g, g.locate(d, int(i % g.size())), d);
+      }
+      bench_check("locate = closest level 6", wrong == 0, wrong);
+      int wrongBig = 0;
+      for (std::size_t i = 0; i < 200; i++) wrongBig += farther(grid, grid.locate(points[i]), points[i]);
+      bench_check("locate = closest level 8", wrongBig == 0, wrongBig);
+   }
+
+   // The mesh: a fan per tile, every triangle of one tile and facing out
+   {
+      tileGrid g = tiles_generate(5);
+      std::vector<tileVertex> vertices;
+      std::vector<int> indices;
+      auto start = std::chrono::steady_clock::now();
+      tiles_mesh(g, 2.0f, vertices, indices);
+      std::chrono::duration<double, std::milli> time = std::chrono::steady_clock::now() - start;
+      std::printf("%-30s %9.2f ms   (%zu vertices)\n", "tile mesh level 5", time.count(), vertices.size());
+      bench_check("mesh counts", vertices.size() == g.size() * 7 - 12 && indices.size() == g.neighbors.size() * 3, double(vertices.size()));
+      int mixed = 0, inward = 0;
+      for (std::size_t i = 0; i < indices.size(); i += 3) {
+         const tileVertex& a = vertices[indices[i]];
+         const tileVertex& b = vertices[indices[i + 1]];
+         const tileVertex& c = vertices[indices[i + 2]];
+         mixed += a.tile != b.tile || a.tile != c.tile || a.edge != 0.0f || b.edge != 1.0f || c.edge != 1.0f;
+         vec3 pa(a.x, a.y, a.z), pb(b.x, b.y, b.z), pc(c.x, c.y, c.z);
+         inward += (pb - pa).cross(pc - pa).dot(pa) <= 0.0f;
+      }
+      bench_check("mesh one tile per triangle", mixed == 0, mixed);
+      bench_check("mesh counter clockwise", inward == 0, inward);
+   }
+
+   // Uploads of changed tiles, 4 byte states and the gap of gl_tileMap: scattered tiles are a range
+   // of 4 bytes each, close ones share one range
+   {
+      const int gap = 16;
+      std::vector<tileRange> ranges;
+      std::vector<int> scattered = {5000, 10, 900};
+      tiles_ranges(scattered, gap, 4, ranges);
+      bool apart = ranges.size() == 3;
+      const std::size_t expected[3] = {10, 900, 5000};
+      for (std::size_t r = 0; apart && r < 3; r++) apart = ranges[r].offset == expected[r] * 4 && ranges[r].size == 4;
+      bench_check("upload scattered tiles", apart, double(ranges.size()));
+
+      std::vector<int> close = {116, 100, 105, 100 + 16 + 17};
+      tiles_ranges(close, gap, 4, ranges);
+      bool merged = ranges.size() == 2 && ranges[0].offset == 400 && ranges[0].size == 17 * 4 && ranges[1].offset == 133 * 4 && ranges[1].size == 4;
+      bench_check("upload close tiles merge", merged, double(ranges.size()));
+   }
+
+   return bench_finish("Tiles");
+}
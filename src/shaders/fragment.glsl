@@ -1,4 +1,5 @@
 #version 450 core
+#include "lighting.glsl"
 
 uniform vec3 lightPos;
 uniform vec3 lightCol;
@@ -6,23 +7,20 @@ uniform vec3 objCol;
 
 in vec3 fragPos;
 in vec2 TexCoord;
+#ifdef WITH_NORMALS
+in vec3 normal;
+#endif
 
 out vec4 FragColor;
 
 void main()
 {
-
-   float ambientStrength = 0.2;
-   vec3 ambient = ambientStrength * lightCol;
-   
+#ifdef WITH_NORMALS
+   vec3 norm = normalize(normal);
+#else
+   // Flat shading from the screen space derivatives when the mesh has no normals
    vec3 norm = normalize(cross(dFdx(fragPos), dFdy(fragPos)));
+#endif
 
-   // vec3 norm = normalize(normal);
-   vec3 lightDir = normalize(lightPos - fragPos); 
-   float diff = max(dot(norm, lightDir), 0.0);
-   vec3 diffuse = diff * lightCol;
-
-   vec3 result = (ambient + diffuse) * objCol;
-
-   FragColor = vec4(result,1.0);
+   FragColor = vec4(lighting(fragPos, norm, lightPos, lightCol, objCol), 1.0);
 }
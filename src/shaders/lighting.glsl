@@ -0,0 +1,14 @@
+// Ambient + diffuse lighting shared by the mesh shaders
+
+const float ambientStrength = 0.2;
+
+vec3 lighting(vec3 fragPos, vec3 norm, vec3 lightPos, vec3 lightCol, vec3 objCol)
+{
+   vec3 ambient = ambientStrength * lightCol;
+
+   vec3 lightDir = normalize(lightPos - fragPos); 
+   float diff = max(dot(norm, lightDir), 0.0);
+   vec3 diffuse = diff * lightCol;
+
+   return (ambient + diffuse) * objCol;
+}
@@ -0,0 +1,145 @@
+// The 3D noise of src/utils/noise.cpp, written the same way step by step so the GPU gives the same
+// values as noise_sample (up to the rounding of the floats)
+
+// noiseType and noiseFractal
+#define NOISE_SIMPLEX 0
+#define NOISE_VALUE 1
+#define NOISE_SINGLE 0
+#define NOISE_FBM 1
+#define NOISE_RIDGED 2
+
+// Same fields as noiseSettings, set with the uniform names "<name>.type", "<name>.frequency" ...
+struct noiseSettings {
+   int type;
+   int fractal;
+   int octaves;
+   float frequency;
+   float lacunarity;
+   float gain;
+   float warp;
+   uint seed;
+};
+
+
+// Hash of a lattice point, one multiply per axis and a final mix
+uint noise_hash(uint seed, uvec3 cell)
+{
+   uint h = seed;
+   h = h ^ cell.x * 501125321u;
+   h = h ^ cell.y * 1136930381u;
+   h = h ^ cell.z * 1720413743u;
+   h = h * 0x27d4eb2du;
+   return h ^ (h >> 15);
+}
+
+// x with the sign flipped where the given bit of h is set
+float noise_flip(float x, uint h, int bit)
+{
+   return uintBitsToFloat(floatBitsToUint(x) ^ ((h << (31 - bit)) & 0x80000000u));
+}
+
+// The 12 edges of a cube (Perlin's improved noise)
+float noise_grad(uint h, float x, float y, float z)
+{
+   uint c = h & 15u;
+   float u = c < 8u ? x : y;
+   float v = c < 4u ? y : ((c & 13u) == 12u ? x : z);
+   return noise_flip(u, h, 0) + noise_flip(v, h, 1);
+}
+
+// (0.5 - r^2)^4 so nothing reaches past the neighbouring simplices
+float noise_falloff(float t)
+{
+   t = max(t, 0.0f);
+   t = t * t;
+   return t * t;
+}
+
+uvec3 noise_cell(vec3 f)
+{
+   return uvec3(ivec3(f));
+}
+
+
+float noise_simplex(vec3 p, uint seed)
+{
+   const float skew = 1.0f / 3.0f, unskew = 1.0f / 6.0f;
+   float s = (p.x + p.y + p.z) * skew;
+   vec3 f = floor(p + s);
+   float t = (f.x + f.y + f.z) * unskew;
+   vec3 p0 = p - (f - t);
+   // Rank of every axis, the simplex walks from the largest coordinate to the smallest (ties go to the first axis)
+   float rx = float(p0.x > p0.y) + float(p0.x > p0.z);
+   float ry = float(p0.y >= p0.x) + float(p0.y > p0.z);
+   float rz = float(p0.z >= p0.x) + float(p0.z >= p0.y);
+   vec3 c1 = vec3(float(rx > 1.5f), float(ry > 1.5f), float(rz > 1.5f));
+   vec3 c2 = vec3(float(rx > 0.5f), float(ry > 0.5f), float(rz > 0.5f));
+   vec3 p1 = p0 - c1 + unskew;
+   vec3 p2 = p0 - c2 + 2.0f * unskew;
+   vec3 p3 = p0 - 1.0f + 3.0f * unskew;
+
+   uvec3 cell = noise_cell(f);
+   float n = noise_falloff(0.5f - p0.x * p0.x - p0.y * p0.y - p0.z * p0.z) * noise_grad(noise_hash(seed, cell), p0.x, p0.y, p0.z);
+   n = n + noise_falloff(0.5f - p1.x * p1.x - p1.y * p1.y - p1.z * p1.z) * noise_grad(noise_hash(seed, cell + noise_cell(c1)), p1.x, p1.y, p1.z);
+   n = n + noise_falloff(0.5f - p2.x * p2.x - p2.y * p2.y - p2.z * p2.z) * noise_grad(noise_hash(seed, cell + noise_cell(c2)), p2.x, p2.y, p2.z);
+   n = n + noise_falloff(0.5f - p3.x * p3.x - p3.y * p3.y - p3.z * p3.z) * noise_grad(noise_hash(seed, cell + 1u), p3.x, p3.y, p3.z);
+   return n * 76.0f;
+}
+
+
+float noise_value(vec3 p, uint seed)
+{
+   vec3 fl = floor(p);
+   uvec3 cell = noise_cell(fl);
+   // Quintic blend, flat at both ends so the slope is continuous across cells
+   vec3 f = p - fl;
+   vec3 u = f * f * f * (f * (f * 6.0f - 15.0f) + 10.0f);
+   // Bit d of a corner is its step along axis d
+   float v[8];
+   for (int c = 0; c < 8; c++) {
+      uvec3 corner = cell + uvec3(c & 1, (c >> 1) & 1, (c >> 2) & 1);
+      v[c] = float(int(noise_hash(seed, corner) >> 8)) * (2.0f / 16777216.0f) - 1.0f;
+   }
+   // Blend away one axis at a time
+   for (int c = 0; c < 4; c++) v[c] = v[2 * c] + (v[2 * c + 1] - v[2 * c]) * u.x;
+   for (int c = 0; c < 2; c++) v[c] = v[2 * c] + (v[2 * c + 1] - v[2 * c]) * u.y;
+   return v[0] + (v[1] - v[0]) * u.z;
+}
+
+
+float noise_base(noiseSettings settings, vec3 p, uint seed)
+{
+   return settings.type == NOISE_VALUE ? noise_value(p, seed) : noise_simplex(p, seed);
+}
+
+
+// Same as noise_sample on the CPU: the warp, then the octaves
+float noise_sample(noiseSettings settings, vec3 point)
+{
+   vec3 p = point * settings.frequency;
+
+   if (settings.warp != 0.0f) {
+      // Moved by one octave of the same noise with other seeds, one per axis
+      vec3 q = vec3(noise_base(settings, p, settings.seed + 0x68E31DA4u),
+                    noise_base(settings, p, settings.seed + 0x68E31DA4u * 2u),
+                    noise_base(settings, p, settings.seed + 0x68E31DA4u * 3u));
+      p = p + q * (settings.warp * settings.frequency);
+   }
+   if (settings.fractal == NOISE_SINGLE) return noise_base(settings, p, settings.seed);
+
+   float sum = 0.0f;
+   float amplitude = 1.0f, total = 0.0f;
+   for (int octave = 0; octave < max(1, settings.octaves); octave++) {
+      float n = noise_base(settings, p, settings.seed + 0x9E3779B9u * uint(octave));
+      if (settings.fractal == NOISE_RIDGED) {
+         // Folded at 0 and squared so the creases are sharp peaks, then back to [-1, 1]
+         float r = 1.0f - abs(n);
+         n = r * r * 2.0f - 1.0f;
+      }
+      sum = sum + n * amplitude;
+      total += amplitude;
+      amplitude *= settings.gain;
+      p = p * settings.lacunarity;
+   }
+   return sum * (1.0f / total);
+}
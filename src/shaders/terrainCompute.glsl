@@ -0,0 +1,102 @@
+#version 450 core
+// Vertices of terrain chunks straight into the vertex buffer of gl_terrain, the same as
+// terrainTree::generate on the CPU. Every dispatch does up to TERRAIN_BATCH chunks, one per z.
+// Permutations (defined by gl_terrain):
+// TERRAIN_BATCH: size of the chunk arrays
+// HEIGHTS: first pass, direction and height of a (resolution + 3)^2 grid of samples per chunk (one
+// more all around so the normals on the edges match the neighbouring chunk). Without it the second
+// pass makes the positions, normals and skirts from the samples
+#include "noise.glsl"
+
+#ifdef HEIGHTS
+layout (local_size_x = 8, local_size_y = 8) in;
+#else
+layout (local_size_x = 64) in;
+#endif
+
+// Direction xyz and noise value of every sample
+layout (std430, binding = 0) buffer Samples { vec4 samples[]; };
+// Position xyz then normal xyz of every vertex, a slot of vertexCount vertices per chunk
+layout (std430, binding = 1) writeonly buffer Vertices { float vertices[]; };
+
+uniform noiseSettings terrain;
+uniform int resolution;
+uniform float radius;
+uniform float amplitude;
+uniform float skirt;
+// Cube face, u and v of the first corner and the size of every chunk, and its slot
+uniform vec4 chunks[TERRAIN_BATCH];
+uniform int slots[TERRAIN_BATCH];
+uniform int count;
+
+// Normal, right and up of every cube face
+const vec3 faceAxes[18] = vec3[](
+   vec3(1, 0, 0), vec3(0, 0, -1), vec3(0, 1, 0),
+   vec3(-1, 0, 0), vec3(0, 0, 1), vec3(0, 1, 0),
+   vec3(0, 1, 0), vec3(1, 0, 0), vec3(0, 0, -1),
+   vec3(0, -1, 0), vec3(1, 0, 0), vec3(0, 0, 1),
+   vec3(0, 0, 1), vec3(1, 0, 0), vec3(0, 1, 0),
+   vec3(0, 0, -1), vec3(-1, 0, 0), vec3(0, 1, 0));
+
+const float quarterPi = 0.78539816339f;
+
+vec3 direction(int face, float u, float v)
+{
+   // Equal angles instead of equal steps on the cube
+   float tu = tan(u * quarterPi), tv = tan(v * quarterPi);
+   return normalize(faceAxes[face * 3] + faceAxes[face * 3 + 1] * tu + faceAxes[face * 3 + 2] * tv);
+}
+
+vec3 position(vec4 s)
+{
+   return s.xyz * (radius + amplitude * s.w);
+}
+
+void main()
+{
+   uint chunk = gl_GlobalInvocationID.z;
+   if (chunk >= uint(count)) return;
+   int n = resolution, side = n + 3;
+   vec4 c = chunks[chunk];
+   float step = c.w / float(n);
+   uint first = chunk * uint(side * side);
+
+#ifdef HEIGHTS
+   ivec2 id = ivec2(gl_GlobalInvocationID.xy);
+   if (id.x >= side || id.y >= side) return;
+   vec3 d = direction(int(c.x), c.y + float(id.x - 1) * step, c.z + float(id.y - 1) * step);
+   samples[first + uint(id.y * side + id.x)] = vec4(d, noise_sample(terrain, d));
+#else
+   int grid = (n + 1) * (n + 1);
+   int v = int(gl_GlobalInvocationID.x);
+   if (v >= grid + 4 * (n + 1)) return;
+
+   // The skirts hang under the boundary, the edges go around the chunk counter clockwise
+   int i, j;
+   float depth = 0.0f;
+   if (v < grid) {
+      i = v % (n + 1);
+      j = v / (n + 1);
+   }
+   else {
+      int e = (v - grid) / (n + 1), k = (v - grid) % (n + 1);
+      i = e == 0 ? k : e == 1 ? n : e == 2 ? n - k : 0;
+      j = e == 0 ? 0 : e == 1 ? k : e == 2 ? n : n - k;
+      depth = skirt * radius * 2.0f * quarterPi * c.w;
+   }
+
+   uint at = first + uint((j + 1) * side + i + 1);
+   vec4 s = samples[at];
+   vec3 normal = normalize(cross(position(samples[at + 1u]) - position(samples[at - 1u]),
+                                 position(samples[at + uint(side)]) - position(samples[at - uint(side)])));
+   vec3 p = s.xyz * (radius + amplitude * s.w - depth);
+
+   uint index = (uint(slots[chunk]) * uint(grid + 4 * (n + 1)) + uint(v)) * 6u;
+   vertices[index] = p.x;
+   vertices[index + 1u] = p.y;
+   vertices[index + 2u] = p.z;
+   vertices[index + 3u] = normal.x;
+   vertices[index + 4u] = normal.y;
+   vertices[index + 5u] = normal.z;
+#endif
+}
@@ -0,0 +1,29 @@
+#version 450 core
+#include "lighting.glsl"
+
+uniform vec3 lightPos;
+uniform vec3 lightCol;
+uniform vec3 ownerColors[TILE_OWNERS];
+uniform vec3 terrainColors[TILE_TERRAINS];
+
+in vec3 fragPos;
+in vec3 normal;
+in float edge;
+flat in uvec4 state;
+
+out vec4 FragColor;
+
+void main()
+{
+   vec3 color = terrainColors[min(state.y, uint(TILE_TERRAINS - 1))];
+   // Owned tiles get a tint and a band of the owner color along their border
+   if (state.x != 0u) {
+      vec3 owner = ownerColors[min(state.x, uint(TILE_OWNERS - 1))];
+      color = mix(color, owner, mix(0.25f, 0.9f, smoothstep(0.75f, 0.85f, edge)));
+   }
+   color = mix(color, vec3(1.0f), float(state.z) / 255.0f * 0.6f);
+   // A thin dark outline between all tiles
+   color *= mix(1.0f, 0.55f, smoothstep(0.93f, 0.98f, edge));
+
+   FragColor = vec4(lighting(fragPos, normalize(normal), lightPos, lightCol, color), 1.0);
+}
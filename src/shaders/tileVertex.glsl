@@ -0,0 +1,29 @@
+#version 450 core
+// The tile map of gl_tileMap, every vertex knows its tile and the state of the tile comes from a
+// texture buffer so changing a tile never touches the mesh.
+// Permutations (defined by gl_tileMap):
+// TILE_OWNERS, TILE_TERRAINS: size of the palettes
+layout (location = 0) in vec3 aPos;
+layout (location = 1) in float aEdge;
+layout (location = 2) in uint aTile;
+
+out vec3 fragPos;
+out vec3 normal;
+out float edge;
+flat out uvec4 state;
+
+// Owner, terrain, highlight and flags of every tile
+uniform usamplerBuffer tileStates;
+uniform mat4x4 mvp;
+uniform mat4x3 modelView;
+uniform mat4x3 normalMatrix;
+
+void main()
+{
+   // The same for the whole tile, the provoking vertex hands it to the fragments
+   state = texelFetch(tileStates, int(aTile));
+   edge = aEdge;
+   fragPos = modelView * vec4(aPos, 1.0f);
+   normal = mat3x3(normalMatrix) * aPos;
+   gl_Position = mvp * vec4(aPos, 1.0f);
+}
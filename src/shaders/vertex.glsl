@@ -1,18 +1,64 @@
 #version 450 core
+// Permutations (defined by the program builder):
+// WITH_NORMALS: per vertex normals at location 2 instead of flat shading in the fragment shader
+// INSTANCED: per instance model matrix at locations 3-6, combined with the view and viewProject
+// uniforms here instead of the per draw mvp/modelView/normalMatrix (see gl_uploadMatrices)
+// QUANTIZED_POSITIONS: positions stored as normalized integers, decoded with posScale/posOffset
 layout (location = 0) in vec3 aPos;
 layout (location = 1) in vec2 aTex;
+#ifdef WITH_NORMALS
+layout (location = 2) in vec3 aNormal;
+out vec3 normal;
+#endif
+#ifdef INSTANCED
+layout (location = 3) in mat4x4 aTransform;
+#endif
 
 out vec3 fragPos;
 out vec2 TexCoord;
 
-uniform mat4x4 transform;
-uniform mat4x4 scale;
-uniform mat4x4 view;
-uniform mat4x4 project;
+#ifdef INSTANCED
+uniform mat4x3 view;
+uniform mat4x4 viewProject;
+#else
+// Composed on the CPU once per draw, the model-view and normal matrix are affine so they come in
+// as 4 columns of 3 rows
+uniform mat4x4 mvp;
+uniform mat4x3 modelView;
+uniform mat4x3 normalMatrix;
+#endif
+#ifdef QUANTIZED_POSITIONS
+uniform vec3 posScale;
+uniform vec3 posOffset;
+#endif
 
 void main()
 {
+#ifdef QUANTIZED_POSITIONS
+   vec3 position = aPos * posScale + posOffset;
+#else
+   vec3 position = aPos;
+#endif
+
    TexCoord = aTex;
-   fragPos = vec3(view * transform * scale * vec4(aPos, 1.0f));
-   gl_Position = project * view * transform * scale * vec4(aPos, 1.0f);
+#ifdef INSTANCED
+   vec4 world = aTransform * vec4(position, 1.0f);
+   fragPos = view * world;
+   gl_Position = viewProject * world;
+#ifdef WITH_NORMALS
+   // The inverse transpose of the model matrix up to a scale (its cofactors) keeps the normals
+   // right under non uniform scale, the sign of the determinant under mirroring. The view is
+   // rigid so it turns the normals like the positions
+   mat3x3 model = mat3x3(aTransform);
+   mat3x3 cofactors = mat3x3(cross(model[1], model[2]), cross(model[2], model[0]), cross(model[0], model[1]));
+   float handedness = dot(model[0], cofactors[0]) < 0.0f ? -1.0f : 1.0f;
+   normal = mat3x3(view) * (cofactors * aNormal) * handedness;
+#endif
+#else
+   fragPos = modelView * vec4(position, 1.0f);
+   gl_Position = mvp * vec4(position, 1.0f);
+#ifdef WITH_NORMALS
+   normal = mat3x3(normalMatrix) * aNormal;
+#endif
+#endif
 }
@@ -0,0 +1,38 @@
+//////////////////////////////////////////////////////////////////
+// Headers
+//////////////////////////////////////////////////////////////////
+#include "assets.hpp"
+
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+
+
+const std::string& assetDirectory() {
+
+   static const std::string directory = std::getenv("GL_ASSET_DIR") ? std::getenv("GL_ASSET_DIR") : "";
+   return directory;
+}
+//////////////////////////////////////////////////////////////////
+std::string readAsset(const std::string& name) {
+
+   if (!assetDirectory().empty()) {
+      // Read the whole file in one go instead of line by line
+      std::ifstream file(assetDirectory() + "/" + name, std::ios::binary | std::ios::ate);
+      if (file.is_open()) {
+         std::string contents(file.tellg(), '\0');
+         file.seekg(0);
+         file.read(&contents[0], contents.size());
+         return contents;
+      }
+   }
+
+   for (std::size_t i = 0; i < embeddedAssetCount; i++) {
+      if (std::strcmp(embeddedAssets[i].name, name.c_str()) == 0)
+         return std::string((const char*)embeddedAssets[i].data, embeddedAssets[i].size);
+   }
+
+   std::cerr << "Could not find asset: " << name << std::endl;
+   return "";
+}
@@ -0,0 +1,41 @@
+#pragma once
+
+//////////////////////////////////////////////////////////////////
+// Headers
+//////////////////////////////////////////////////////////////////
+#include <cstddef>
+#include <string>
+
+//////////////////////////////////////////////////////////////////
+/// \brief A file compiled into the executable by cmake/embed.cmake
+/// \param name: Path relative to the project root eg. "src/shaders/vertex.glsl"
+/// \param data: File contents followed by a null terminator
+/// \param size: Size of the file in bytes (without the terminator)
+//////////////////////////////////////////////////////////////////
+struct embeddedAsset {
+
+   const char* name;
+   const unsigned char* data;
+   std::size_t size;
+};
+
+// Generated table of every embedded file
+extern const embeddedAsset embeddedAssets[];
+extern const std::size_t embeddedAssetCount;
+
+
+//////////////////////////////////////////////////////////////////
+/// \brief Directory assets are read from instead of the embedded copies, taken from
+/// the GL_ASSET_DIR environment variable (eg. GL_ASSET_DIR=.. from the build folder).
+/// This is meant for development so shaders can be edited without rebuilding
+/// \return Directory or an empty string when the embedded assets are used
+//////////////////////////////////////////////////////////////////
+const std::string& assetDirectory();
+
+//////////////////////////////////////////////////////////////////
+/// \brief Returns the contents of an asset, from the override directory if one is set
+/// and the file exists there, otherwise from the copy embedded in the executable
+/// \param name: Path relative to the project root eg. "resources/cow.obj"
+/// \return File contents or an empty string if the asset does not exist
+//////////////////////////////////////////////////////////////////
+std::string readAsset(const std::string& name);
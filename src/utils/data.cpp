@@ -5,22 +5,22 @@
 #include "data.hpp"
 
 
-vec3 red;
-vec3 blue;
-vec3 green;
-vec3 yellow;
-vec3 purple;
-vec3 orange;
-vec3 black;
-vec3 white;
+vec4 red;
+vec4 blue;
+vec4 green;
+vec4 yellow;
+vec4 purple;
+vec4 orange;
+vec4 black;
+vec4 white;
 
 
 /////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 /// This is pretty much the same as the SFML color function but i want it as rgb() so the lsp will show me the color
 /////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
-vec3 rgb(unsigned char r, unsigned char g, unsigned char b, unsigned char a) {
+vec4 rgb(unsigned char r, unsigned char g, unsigned char b, unsigned char a) {
 
-   return vec3(r,g,b,a);
+   return vec4(r,g,b,a);
 }
 
 /////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
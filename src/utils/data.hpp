@@ -5,14 +5,14 @@
 //////////////////////////////////////////////////////////////////
 #include "matrix.hpp"
 
-extern vec3 red;
-extern vec3 blue;
-extern vec3 green;
-extern vec3 yellow;
-extern vec3 purple;
-extern vec3 orange;
-extern vec3 black;
-extern vec3 white;
+extern vec4 red;
+extern vec4 blue;
+extern vec4 green;
+extern vec4 yellow;
+extern vec4 purple;
+extern vec4 orange;
+extern vec4 black;
+extern vec4 white;
 
 
 //////////////////////////////////////////////////////////////////
@@ -23,7 +23,7 @@ extern vec3 white;
 /// \param a: alpha
 /// \return color object
 //////////////////////////////////////////////////////////////////
-vec3 rgb(unsigned char r, unsigned char g, unsigned char b, unsigned char a = 255);
+vec4 rgb(unsigned char r, unsigned char g, unsigned char b, unsigned char a = 255);
 
 
 
@@ -0,0 +1,158 @@
+//////////////////////////////////////////////////////////////////
+// Headers
+//////////////////////////////////////////////////////////////////
+#include "influence.hpp"
+#include "parallel.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <numeric>
+
+
+influenceMap::influenceMap(const tileGrid& _grid, int players, influenceSettings _settings) : grid(_grid), settings(_settings) {
+   const std::size_t tiles = grid.size();
+   settings.steps = std::max(1, settings.steps);
+   weights.resize(tiles);
+   for (std::size_t t = 0; t < tiles; t++) weights[t] = settings.decay / float(grid.degree(int(t)));
+
+   players = std::clamp(players, 1, 255);
+   sources.assign(players, std::vector<float>(tiles, 0.0f));
+   fields.assign(players, std::vector<float>(tiles, 0.0f));
+   scratch.assign(players, std::vector<float>(tiles, 0.0f));
+   owner.assign(tiles, 0);
+
+   delta.assign(tiles, 0.0f);
+   current.assign(tiles, 0.0f);
+   next.assign(tiles, 0.0f);
+   listed.assign(tiles, 0);
+}
+
+
+void influenceMap::source(int player, int tile, float strength) {
+   float& s = sources[player][tile];
+   if (strength == s) return;
+   changes.push_back({player, tile, strength - s});
+   s = strength;
+}
+
+
+void influenceMap::claim(int tile) {
+   float best = settings.threshold;
+   std::uint8_t o = 0;
+   for (std::size_t p = 0; p < fields.size(); p++) {
+      if (fields[p][tile] > best) {
+         best = fields[p][tile];
+         o = std::uint8_t(p + 1);
+      }
+   }
+   owner[tile] = o;
+}
+
+
+void influenceMap::solve() {
+   const std::size_t tiles = grid.size();
+   const int* offsets = grid.offsets.data();
+   const int* neighbors = grid.neighbors.data();
+
+   // The first step from nothing is the sources themselves
+   for (std::size_t p = 0; p < fields.size(); p++) fields[p] = sources[p];
+   for (int step = 1; step < settings.steps; step++) {
+      parallel_for(tiles, 4096, [&](std::size_t begin, std::size_t end) {
+         for (std::size_t p = 0; p < fields.size(); p++) {
+            const float* in = fields[p].data();
+            const float* source = sources[p].data();
+            float* out = scratch[p].data();
+            for (std::size_t t = begin; t < end; t++) {
+               float sum = 0.0f;
+               for (int k = offsets[t]; k < offsets[t + 1]; k++) sum += in[neighbors[k]];
+               out[t] = source[t] + weights[t] * sum;
+            }
+         }
+      });
+      fields.swap(scratch);
+   }
+
+   parallel_for(tiles, 4096, [&](std::size_t begin, std::size_t end) {
+      for (std::size_t t = begin; t < end; t++) claim(int(t));
+   });
+   changes.clear();
+}
+
+
+std::size_t influenceMap::update() {
+   touched.clear();
+   if (changes.empty()) return 0;
+
+   // A change reaches about 3 * steps^2 tiles in each of its steps, past a point the full solve
+   // over every tile is less work
+   const std::size_t tiles = grid.size(), steps = std::size_t(settings.steps);
+   if (changes.size() * steps * steps > tiles * fields.size()) {
+      solve();
+      touched.resize(tiles);
+      std::iota(touched.begin(), touched.end(), 0);
+      return tiles;
+   }
+
+   std::stable_sort(changes.begin(), changes.end(), [](const change& a, const change& b) { return a.player < b.player; });
+   for (std::size_t first = 0; first < changes.size();) {
+      const int player = changes[first].player;
+
+      // The differences of the sources of this player
+      stamp++;
+      for (; first < changes.size() && changes[first].player == player; first++) {
+         const change& c = changes[first];
+         if (listed[c.tile] != stamp) {
+            listed[c.tile] = stamp;
+            seeds.push_back(c.tile);
+         }
+         delta[c.tile] += c.delta;
+      }
+
+      // The same steps as solve from a difference of nothing, on the tiles a difference can have
+      // reached: the seeds and the neighbours of the tiles the last step left with one
+      for (int step = 0; step < settings.steps; step++) {
+         stamp++;
+         reached.clear();
+         for (int t : seeds) {
+            listed[t] = stamp;
+            reached.push_back(t);
+         }
+         for (int t : active) {
+            for (int k = grid.offsets[t]; k < grid.offsets[t + 1]; k++) {
+               int n = grid.neighbors[k];
+               if (listed[n] == stamp) continue;
+               listed[n] = stamp;
+               reached.push_back(n);
+            }
+         }
+         for (int t : reached) {
+            float sum = 0.0f;
+            for (int k = grid.offsets[t]; k < grid.offsets[t + 1]; k++) sum += current[grid.neighbors[k]];
+            next[t] = delta[t] + weights[t] * sum;
+         }
+         for (int t : active) current[t] = 0.0f;
+         active.clear();
+         for (int t : reached) {
+            if (std::fabs(next[t]) > settings.epsilon) active.push_back(t);
+            else next[t] = 0.0f;
+         }
+         current.swap(next);
+      }
+
+      float* field = fields[player].data();
+      for (int t : active) {
+         field[t] += current[t];
+         current[t] = 0.0f;
+         touched.push_back(t);
+      }
+      active.clear();
+      for (int t : seeds) delta[t] = 0.0f;
+      seeds.clear();
+   }
+   changes.clear();
+
+   std::sort(touched.begin(), touched.end());
+   touched.erase(std::unique(touched.begin(), touched.end()), touched.end());
+   for (int t : touched) claim(t);
+   return touched.size();
+}
@@ -0,0 +1,108 @@
+#pragma once
+
+//////////////////////////////////////////////////////////////////
+// Headers
+//////////////////////////////////////////////////////////////////
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+#include "tiles.hpp"
+
+//////////////////////////////////////////////////////////////////
+/// \brief How far and how strongly influence spreads
+/// \param decay: Share of the mean of its neighbours a tile keeps every
+/// step (below 1 so the influence fades with distance)
+/// \param steps: Steps of the diffusion, influence reaches steps - 1
+/// tiles away from its sources
+/// \param threshold: Least influence that claims a tile
+/// \param epsilon: The incremental update stops spreading a change where
+/// it is smaller than this
+//////////////////////////////////////////////////////////////////
+struct influenceSettings {
+   float decay = 0.9f;
+   int steps = 16;
+   float threshold = 0.01f;
+   float epsilon = 1e-5f;
+};
+
+//////////////////////////////////////////////////////////////////
+/// \brief Influence of every player over a tileGrid and the territory it
+/// gives them. Every player has a source strength per tile (cities,
+/// units...), and its field is steps of
+///    next[t] = source[t] + decay * mean(field[neighbours of t])
+/// from nothing, over the CSR neighbours of the grid. Every field is its
+/// own array (two of them, read one and write the other every step) and
+/// the steps run on all threads over ranges of tiles.
+/// The field is linear in the sources, so when a few sources change
+/// update only spreads the differences from those tiles, over the tiles
+/// they reach, and adds the result. Rounding adds up over many updates,
+/// solve now and then (eg. once every few turns) starts clean
+//////////////////////////////////////////////////////////////////
+class influenceMap {
+
+public:
+
+   //////////////////////////////////////////////////////////////////
+   /// \brief Fields of a number of players (at most 255), all zero
+   /// \param grid: Kept by reference, has to outlive the map
+   //////////////////////////////////////////////////////////////////
+   influenceMap(const tileGrid& grid, int players, influenceSettings settings = {});
+
+   //////////////////////////////////////////////////////////////////
+   /// \brief Sets the source strength of a player on a tile, it spreads
+   /// with the next update or solve
+   //////////////////////////////////////////////////////////////////
+   void source(int player, int tile, float strength);
+
+   //////////////////////////////////////////////////////////////////
+   /// \brief Every field from all sources and every owner, on all threads
+   //////////////////////////////////////////////////////////////////
+   void solve();
+
+   //////////////////////////////////////////////////////////////////
+   /// \brief Spreads only the sources changed since the last update or
+   /// solve and the owners of the tiles they reach. Solves everything
+   /// instead when so many changed that it would be faster
+   /// \return: Tiles whose influence changed
+   //////////////////////////////////////////////////////////////////
+   std::size_t update();
+
+   float value(int player, int tile) const { return fields[player][tile]; }
+   const std::vector<float>& field(int player) const { return fields[player]; }
+   int players() const { return int(fields.size()); }
+
+   //////////////////////////////////////////////////////////////////
+   /// \brief Player with the most influence on every tile plus one, 0 when
+   /// nobody has more than the threshold (the same as gl_tileState::owner)
+   //////////////////////////////////////////////////////////////////
+   const std::vector<std::uint8_t>& owners() const { return owner; }
+
+   // Tiles of the last update, their owner may have changed
+   const std::vector<int>& changed() const { return touched; }
+
+private:
+
+   void claim(int tile);
+
+   const tileGrid& grid;
+   influenceSettings settings;
+   // decay / degree of every tile
+   std::vector<float> weights;
+
+   std::vector<std::vector<float>> sources, fields, scratch;
+   std::vector<std::uint8_t> owner;
+
+   // Sources changed since the last update
+   struct change {
+      int player, tile;
+      float delta;
+   };
+   std::vector<change> changes;
+
+   // Sparse steps of the update: the changes, the differences of this and the next step (zero
+   // outside the tiles in the lists), and the step each tile was last listed in
+   std::vector<float> delta, current, next;
+   std::vector<int> seeds, active, reached, touched;
+   std::vector<std::uint32_t> listed;
+   std::uint32_t stamp = 0;
+};
@@ -1,81 +0,0 @@
-#include "matrix.hpp"
-
-#include <cmath>
-
-
-mat4x4 matrix_scale(float sx, float sy, float sz){
-   mat4x4 m;
-   m.m[0][0] = sx;   m.m[1][0] = 0.0f; m.m[2][0] = 0.0f; m.m[3][0] = 0.0f;
-   m.m[0][1] = 0.0f; m.m[1][1] = sy;   m.m[2][1] = 0.0f; m.m[3][1] = 0.0f;
-   m.m[0][2] = 0.0f; m.m[1][2] = 0.0f; m.m[2][2] = sz;   m.m[3][2] = 0.0f;
-   m.m[0][3] = 0.0f; m.m[1][3] = 0.0f; m.m[2][3] = 0.0f; m.m[3][3] = 1.0f;
-   return m;
-}
-
-mat4x4 matrix_transform(float x, float y, float z, float u, float v, float w) {
-   // I got to these values by multiplying the transformation matrix and all of the 
-   // rotation matrices and simplifying down the expressions
-   mat4x4 m;
-   m.m[0][0] = (cosf(v)*cosf(w));  m.m[1][0] = ((sinf(u)*-sinf(v))*cosf(w)) + (cosf(u)*-sinf(w)); 
-   m.m[0][1] = (cosf(v)*sinf(w));  m.m[1][1] = ((sinf(u)*-sinf(v))*sinf(w)) + (cosf(u)*cosf(w));  
-   m.m[0][2] = sinf(v);            m.m[1][2] = (sinf(u)*cos(v));                                  
-   m.m[0][3] = 0.0f;               m.m[1][3] = 0.0f;                                              
-
-   m.m[2][0] = ((cosf(u)*-sinf(v))*cosf(w)) + (-sinf(u)*-sinf(w)); m.m[3][0] = x;
-   m.m[2][1] = ((cosf(u)*-sinf(v))*sinf(w)) + (-sinf(u)*cosf(w));  m.m[3][1] = y;
-   m.m[2][2] = (cos(u)*cos(v));                                    m.m[3][2] = z;
-   m.m[2][3] = 0.0f;                                               m.m[3][3] = 1.0f;
-   return m;
-}
-
-
-mat4x4 matrix_project(float fov, float a, float n, float f) {
-   // m[1][1] is normally negative but since we are drawing as y = 0 is at the top of the screen
-   // we need to invert the y values since y = 0 should be towards the bottom of the screen for most OBJ meshes
-   float fovRadians = fov * (M_PI / 180.0f); // Convert degrees to radians
-   float tanHalfFOV = tanf(fovRadians / 2.0f);
-
-   float t = tanHalfFOV * n;
-   float b = -t;
-   float r = t * a;
-   float l = -r;
-
-   mat4x4 m;
-   m.m[0][0] = (2.0f*n)/(r-l);  m.m[0][1] = 0.0f;             m.m[0][2] = 0.0f;                m.m[0][3] = 0.0f;
-   m.m[1][0] = 0.0f;            m.m[1][1] = (2.0f*n)/(t-b);   m.m[1][2] = 0.0f;                m.m[1][3] = 0.0f;
-   m.m[2][0] = (r+l)/(r-l);     m.m[2][1] = (t+b)/(t-b);      m.m[2][2] = -(f+n)/(f-n);        m.m[2][3] = -1.0f;
-   m.m[3][0] = 0.0f;            m.m[3][1] = 0.0f;             m.m[3][2] = -(2.0f*f*n)/(f-n);   m.m[3][3] = 0.0f;
-   return m;
-}
-
-
-mat4x4 matrix_pointAt(vec3 &pos, vec3 &target, vec3 &up) {
-
-   // Calculate new Up direction
-   vec3 a = target * up.dot(target);
-   vec3 newUp = (up - a).normal();
-   // New Right direction is just the cross product
-   vec3 newRight = newUp.cross(target);
-
-   mat4x4 m;
-   m.m[0][0] = newRight.x; m.m[1][0] = newUp.x; m.m[2][0] = target.x; m.m[3][0] = pos.x;
-   m.m[0][1] = newRight.y; m.m[1][1] = newUp.y; m.m[2][1] = target.y; m.m[3][1] = pos.y;
-   m.m[0][2] = newRight.z; m.m[1][2] = newUp.z; m.m[2][2] = target.z; m.m[3][2] = pos.z;
-   m.m[0][3] = 0.0f;       m.m[1][3] = 0.0f;    m.m[2][3] = 0.0f;     m.m[3][3] = 1.0f;
-   return m;
-}
-
-
-mat4x4 matrix_view(mat4x4 &m) {
-   //This is basically creating the inverse of the input matrix
-   mat4x4 m2;
-   m2.m[0][0] = m.m[0][0]; m2.m[0][1] = m.m[1][0]; m2.m[0][2] = m.m[2][0]; m2.m[0][3] = 0.0f;
-   m2.m[1][0] = m.m[0][1]; m2.m[1][1] = m.m[1][1]; m2.m[1][2] = m.m[2][1]; m2.m[1][3] = 0.0f;
-   m2.m[2][0] = m.m[0][2]; m2.m[2][1] = m.m[1][2]; m2.m[2][2] = m.m[2][2]; m2.m[2][3] = 0.0f;
-
-   m2.m[3][0] = -(m.m[3][0] * m2.m[0][0] + m.m[3][1] * m2.m[1][0] + m.m[3][2] * m2.m[2][0]);
-   m2.m[3][1] = -(m.m[3][0] * m2.m[0][1] + m.m[3][1] * m2.m[1][1] + m.m[3][2] * m2.m[2][1]);
-   m2.m[3][2] = -(m.m[3][0] * m2.m[0][2] + m.m[3][1] * m2.m[1][2] + m.m[3][2] * m2.m[2][2]);
-   m2.m[3][3] = 1.0f;
-   return m2;
-}
@@ -1,20 +1,124 @@
 #pragma once
 
 #include <cmath>
+#include <type_traits>
+#include "simd.hpp"
+
+
+//XXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXX
+// Header only and constexpr
+//XXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXX
+// Everything in here is constexpr so constant matrices (constexpr mat3x4 s = matrix_scale(...))
+// are built by the compiler, and inline so hot loops can inline the whole thing. The SIMD paths
+// can not run in a constant expression, std::is_constant_evaluated() picks the scalar code there.
+
+/// @brief: Square root that also works in constant expressions (Newton's method at compile time)
+/// @param x: Value, not negative
+///
+constexpr float math_sqrt(float x) {
+   if (!std::is_constant_evaluated()) return std::sqrt(x);
+   if (x <= 0.0f) return 0.0f;
+   double r = x > 1.0f ? x : 1.0;
+   for (int i = 0; i < 128; i++) {
+      double next = 0.5 * (r + x / r);
+      if (next == r) break;
+      r = next;
+   }
+   return (float)r;
+}
+
+/// @brief: Sine and cosine of the same angle in one call (sincosf where the C library has it,
+/// a Taylor series in constant expressions)
+/// @param a: Angle in radians
+/// @param s: Set to sin(a)
+/// @param c: Set to cos(a)
+///
+constexpr void math_sincos(float a, float &s, float &c) {
+   if (!std::is_constant_evaluated()) {
+#if defined(__GLIBC__)
+      sincosf(a, &s, &c);
+#else
+      s = std::sin(a);
+      c = std::cos(a);
+#endif
+      return;
+   }
+   // Bring the angle into [-pi, pi] where 20 terms are far below float precision
+   const double pi = 3.14159265358979323846;
+   double x = a - 2.0 * pi * (long long)(a / (2.0 * pi));
+   if (x > pi) x -= 2.0 * pi;
+   if (x < -pi) x += 2.0 * pi;
+   double sTerm = x, cTerm = 1.0, sSum = x, cSum = 1.0;
+   for (int i = 1; i < 20; i++) {
+      sTerm *= -x * x / ((2 * i) * (2 * i + 1));
+      cTerm *= -x * x / ((2 * i - 1) * (2 * i));
+      sSum += sTerm;
+      cSum += cTerm;
+   }
+   s = (float)sSum;
+   c = (float)cSum;
+}
 
 
 //XXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXX
 // Vector / Matrix objects with overloads
 //XXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXX
 
-/// @brief: Simple 4x4 matrix with multiplication overload
-struct mat4x4 {
+/// @brief: Simple 4x4 matrix with multiplication overload. Stored column major (m[column][row])
+/// the way glUniformMatrix4fv expects it, aligned so every column can be loaded as one SIMD register
+struct alignas(16) mat4x4 {
 
    float m[4][4] = {0.0f};
    
    // Overload for multiplying two matrices
-   mat4x4 operator * (const mat4x4 &m2){
+   constexpr mat4x4 operator * (const mat4x4 &m2) const {
       mat4x4 matrix;
+#if defined(MATH_SIMD)
+      if (!std::is_constant_evaluated()) {
+#if defined(MATH_AVX2)
+         // Two result columns per register: column j of the result is the sum of the columns of m2
+         // scaled by the components of column j of this matrix
+         __m256 b0 = _mm256_broadcast_ps((const __m128*)m2.m[0]);
+         __m256 b1 = _mm256_broadcast_ps((const __m128*)m2.m[1]);
+         __m256 b2 = _mm256_broadcast_ps((const __m128*)m2.m[2]);
+         __m256 b3 = _mm256_broadcast_ps((const __m128*)m2.m[3]);
+         for (int j = 0; j < 4; j += 2) {
+            __m256 a = _mm256_loadu_ps(this->m[j]);
+            __m256 r = _mm256_mul_ps(_mm256_permute_ps(a, 0x00), b0);
+            r = _mm256_fmadd_ps(_mm256_permute_ps(a, 0x55), b1, r);
+            r = _mm256_fmadd_ps(_mm256_permute_ps(a, 0xAA), b2, r);
+            r = _mm256_fmadd_ps(_mm256_permute_ps(a, 0xFF), b3, r);
+            _mm256_storeu_ps(matrix.m[j], r);
+         }
+#elif defined(MATH_SSE)
+         __m128 b0 = _mm_load_ps(m2.m[0]);
+         __m128 b1 = _mm_load_ps(m2.m[1]);
+         __m128 b2 = _mm_load_ps(m2.m[2]);
+         __m128 b3 = _mm_load_ps(m2.m[3]);
+         for (int j = 0; j < 4; j++) {
+            __m128 a = _mm_load_ps(this->m[j]);
+            __m128 r = _mm_mul_ps(_mm_shuffle_ps(a, a, 0x00), b0);
+            r = _mm_add_ps(r, _mm_mul_ps(_mm_shuffle_ps(a, a, 0x55), b1));
+            r = _mm_add_ps(r, _mm_mul_ps(_mm_shuffle_ps(a, a, 0xAA), b2));
+            r = _mm_add_ps(r, _mm_mul_ps(_mm_shuffle_ps(a, a, 0xFF), b3));
+            _mm_store_ps(matrix.m[j], r);
+         }
+#elif defined(MATH_NEON)
+         float32x4_t b0 = vld1q_f32(m2.m[0]);
+         float32x4_t b1 = vld1q_f32(m2.m[1]);
+         float32x4_t b2 = vld1q_f32(m2.m[2]);
+         float32x4_t b3 = vld1q_f32(m2.m[3]);
+         for (int j = 0; j < 4; j++) {
+            float32x4_t r = vmulq_n_f32(b0, this->m[j][0]);
+            r = vmlaq_n_f32(r, b1, this->m[j][1]);
+            r = vmlaq_n_f32(r, b2, this->m[j][2]);
+            r = vmlaq_n_f32(r, b3, this->m[j][3]);
+            vst1q_f32(matrix.m[j], r);
+         }
+#endif
+         return matrix;
+      }
+#endif
       for (int i = 0; i < 4; i++)
          for (int j = 0; j < 4; j++)
             matrix.m[j][i] = this->m[j][0] * m2.m[0][i] + this->m[j][1] * m2.m[1][i] + this->m[j][2] * m2.m[2][i] + this->m[j][3] * m2.m[3][i];
@@ -23,6 +127,88 @@ struct mat4x4 {
 };
 
 
+/// @brief: Affine 3x4 matrix (rotation/scale + translation) for transforms that never project.
+/// The last row of an affine matrix is always (0,0,0,1) so it is not stored, and nothing that uses
+/// it computes w or divides. Unlike mat4x4 it is stored by rows (m[row][column], translation in
+/// m[row][3]) so every row is one SIMD register. Convert with toMat4 for upload or projection
+struct alignas(16) mat3x4 {
+
+   float m[3][4] = {{1.0f, 0.0f, 0.0f, 0.0f}, {0.0f, 1.0f, 0.0f, 0.0f}, {0.0f, 0.0f, 1.0f, 0.0f}};
+
+   // Overload for combining two transforms, same order as mat4x4 (this is applied first, then m2)
+   constexpr mat3x4 operator * (const mat3x4 &m2) const {
+      mat3x4 matrix;
+#if defined(MATH_SSE)
+      if (!std::is_constant_evaluated()) {
+#if defined(MATH_AVX2)
+         // Rows 0 and 1 are done together in one 256 bit register, the same rows of this matrix are
+         // broadcast into both halves and each half picks its own coefficients from m2 with a permute
+         __m256 a0 = _mm256_broadcast_ps((const __m128*)this->m[0]);
+         __m256 a1 = _mm256_broadcast_ps((const __m128*)this->m[1]);
+         __m256 a2 = _mm256_broadcast_ps((const __m128*)this->m[2]);
+         __m256 b = _mm256_loadu_ps(m2.m[0]);
+         __m256 r = _mm256_and_ps(b, _mm256_castsi256_ps(_mm256_setr_epi32(0, 0, 0, -1, 0, 0, 0, -1)));
+         r = _mm256_fmadd_ps(_mm256_permute_ps(b, 0x00), a0, r);
+         r = _mm256_fmadd_ps(_mm256_permute_ps(b, 0x55), a1, r);
+         r = _mm256_fmadd_ps(_mm256_permute_ps(b, 0xAA), a2, r);
+         _mm256_storeu_ps(matrix.m[0], r);
+
+         __m128 r2 = _mm_and_ps(_mm_load_ps(m2.m[2]), _mm_castsi128_ps(_mm_setr_epi32(0, 0, 0, -1)));
+         r2 = _mm_fmadd_ps(_mm_set1_ps(m2.m[2][0]), _mm256_castps256_ps128(a0), r2);
+         r2 = _mm_fmadd_ps(_mm_set1_ps(m2.m[2][1]), _mm256_castps256_ps128(a1), r2);
+         r2 = _mm_fmadd_ps(_mm_set1_ps(m2.m[2][2]), _mm256_castps256_ps128(a2), r2);
+         _mm_store_ps(matrix.m[2], r2);
+#elif defined(MATH_SSE)
+         // Row i of the result is the rows of this matrix scaled by row i of m2, plus the translation of m2
+         __m128 a0 = _mm_load_ps(this->m[0]);
+         __m128 a1 = _mm_load_ps(this->m[1]);
+         __m128 a2 = _mm_load_ps(this->m[2]);
+         __m128 translation = _mm_castsi128_ps(_mm_setr_epi32(0, 0, 0, -1));
+         for (int i = 0; i < 3; i++) {
+            __m128 r = _mm_and_ps(_mm_load_ps(m2.m[i]), translation);
+            r = _mm_add_ps(r, _mm_mul_ps(_mm_set1_ps(m2.m[i][0]), a0));
+            r = _mm_add_ps(r, _mm_mul_ps(_mm_set1_ps(m2.m[i][1]), a1));
+            r = _mm_add_ps(r, _mm_mul_ps(_mm_set1_ps(m2.m[i][2]), a2));
+            _mm_store_ps(matrix.m[i], r);
+         }
+#endif
+         return matrix;
+      }
+#endif
+      for (int i = 0; i < 3; i++) {
+         for (int j = 0; j < 4; j++)
+            matrix.m[i][j] = m2.m[i][0] * this->m[0][j] + m2.m[i][1] * this->m[1][j] + m2.m[i][2] * this->m[2][j];
+         // The translation column also picks up the translation of m2
+         matrix.m[i][3] += m2.m[i][3];
+      }
+      return matrix;
+   }
+
+   /// @brief: Returns the full 4x4 matrix, eg. for glUniformMatrix4fv or to combine with a projection
+   constexpr mat4x4 toMat4() const {
+      mat4x4 matrix;
+#if defined(MATH_SSE)
+      if (!std::is_constant_evaluated()) {
+         __m128 r0 = _mm_load_ps(this->m[0]);
+         __m128 r1 = _mm_load_ps(this->m[1]);
+         __m128 r2 = _mm_load_ps(this->m[2]);
+         __m128 r3 = _mm_setr_ps(0.0f, 0.0f, 0.0f, 1.0f);
+         _MM_TRANSPOSE4_PS(r0, r1, r2, r3);
+         _mm_store_ps(matrix.m[0], r0);
+         _mm_store_ps(matrix.m[1], r1);
+         _mm_store_ps(matrix.m[2], r2);
+         _mm_store_ps(matrix.m[3], r3);
+         return matrix;
+      }
+#endif
+      for (int i = 0; i < 3; i++)
+         for (int j = 0; j < 4; j++) matrix.m[j][i] = this->m[i][j];
+      matrix.m[3][3] = 1.0f;
+      return matrix;
+   }
+};
+
+
 /// @brief: 3d vector with operator overloads
 /// @param x: x component of vector (Default: 0)
 /// @param y: y component of vector (Default: 0)
@@ -31,130 +217,289 @@ struct vec2 {
    float x,y;
 
    // Constructors (Member initializer list)
-   vec2() : x(0), y(0) {}
-   vec2(float _x, float _y) : x(_x), y(_y) {}
+   constexpr vec2() : x(0), y(0) {}
+   constexpr vec2(float _x, float _y) : x(_x), y(_y) {}
 
    // Member Functions
    //---------------------------------------------------------------------------------------------
    /// @brief: returns the magnitude of the vector
-   float mag() { return std::sqrt(std::pow(x,2) + std::pow(y,2)); }
+   constexpr float mag() const { return math_sqrt(x * x + y * y); }
    /// @brief: Returns the normalized vector so the magnitude is 1
-   vec2 normal() { float m = mag(); return vec2(x/m, y/m); }
-   /// @brief: Normalizes the vector so the magnitude is 2
-   void normalize() { float m = mag(); x /= m; y /= m; }
+   constexpr vec2 normal() const { float m = mag(); return vec2(x/m, y/m); }
+   /// @brief: Normalizes the vector so the magnitude is 1
+   constexpr void normalize() { float m = mag(); x /= m; y /= m; }
    /// @brief: Dot producto of 2 vectors. This is escencially the likeness of 2 normalized vectors
-   float dot(const vec2& v) { return ((this->x * v.x) + (this->y * v.y)); }
+   constexpr float dot(const vec2& v) const { return ((this->x * v.x) + (this->y * v.y)); }
    // @brief: There is not necessarily a 2D cross product but you can use this to determine if a vector points to the left or right of another vector
-   float cross(const vec2& v) { return ((this->x * v.y) - (this->y * v.x)); }
+   constexpr float cross(const vec2& v) const { return ((this->x * v.y) - (this->y * v.x)); }
 
    // Overload functions
    //---------------------------------------------------------------------------------------------
    // Standard Operators
-   vec2 operator + (const vec2& v) {return vec2(this->x + v.x, this->y + v.y); } // Add 2 vectors
-   vec2 operator - (const vec2& v) {return vec2(this->x - v.x, this->y - v.y); } // Subtract 2 vectors
-   vec2 operator * (const float& f) {return vec2(this->x * f, this->y * f); } // Scale vector by float
-   vec2 operator / (const float& f) {return vec2(this->x / f, this->y / f); } // Scale vector by float
+   constexpr vec2 operator + (const vec2& v) const {return vec2(this->x + v.x, this->y + v.y); } // Add 2 vectors
+   constexpr vec2 operator - (const vec2& v) const {return vec2(this->x - v.x, this->y - v.y); } // Subtract 2 vectors
+   constexpr vec2 operator * (const float& f) const {return vec2(this->x * f, this->y * f); } // Scale vector by float
+   constexpr vec2 operator / (const float& f) const {return vec2(this->x / f, this->y / f); } // Scale vector by float
    // Compound Operators
-   void operator += (const vec2& v) { this->x += v.x; this->y += v.y; } // Add 2 vectors
-   void operator -= (const vec2& v) { this->x -= v.x; this->y -= v.y; } // Subtract 2 vectors
-   void operator *= (const float& f) { this->x *= f; this->y *= f; } // Scale vector by float
-   void operator /= (const float& f) { this->x /= f; this->y /= f; } // Scale vector by float
+   constexpr void operator += (const vec2& v) { this->x += v.x; this->y += v.y; } // Add 2 vectors
+   constexpr void operator -= (const vec2& v) { this->x -= v.x; this->y -= v.y; } // Subtract 2 vectors
+   constexpr void operator *= (const float& f) { this->x *= f; this->y *= f; } // Scale vector by float
+   constexpr void operator /= (const float& f) { this->x /= f; this->y /= f; } // Scale vector by float
    // Dot product overload
-   float operator * (const vec2& v) {return (this->x * v.x + this->y * v.y); }
+   constexpr float operator * (const vec2& v) const {return (this->x * v.x + this->y * v.y); }
 };
 
 
-/// @brief 3d vector with an optional constructor
+/// @brief 3d vector with an optional constructor. Packed in 12 bytes for storage (positions, scales,
+/// directions), multiplying by a matrix treats it as a point (w = 1). Use vec4 for homogeneous
+/// coordinates or directions through a matrix (w = 0)
 /// @param x: x component of vector (Default: 0)
 /// @param y: y component of vector (Default: 0)
 /// @param z: z component of vector (Default: 0) 
-/// @param w: Extra component used for multiplication with 4x4 matrices (Default = 1)
 struct vec3 {
 
-   float x,y,z,w;
+   float x,y,z;
 
    // Constructors (member initializer list)
-   vec3() : x(0), y(0), z(0), w(1) {}
-   vec3(float _x, float _y, float _z) : x(_x), y(_y), z(_z), w(1) {}
-   vec3(float _x, float _y, float _z, float _w) : x(_x), y(_y), z(_z), w(_w) {}
+   constexpr vec3() : x(0), y(0), z(0) {}
+   constexpr vec3(float _x, float _y, float _z) : x(_x), y(_y), z(_z) {}
 
    // Member functions
    //---------------------------------------------------------------------------------------------
    /// @brief: returns the magnitude of the vector
-   float mag() { return std::sqrt(std::pow(x,2) + std::pow(y,2) + std::pow(z,2)); }
+   constexpr float mag() const { return math_sqrt(x * x + y * y + z * z); }
    /// @brief: Returns the normalized vector so the magnitude is 1
-   vec3 normal() { float m = mag(); return vec3(x/m, y/ m, z/m, w); }
-   /// @brief: Normalizes the vector so the magnitude is 2
-   void normalize() { float m = mag(); x /= m; y /= m; z /= m; }
+   constexpr vec3 normal() const { float m = mag(); return vec3(x/m, y/ m, z/m); }
+   /// @brief: Normalizes the vector so the magnitude is 1
+   constexpr void normalize() { float m = mag(); x /= m; y /= m; z /= m; }
    /// @brief: Dot producto of 2 vectors. This is escencially the likeness of 2 normalized vectors
-   float dot(const vec3& v) { return ((this->x * v.x) + (this->y * v.y) + (this->z * v.z)); }
+   constexpr float dot(const vec3& v) const { return ((this->x * v.x) + (this->y * v.y) + (this->z * v.z)); }
    // @brief: Cross product of 2 vectors that will return the normal vector of the plane created from the 2 vectors
-   vec3 cross(const vec3& v) { return vec3(this->y * v.z - this->z * v.y, this->z * v.x - this->x * v.z, this->x * v.y - this->y * v.x, this->w); }
+   constexpr vec3 cross(const vec3& v) const { return vec3(this->y * v.z - this->z * v.y, this->z * v.x - this->x * v.z, this->x * v.y - this->y * v.x); }
 
    // Operator overloads
    //---------------------------------------------------------------------------------------------
    // Standard Operators 
-   vec3 operator + (const vec3& v) {return vec3(this->x + v.x, this->y + v.y, this->z + v.z, this->w); } // Add 2 vectors
-   vec3 operator - (const vec3& v) {return vec3(this->x - v.x, this->y - v.y, this->z - v.z, this->w); } // Subtract 2 vectors
-   vec3 operator * (const float& f) {return vec3(this->x * f, this->y * f, this->z * f, this->w); } // Scale vector by float
-   vec3 operator / (const float& f) {return vec3(this->x / f, this->y / f, this->z / f, this->w); } // Scale vector by float
+   constexpr vec3 operator + (const vec3& v) const {return vec3(this->x + v.x, this->y + v.y, this->z + v.z); } // Add 2 vectors
+   constexpr vec3 operator - (const vec3& v) const {return vec3(this->x - v.x, this->y - v.y, this->z - v.z); } // Subtract 2 vectors
+   constexpr vec3 operator * (const float& f) const {return vec3(this->x * f, this->y * f, this->z * f); } // Scale vector by float
+   constexpr vec3 operator / (const float& f) const {return vec3(this->x / f, this->y / f, this->z / f); } // Scale vector by float
    // Compound Operators
-   void operator += (const vec3& v) { this->x += v.x; this->y += v.y; this->z += v.z; } // Add 2 vectors
-   void operator -= (const vec3& v) { this->x -= v.x; this->y -= v.y; this->z -= v.z; } // Subtract 2 vectors
-   void operator *= (const float& f) { this->x *= f; this->y *= f; this->z *= f; } // Scale vector by float
-   void operator /= (const float& f) { this->x /= f; this->y /= f; this->z /= f; } // Scale vector by float
+   constexpr void operator += (const vec3& v) { this->x += v.x; this->y += v.y; this->z += v.z; } // Add 2 vectors
+   constexpr void operator -= (const vec3& v) { this->x -= v.x; this->y -= v.y; this->z -= v.z; } // Subtract 2 vectors
+   constexpr void operator *= (const float& f) { this->x *= f; this->y *= f; this->z *= f; } // Scale vector by float
+   constexpr void operator /= (const float& f) { this->x /= f; this->y /= f; this->z /= f; } // Scale vector by float
    // Dot product overload
-   float operator * (const vec3& v) {return (this->x * v.x) + (this->y * v.y) + (this->z * v.z); }
-
-   // Overload for multiplying a vector against a matrix
-   vec3 operator * (const mat4x4& m) {
-      vec3 v;
-      v.x = this->x * m.m[0][0] + this->y * m.m[1][0] + this->z * m.m[2][0] + this->w * m.m[3][0];
-      v.y = this->x * m.m[0][1] + this->y * m.m[1][1] + this->z * m.m[2][1] + this->w * m.m[3][1];
-      v.z = this->x * m.m[0][2] + this->y * m.m[1][2] + this->z * m.m[2][2] + this->w * m.m[3][2];
-      v.w = this->x * m.m[0][3] + this->y * m.m[1][3] + this->z * m.m[2][3] + this->w * m.m[3][3];
-      if ( v.w != 0.0f) {v.x /= v.w; v.y /= v.w; v.z /= v.w;}
+   constexpr float operator * (const vec3& v) const {return (this->x * v.x) + (this->y * v.y) + (this->z * v.z); }
+
+   // Overload for multiplying a point against a matrix (perspective divide when w is not 0)
+   constexpr vec3 operator * (const mat4x4& m) const {
+#if defined(MATH_SIMD)
+      if (!std::is_constant_evaluated()) {
+         alignas(16) float v[4];
+#if defined(MATH_SSE)
+         __m128 r = _mm_add_ps(_mm_mul_ps(_mm_set1_ps(this->x), _mm_load_ps(m.m[0])), _mm_load_ps(m.m[3]));
+         r = _mm_add_ps(r, _mm_mul_ps(_mm_set1_ps(this->y), _mm_load_ps(m.m[1])));
+         r = _mm_add_ps(r, _mm_mul_ps(_mm_set1_ps(this->z), _mm_load_ps(m.m[2])));
+         // Divide by w without a branch, lanes where w is 0 are left alone
+         __m128 w = _mm_shuffle_ps(r, r, _MM_SHUFFLE(3,3,3,3));
+         r = _mm_blendv_ps(r, _mm_div_ps(r, w), _mm_cmpneq_ps(w, _mm_setzero_ps()));
+         _mm_store_ps(v, r);
+#elif defined(MATH_NEON)
+         float32x4_t r = vmlaq_n_f32(vld1q_f32(m.m[3]), vld1q_f32(m.m[0]), this->x);
+         r = vmlaq_n_f32(r, vld1q_f32(m.m[1]), this->y);
+         r = vmlaq_n_f32(r, vld1q_f32(m.m[2]), this->z);
+         vst1q_f32(v, r);
+         if (v[3] != 0.0f) {v[0] /= v[3]; v[1] /= v[3]; v[2] /= v[3];}
+#endif
+         return vec3(v[0], v[1], v[2]);
+      }
+#endif
+      vec3 v(this->x * m.m[0][0] + this->y * m.m[1][0] + this->z * m.m[2][0] + m.m[3][0],
+             this->x * m.m[0][1] + this->y * m.m[1][1] + this->z * m.m[2][1] + m.m[3][1],
+             this->x * m.m[0][2] + this->y * m.m[1][2] + this->z * m.m[2][2] + m.m[3][2]);
+      float w = this->x * m.m[0][3] + this->y * m.m[1][3] + this->z * m.m[2][3] + m.m[3][3];
+      if (w != 0.0f) {v.x /= w; v.y /= w; v.z /= w;}
       return v;
    }
    
-   // Overload for multiplying a vector against a matrix
-   void operator *= (const mat4x4& m) {
-      vec3 v;
-      v.x = this->x * m.m[0][0] + this->y * m.m[1][0] + this->z * m.m[2][0] + this->w * m.m[3][0];
-      v.y = this->x * m.m[0][1] + this->y * m.m[1][1] + this->z * m.m[2][1] + this->w * m.m[3][1];
-      v.z = this->x * m.m[0][2] + this->y * m.m[1][2] + this->z * m.m[2][2] + this->w * m.m[3][2];
-      v.w = this->x * m.m[0][3] + this->y * m.m[1][3] + this->z * m.m[2][3] + this->w * m.m[3][3];
-      if ( v.w != 0.0f) {v.x /= v.w; v.y /= v.w; v.z /= v.w;}
-      this-> x = v.x;
-      this-> y = v.y;
-      this-> z = v.z;
+   // Overload for multiplying a point against an affine matrix. There is no w row to compute so
+   // there is no divide
+   constexpr vec3 operator * (const mat3x4& m) const {
+#if defined(MATH_SIMD)
+      if (!std::is_constant_evaluated()) {
+         alignas(16) float v[4];
+#if defined(MATH_SSE)
+         // The rows turned into columns (the last lane is left over), then the same broadcasts as
+         // vec3 * mat4x4. Dot products per row (dpps, hadd) are slower, they are all shuffles
+         __m128 r0 = _mm_load_ps(m.m[0]);
+         __m128 r1 = _mm_load_ps(m.m[1]);
+         __m128 r2 = _mm_load_ps(m.m[2]);
+         __m128 lo = _mm_unpacklo_ps(r0, r1);
+         __m128 hi = _mm_unpackhi_ps(r0, r1);
+         __m128 c0 = _mm_movelh_ps(lo, r2);
+         __m128 c1 = _mm_shuffle_ps(lo, r2, _MM_SHUFFLE(3,1,3,2));
+         __m128 c2 = _mm_shuffle_ps(hi, r2, _MM_SHUFFLE(3,2,1,0));
+         __m128 c3 = _mm_shuffle_ps(hi, r2, _MM_SHUFFLE(3,3,3,2));
+         __m128 r = _mm_add_ps(_mm_mul_ps(_mm_set1_ps(this->x), c0), c3);
+         r = _mm_add_ps(r, _mm_mul_ps(_mm_set1_ps(this->y), c1));
+         r = _mm_add_ps(r, _mm_mul_ps(_mm_set1_ps(this->z), c2));
+         _mm_store_ps(v, r);
+#elif defined(MATH_NEON)
+         // One dot product per row with (x y z 1), the pairwise adds are cheap on NEON
+         const float32x4_t p = {this->x, this->y, this->z, 1.0f};
+         float32x4_t r0 = vmulq_f32(vld1q_f32(m.m[0]), p);
+         float32x4_t r1 = vmulq_f32(vld1q_f32(m.m[1]), p);
+         float32x4_t r2 = vmulq_f32(vld1q_f32(m.m[2]), p);
+         // The halves of every row and then the pairs of rows
+         float32x2_t s0 = vpadd_f32(vget_low_f32(r0), vget_high_f32(r0));
+         float32x2_t s1 = vpadd_f32(vget_low_f32(r1), vget_high_f32(r1));
+         float32x2_t s2 = vpadd_f32(vget_low_f32(r2), vget_high_f32(r2));
+         vst1q_f32(v, vcombine_f32(vpadd_f32(s0, s1), vpadd_f32(s2, s2)));
+#endif
+         return vec3(v[0], v[1], v[2]);
+      }
+#endif
+      return vec3(this->x * m.m[0][0] + this->y * m.m[0][1] + this->z * m.m[0][2] + m.m[0][3],
+                  this->x * m.m[1][0] + this->y * m.m[1][1] + this->z * m.m[1][2] + m.m[1][3],
+                  this->x * m.m[2][0] + this->y * m.m[2][1] + this->z * m.m[2][2] + m.m[2][3]);
    }
+
+   constexpr void operator *= (const mat3x4& m) { *this = *this * m; }
+   constexpr void operator *= (const mat4x4& m) { *this = *this * m; }
 };
 
 
+/// @brief 4d vector, aligned to 16 bytes so it loads into one SIMD register. Used for homogeneous
+/// coordinates (clip space, w = 0 directions), planes and colors
+/// @param x: x component of vector (Default: 0)
+/// @param y: y component of vector (Default: 0)
+/// @param z: z component of vector (Default: 0)
+/// @param w: Homogeneous component, 1 for points and 0 for directions (Default: 1)
+struct alignas(16) vec4 {
+
+   float x,y,z,w;
+
+   // Constructors (member initializer list)
+   constexpr vec4() : x(0), y(0), z(0), w(1) {}
+   constexpr vec4(float _x, float _y, float _z, float _w = 1.0f) : x(_x), y(_y), z(_z), w(_w) {}
+   /// @brief: vec3 with a w added, 1 for a point and 0 for a direction
+   constexpr explicit vec4(const vec3& v, float _w = 1.0f) : x(v.x), y(v.y), z(v.z), w(_w) {}
+
+   // Member functions
+   //---------------------------------------------------------------------------------------------
+   /// @brief: x, y and z without w (no divide, see project)
+   constexpr vec3 xyz() const { return vec3(x, y, z); }
+   /// @brief: Perspective divide, x, y and z divided by w (unless w is 0)
+   constexpr vec3 project() const { return w != 0.0f ? vec3(x / w, y / w, z / w) : vec3(x, y, z); }
+   /// @brief: Dot product of all 4 components (eg. a plane against a point with w = 1)
+   constexpr float dot(const vec4& v) const { return x * v.x + y * v.y + z * v.z + w * v.w; }
+
+   // Operator overloads
+   //---------------------------------------------------------------------------------------------
+   // Standard Operators, on all 4 components
+   constexpr vec4 operator + (const vec4& v) const {return vec4(x + v.x, y + v.y, z + v.z, w + v.w); } // Add 2 vectors
+   constexpr vec4 operator - (const vec4& v) const {return vec4(x - v.x, y - v.y, z - v.z, w - v.w); } // Subtract 2 vectors
+   constexpr vec4 operator * (const float& f) const {return vec4(x * f, y * f, z * f, w * f); } // Scale vector by float
+   constexpr vec4 operator / (const float& f) const {return vec4(x / f, y / f, z / f, w / f); } // Scale vector by float
+
+   // Overload for multiplying a homogeneous vector against a matrix, there is no divide (clip space)
+   constexpr vec4 operator * (const mat4x4& m) const {
+#if defined(MATH_SIMD)
+      if (!std::is_constant_evaluated()) {
+         vec4 v;
+#if defined(MATH_SSE)
+         __m128 r = _mm_mul_ps(_mm_set1_ps(this->x), _mm_load_ps(m.m[0]));
+         r = _mm_add_ps(r, _mm_mul_ps(_mm_set1_ps(this->y), _mm_load_ps(m.m[1])));
+         r = _mm_add_ps(r, _mm_mul_ps(_mm_set1_ps(this->z), _mm_load_ps(m.m[2])));
+         r = _mm_add_ps(r, _mm_mul_ps(_mm_set1_ps(this->w), _mm_load_ps(m.m[3])));
+         _mm_store_ps(&v.x, r);
+#elif defined(MATH_NEON)
+         float32x4_t r = vmulq_n_f32(vld1q_f32(m.m[0]), this->x);
+         r = vmlaq_n_f32(r, vld1q_f32(m.m[1]), this->y);
+         r = vmlaq_n_f32(r, vld1q_f32(m.m[2]), this->z);
+         r = vmlaq_n_f32(r, vld1q_f32(m.m[3]), this->w);
+         vst1q_f32(&v.x, r);
+#endif
+         return v;
+      }
+#endif
+      return vec4(this->x * m.m[0][0] + this->y * m.m[1][0] + this->z * m.m[2][0] + this->w * m.m[3][0],
+                  this->x * m.m[0][1] + this->y * m.m[1][1] + this->z * m.m[2][1] + this->w * m.m[3][1],
+                  this->x * m.m[0][2] + this->y * m.m[1][2] + this->z * m.m[2][2] + this->w * m.m[3][2],
+                  this->x * m.m[0][3] + this->y * m.m[1][3] + this->z * m.m[2][3] + this->w * m.m[3][3]);
+   }
+
+   // Overload for multiplying against an affine matrix, the translation is scaled by w so
+   // directions (w = 0) are only rotated, and w is kept
+   constexpr vec4 operator * (const mat3x4& m) const {
+#if defined(MATH_SSE)
+      if (!std::is_constant_evaluated()) {
+         // One dot product per row, the horizontal adds leave (x y z 0) and w is put back in
+         __m128 p = _mm_load_ps(&this->x);
+         __m128 r0 = _mm_mul_ps(_mm_load_ps(m.m[0]), p);
+         __m128 r1 = _mm_mul_ps(_mm_load_ps(m.m[1]), p);
+         __m128 r2 = _mm_mul_ps(_mm_load_ps(m.m[2]), p);
+         __m128 r = _mm_hadd_ps(_mm_hadd_ps(r0, r1), _mm_hadd_ps(r2, _mm_setzero_ps()));
+         vec4 v;
+         _mm_store_ps(&v.x, _mm_blend_ps(r, p, 0x8));
+         return v;
+      }
+#endif
+      return vec4(this->x * m.m[0][0] + this->y * m.m[0][1] + this->z * m.m[0][2] + this->w * m.m[0][3],
+                  this->x * m.m[1][0] + this->y * m.m[1][1] + this->z * m.m[1][2] + this->w * m.m[1][3],
+                  this->x * m.m[2][0] + this->y * m.m[2][1] + this->z * m.m[2][2] + this->w * m.m[2][3], this->w);
+   }
+
+   constexpr void operator *= (const mat3x4& m) { *this = *this * m; }
+   constexpr void operator *= (const mat4x4& m) { *this = *this * m; }
+};
+
+static_assert(sizeof(vec3) == 12 && sizeof(vec4) == 16, "vec3 is packed and vec4 fills one SIMD register");
+
+
 //XXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXX
 // Matrix Functions
 //XXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXX
 
-/// @brief: Creates a matrix that will move a vertex in 3D space to a position that reflects its
-/// position reletive to the camera view. Essentially moving the world around a camera instead 
-/// of moving the camera. The camera view is represented by a matrix created with the "point_matrix"
-/// the direction and position given to the "point_matrix" represents the camera
-/// @param m: point_matrix result representing the camera (by reference)
-/// @return mat4x4
+/// @brief: Creates a matrix that scales a vertex along each axis
+/// @param sx: x scale
+/// @param sy: y scale
+/// @param sz: z scale
+/// @return mat3x4
 ///
-mat4x4 matrix_scale(float sx, float sy, float sz);
+constexpr mat3x4 matrix_scale(float sx, float sy, float sz) {
+   mat3x4 m;
+   m.m[0][0] = sx;   m.m[0][1] = 0.0f; m.m[0][2] = 0.0f; m.m[0][3] = 0.0f;
+   m.m[1][0] = 0.0f; m.m[1][1] = sy;   m.m[1][2] = 0.0f; m.m[1][3] = 0.0f;
+   m.m[2][0] = 0.0f; m.m[2][1] = 0.0f; m.m[2][2] = sz;   m.m[2][3] = 0.0f;
+   return m;
+}
 
-/// @brief: Creates a 4x4 matrix that can be used to translate and rotate (in radians) a vertex 
+/// @brief: Creates a matrix that can be used to translate and rotate (in radians) a vertex. For
+/// orientations that keep changing a quat with the quaternion.hpp overload avoids gimbal lock
 /// @param x: x translation
 /// @param y: y translation
 /// @param z: z translation
 /// @param u: u rotation around origin in radians
 /// @param v: v rotation around origin in radians
 /// @param w: w rotation around origin in radians
-/// @return mat4x4
+/// @return mat3x4
 ///
-mat4x4 matrix_transform(float x, float y, float z, float u, float v, float w);
+constexpr mat3x4 matrix_transform(float x, float y, float z, float u, float v, float w) {
+   // I got to these values by multiplying the transformation matrix and all of the 
+   // rotation matrices and simplifying down the expressions. Each angle only needs one sincos
+   float su, cu, sv, cv, sw, cw;
+   math_sincos(u, su, cu);
+   math_sincos(v, sv, cv);
+   math_sincos(w, sw, cw);
+
+   mat3x4 m;
+   m.m[0][0] = cv*cw;  m.m[0][1] = -su*sv*cw - cu*sw;  m.m[0][2] = -cu*sv*cw + su*sw;  m.m[0][3] = x;
+   m.m[1][0] = cv*sw;  m.m[1][1] = -su*sv*sw + cu*cw;  m.m[1][2] = -cu*sv*sw - su*cw;  m.m[1][3] = y;
+   m.m[2][0] = sv;     m.m[2][1] = su*cv;              m.m[2][2] = cu*cv;              m.m[2][3] = z;
+   return m;
+}
 
 /// @brief: Creates the 3d projection matrix that transforms a 3D vertex to screen space
 /// @param fov: Field of view in degrees
@@ -163,22 +508,385 @@ mat4x4 matrix_transform(float x, float y, float z, float u, float v, float w);
 /// @param f: Position in pixel scale of the far plane
 /// @return mat4x4
 ///
-mat4x4 matrix_project(float fov, float a, float n, float f);
+constexpr mat4x4 matrix_project(float fov, float a, float n, float f) {
+   // m[1][1] is normally negative but since we are drawing as y = 0 is at the top of the screen
+   // we need to invert the y values since y = 0 should be towards the bottom of the screen for most OBJ meshes
+   float fovRadians = fov * (3.14159265358979323846 / 180.0); // Convert degrees to radians
+   float s, c;
+   math_sincos(fovRadians / 2.0f, s, c);
+   float tanHalfFOV = s / c;
+
+   float t = tanHalfFOV * n;
+   float b = -t;
+   float r = t * a;
+   float l = -r;
+
+   mat4x4 m;
+   m.m[0][0] = (2.0f*n)/(r-l);  m.m[0][1] = 0.0f;             m.m[0][2] = 0.0f;                m.m[0][3] = 0.0f;
+   m.m[1][0] = 0.0f;            m.m[1][1] = (2.0f*n)/(t-b);   m.m[1][2] = 0.0f;                m.m[1][3] = 0.0f;
+   m.m[2][0] = (r+l)/(r-l);     m.m[2][1] = (t+b)/(t-b);      m.m[2][2] = -(f+n)/(f-n);        m.m[2][3] = -1.0f;
+   m.m[3][0] = 0.0f;            m.m[3][1] = 0.0f;             m.m[3][2] = -(2.0f*f*n)/(f-n);   m.m[3][3] = 0.0f;
+   return m;
+}
 
 /// @brief: Creates a matrix that will rotate a 3D vertex around its origin so the z axis
 /// points towards the provided 3D vertex
 /// @param pos: vec3 of the origin position of the object (by reference)
 /// @param target: vec3 position of the point for the object to point at (by reference)
 /// @param up: vec3 of the direction of the y axis (by reference)
-/// @return mat4x4
+/// @return mat3x4
 ///
-mat4x4 matrix_pointAt(vec3 &pos, vec3 &target, vec3 &up);
+constexpr mat3x4 matrix_pointAt(const vec3 &pos, const vec3 &target, const vec3 &up) {
+
+   // Calculate new Up direction
+   vec3 a = target * up.dot(target);
+   vec3 newUp = (up - a).normal();
+   // New Right direction is just the cross product
+   vec3 newRight = newUp.cross(target);
+
+   mat3x4 m;
+   m.m[0][0] = newRight.x; m.m[0][1] = newUp.x; m.m[0][2] = target.x; m.m[0][3] = pos.x;
+   m.m[1][0] = newRight.y; m.m[1][1] = newUp.y; m.m[1][2] = target.y; m.m[1][3] = pos.y;
+   m.m[2][0] = newRight.z; m.m[2][1] = newUp.z; m.m[2][2] = target.z; m.m[2][3] = pos.z;
+   return m;
+}
 
 /// @brief: Creates a matrix that will move a vertex in 3D space to a position that reflects its
 /// position reletive to the camera view. Essentially moving the world around a camera instead 
 /// of moving the camera. The camera view is represented by a matrix created with the "point_matrix"
 /// the direction and position given to the "point_matrix" represents the camera
 /// @param m: point_matrix result representing the camera (by reference)
+/// @return mat3x4
+///
+constexpr mat3x4 matrix_view(const mat3x4 &m) {
+   //This is basically creating the inverse of the input matrix
+   mat3x4 m2;
+   m2.m[0][0] = m.m[0][0]; m2.m[1][0] = m.m[0][1]; m2.m[2][0] = m.m[0][2];
+   m2.m[0][1] = m.m[1][0]; m2.m[1][1] = m.m[1][1]; m2.m[2][1] = m.m[1][2];
+   m2.m[0][2] = m.m[2][0]; m2.m[1][2] = m.m[2][1]; m2.m[2][2] = m.m[2][2];
+
+   m2.m[0][3] = -(m.m[0][3] * m2.m[0][0] + m.m[1][3] * m2.m[0][1] + m.m[2][3] * m2.m[0][2]);
+   m2.m[1][3] = -(m.m[0][3] * m2.m[1][0] + m.m[1][3] * m2.m[1][1] + m.m[2][3] * m2.m[1][2]);
+   m2.m[2][3] = -(m.m[0][3] * m2.m[2][0] + m.m[1][3] * m2.m[2][1] + m.m[2][3] * m2.m[2][2]);
+   return m2;
+}
+
+/// @brief: Swaps the rows and columns of a matrix
+/// @param m: Matrix to transpose
 /// @return mat4x4
 ///
-mat4x4 matrix_view(mat4x4 &m);
+constexpr mat4x4 matrix_transpose(const mat4x4 &m) {
+   mat4x4 m2;
+#if defined(MATH_SIMD)
+   if (!std::is_constant_evaluated()) {
+#if defined(MATH_SSE)
+      __m128 c0 = _mm_load_ps(m.m[0]);
+      __m128 c1 = _mm_load_ps(m.m[1]);
+      __m128 c2 = _mm_load_ps(m.m[2]);
+      __m128 c3 = _mm_load_ps(m.m[3]);
+      _MM_TRANSPOSE4_PS(c0, c1, c2, c3);
+      _mm_store_ps(m2.m[0], c0);
+      _mm_store_ps(m2.m[1], c1);
+      _mm_store_ps(m2.m[2], c2);
+      _mm_store_ps(m2.m[3], c3);
+#elif defined(MATH_NEON)
+      // The interleaved load splits every 4th float into its own register, which is the transpose
+      float32x4x4_t t = vld4q_f32(&m.m[0][0]);
+      vst1q_f32(m2.m[0], t.val[0]);
+      vst1q_f32(m2.m[1], t.val[1]);
+      vst1q_f32(m2.m[2], t.val[2]);
+      vst1q_f32(m2.m[3], t.val[3]);
+#endif
+      return m2;
+   }
+#endif
+   for (int i = 0; i < 4; i++)
+      for (int j = 0; j < 4; j++)
+         m2.m[i][j] = m.m[j][i];
+   return m2;
+}
+
+#if defined(MATH_SSE)
+// Helpers for the 2x2 block inverse below. A 2x2 matrix is stored in one register as (a b c d)
+#define SHUFFLE_MASK(x,y,z,w) ((x) | ((y) << 2) | ((z) << 4) | ((w) << 6))
+#define SWIZZLE(v, x,y,z,w) _mm_shuffle_ps(v, v, SHUFFLE_MASK(x,y,z,w))
+#define SHUFFLE(a, b, x,y,z,w) _mm_shuffle_ps(a, b, SHUFFLE_MASK(x,y,z,w))
+
+namespace matrix_sse {
+
+// 2x2 matrix multiply A*B
+inline __m128 mat2Mul(__m128 a, __m128 b) {
+   return _mm_add_ps(_mm_mul_ps(a, SWIZZLE(b, 0,3,0,3)), _mm_mul_ps(SWIZZLE(a, 1,0,3,2), SWIZZLE(b, 2,1,2,1)));
+}
+// 2x2 matrix adjugate multiply adj(A)*B
+inline __m128 mat2AdjMul(__m128 a, __m128 b) {
+   return _mm_sub_ps(_mm_mul_ps(SWIZZLE(a, 3,3,0,0), b), _mm_mul_ps(SWIZZLE(a, 1,1,2,2), SWIZZLE(b, 2,3,0,1)));
+}
+// 2x2 matrix multiply adjugate A*adj(B)
+inline __m128 mat2MulAdj(__m128 a, __m128 b) {
+   return _mm_sub_ps(_mm_mul_ps(a, SWIZZLE(b, 3,0,3,0)), _mm_mul_ps(SWIZZLE(a, 1,0,3,2), SWIZZLE(b, 2,1,2,1)));
+}
+
+}
+#endif
+
+/// @brief: Whether a determinant is far enough from 0 for the inverse to mean anything. It is at
+/// most the product of the lengths of the rows (Hadamard), and a rank deficient matrix in floats
+/// rounds to a few ulps of that rather than to exactly 0
+/// @param det: Determinant
+/// @param rows: Rows (or columns) of the matrix
+/// @param count: Number of rows, and of their elements that count
+/// @return bool
+///
+constexpr bool matrix_invertible(float det, const float (*rows)[4], int count) {
+   float lengths = 1.0f;
+   for (int r = 0; r < count; r++) {
+      float sum = 0.0f;
+      for (int c = 0; c < count; c++) sum += rows[r][c] * rows[r][c];
+      lengths *= math_sqrt(sum);
+   }
+   // Also false for a nan or infinite determinant
+   return (det < 0.0f ? -det : det) > 1e-6f * lengths;
+}
+
+/// @brief: General inverse of a 4x4 matrix (works for projections too, unlike matrix_view which
+/// only inverts rotation + translation)
+/// @param m: Matrix to invert
+/// @param invertible: Optional, set to false when the matrix is singular (up to float rounding)
+/// and the result is garbage
+/// @return mat4x4
+///
+constexpr mat4x4 matrix_inverse(const mat4x4 &m, bool *invertible = nullptr) {
+   mat4x4 m2;
+#if defined(MATH_SSE)
+   if (!std::is_constant_evaluated()) {
+      // Block matrix inverse: the matrix is split into the 2x2 blocks | A B |
+      //                                                               | C D |
+      // inverse(transpose(M)) = transpose(inverse(M)) so it does not matter that the columns are
+      // used as rows here
+      __m128 c0 = _mm_load_ps(m.m[0]);
+      __m128 c1 = _mm_load_ps(m.m[1]);
+      __m128 c2 = _mm_load_ps(m.m[2]);
+      __m128 c3 = _mm_load_ps(m.m[3]);
+      __m128 A = _mm_movelh_ps(c0, c1);
+      __m128 B = _mm_movehl_ps(c1, c0);
+      __m128 C = _mm_movelh_ps(c2, c3);
+      __m128 D = _mm_movehl_ps(c3, c2);
+
+      // Determinants of the blocks as (|A| |B| |C| |D|)
+      __m128 detSub = _mm_sub_ps(_mm_mul_ps(SHUFFLE(c0, c2, 0,2,0,2), SHUFFLE(c1, c3, 1,3,1,3)),
+                                 _mm_mul_ps(SHUFFLE(c0, c2, 1,3,1,3), SHUFFLE(c1, c3, 0,2,0,2)));
+      __m128 detA = SWIZZLE(detSub, 0,0,0,0);
+      __m128 detB = SWIZZLE(detSub, 1,1,1,1);
+      __m128 detC = SWIZZLE(detSub, 2,2,2,2);
+      __m128 detD = SWIZZLE(detSub, 3,3,3,3);
+
+      __m128 D_C = matrix_sse::mat2AdjMul(D, C);
+      __m128 A_B = matrix_sse::mat2AdjMul(A, B);
+      // Adjugates of the result blocks | X Y |
+      //                                | Z W |
+      __m128 X = _mm_sub_ps(_mm_mul_ps(detD, A), matrix_sse::mat2Mul(B, D_C));
+      __m128 W = _mm_sub_ps(_mm_mul_ps(detA, D), matrix_sse::mat2Mul(C, A_B));
+      __m128 Y = _mm_sub_ps(_mm_mul_ps(detB, C), matrix_sse::mat2MulAdj(D, A_B));
+      __m128 Z = _mm_sub_ps(_mm_mul_ps(detC, B), matrix_sse::mat2MulAdj(A, D_C));
+
+      // |M| = |A||D| + |B||C| - trace(adj(A)B adj(D)C)
+      __m128 detM = _mm_add_ps(_mm_mul_ps(detA, detD), _mm_mul_ps(detB, detC));
+      __m128 tr = _mm_mul_ps(A_B, SWIZZLE(D_C, 0,2,1,3));
+      tr = _mm_hadd_ps(tr, tr);
+      tr = _mm_hadd_ps(tr, tr);
+      detM = _mm_sub_ps(detM, tr);
+
+      // Scale by 1/|M| with the signs of the 2x2 adjugate
+      __m128 rDetM = _mm_div_ps(_mm_setr_ps(1.0f, -1.0f, -1.0f, 1.0f), detM);
+      if (invertible) *invertible = matrix_invertible(_mm_cvtss_f32(detM), m.m, 4);
+      X = _mm_mul_ps(X, rDetM);
+      Y = _mm_mul_ps(Y, rDetM);
+      Z = _mm_mul_ps(Z, rDetM);
+      W = _mm_mul_ps(W, rDetM);
+
+      // Finish the adjugates and put the blocks back together in one shuffle per column
+      _mm_store_ps(m2.m[0], SHUFFLE(X, Y, 3,1,3,1));
+      _mm_store_ps(m2.m[1], SHUFFLE(X, Y, 2,0,2,0));
+      _mm_store_ps(m2.m[2], SHUFFLE(Z, W, 3,1,3,1));
+      _mm_store_ps(m2.m[3], SHUFFLE(Z, W, 2,0,2,0));
+      return m2;
+   }
+#endif
+   // Cofactor expansion, the 2x2 sub determinants of the first two and last two columns are shared
+   const float (*a)[4] = m.m;
+   float s0 = a[0][0] * a[1][1] - a[1][0] * a[0][1];
+   float s1 = a[0][0] * a[1][2] - a[1][0] * a[0][2];
+   float s2 = a[0][0] * a[1][3] - a[1][0] * a[0][3];
+   float s3 = a[0][1] * a[1][2] - a[1][1] * a[0][2];
+   float s4 = a[0][1] * a[1][3] - a[1][1] * a[0][3];
+   float s5 = a[0][2] * a[1][3] - a[1][2] * a[0][3];
+
+   float c5 = a[2][2] * a[3][3] - a[3][2] * a[2][3];
+   float c4 = a[2][1] * a[3][3] - a[3][1] * a[2][3];
+   float c3 = a[2][1] * a[3][2] - a[3][1] * a[2][2];
+   float c2 = a[2][0] * a[3][3] - a[3][0] * a[2][3];
+   float c1 = a[2][0] * a[3][2] - a[3][0] * a[2][2];
+   float c0 = a[2][0] * a[3][1] - a[3][0] * a[2][1];
+
+   float det = s0 * c5 - s1 * c4 + s2 * c3 + s3 * c2 - s4 * c1 + s5 * c0;
+   if (invertible) *invertible = matrix_invertible(det, m.m, 4);
+   float invDet = 1.0f / det;
+
+   m2.m[0][0] = ( a[1][1] * c5 - a[1][2] * c4 + a[1][3] * c3) * invDet;
+   m2.m[0][1] = (-a[0][1] * c5 + a[0][2] * c4 - a[0][3] * c3) * invDet;
+   m2.m[0][2] = ( a[3][1] * s5 - a[3][2] * s4 + a[3][3] * s3) * invDet;
+   m2.m[0][3] = (-a[2][1] * s5 + a[2][2] * s4 - a[2][3] * s3) * invDet;
+
+   m2.m[1][0] = (-a[1][0] * c5 + a[1][2] * c2 - a[1][3] * c1) * invDet;
+   m2.m[1][1] = ( a[0][0] * c5 - a[0][2] * c2 + a[0][3] * c1) * invDet;
+   m2.m[1][2] = (-a[3][0] * s5 + a[3][2] * s2 - a[3][3] * s1) * invDet;
+   m2.m[1][3] = ( a[2][0] * s5 - a[2][2] * s2 + a[2][3] * s1) * invDet;
+
+   m2.m[2][0] = ( a[1][0] * c4 - a[1][1] * c2 + a[1][3] * c0) * invDet;
+   m2.m[2][1] = (-a[0][0] * c4 + a[0][1] * c2 - a[0][3] * c0) * invDet;
+   m2.m[2][2] = ( a[3][0] * s4 - a[3][1] * s2 + a[3][3] * s0) * invDet;
+   m2.m[2][3] = (-a[2][0] * s4 + a[2][1] * s2 - a[2][3] * s0) * invDet;
+
+   m2.m[3][0] = (-a[1][0] * c3 + a[1][1] * c1 - a[1][2] * c0) * invDet;
+   m2.m[3][1] = ( a[0][0] * c3 - a[0][1] * c1 + a[0][2] * c0) * invDet;
+   m2.m[3][2] = (-a[3][0] * s3 + a[3][1] * s1 - a[3][2] * s0) * invDet;
+   m2.m[3][3] = ( a[2][0] * s3 - a[2][1] * s1 + a[2][2] * s0) * invDet;
+   return m2;
+}
+
+#if defined(MATH_SSE)
+#undef SHUFFLE_MASK
+#undef SWIZZLE
+#undef SHUFFLE
+#endif
+
+/// @brief: Inverse of an affine matrix (any rotation, scale and translation, not only rigid ones
+/// like matrix_view)
+/// @param m: Matrix to invert
+/// @param invertible: Optional, set to false when the 3x3 part is singular (up to float rounding)
+/// @return mat3x4
+///
+constexpr mat3x4 matrix_inverse(const mat3x4 &m, bool *invertible = nullptr) {
+   mat3x4 m2;
+#if defined(MATH_SSE)
+   if (!std::is_constant_evaluated()) {
+      // The columns of the inverse of a 3x3 matrix with rows a,b,c are bxc, cxa and axb divided
+      // by the determinant a.(bxc). The translation (4th lane of each row) rides along in a,b,c
+      __m128 a = _mm_load_ps(m.m[0]);
+      __m128 b = _mm_load_ps(m.m[1]);
+      __m128 c = _mm_load_ps(m.m[2]);
+      auto cross = [](__m128 u, __m128 v) {
+         __m128 uYZX = _mm_shuffle_ps(u, u, _MM_SHUFFLE(3,0,2,1));
+         __m128 vYZX = _mm_shuffle_ps(v, v, _MM_SHUFFLE(3,0,2,1));
+         __m128 r = _mm_sub_ps(_mm_mul_ps(u, vYZX), _mm_mul_ps(uYZX, v));
+         return _mm_shuffle_ps(r, r, _MM_SHUFFLE(3,0,2,1));
+      };
+      __m128 bc = cross(b, c);
+      __m128 ca = cross(c, a);
+      __m128 ab = cross(a, b);
+      __m128 det = _mm_dp_ps(a, bc, 0x7F);
+      if (invertible) *invertible = matrix_invertible(_mm_cvtss_f32(det), m.m, 3);
+      __m128 invDet = _mm_div_ps(_mm_set1_ps(1.0f), det);
+
+      // Transposing (bc ca ab 0) gives the rows of the inverse
+      __m128 w = _mm_setzero_ps();
+      _MM_TRANSPOSE4_PS(bc, ca, ab, w);
+      __m128 t = _mm_setr_ps(m.m[0][3], m.m[1][3], m.m[2][3], 0.0f);
+      bc = _mm_mul_ps(bc, invDet);
+      ca = _mm_mul_ps(ca, invDet);
+      ab = _mm_mul_ps(ab, invDet);
+
+      // The translation is undone after the rotation/scale: -(inverse * t), stored in the 4th lane
+      __m128 zero = _mm_setzero_ps();
+      _mm_store_ps(m2.m[0], _mm_blend_ps(bc, _mm_sub_ps(zero, _mm_dp_ps(bc, t, 0x7F)), 0x8));
+      _mm_store_ps(m2.m[1], _mm_blend_ps(ca, _mm_sub_ps(zero, _mm_dp_ps(ca, t, 0x7F)), 0x8));
+      _mm_store_ps(m2.m[2], _mm_blend_ps(ab, _mm_sub_ps(zero, _mm_dp_ps(ab, t, 0x7F)), 0x8));
+      return m2;
+   }
+#endif
+   // Inverse of the 3x3 part from its cofactors (the adjugate divided by the determinant)
+   const float (*a)[4] = m.m;
+   m2.m[0][0] = a[1][1] * a[2][2] - a[1][2] * a[2][1];
+   m2.m[1][0] = a[1][2] * a[2][0] - a[1][0] * a[2][2];
+   m2.m[2][0] = a[1][0] * a[2][1] - a[1][1] * a[2][0];
+   m2.m[0][1] = a[2][1] * a[0][2] - a[2][2] * a[0][1];
+   m2.m[1][1] = a[2][2] * a[0][0] - a[2][0] * a[0][2];
+   m2.m[2][1] = a[2][0] * a[0][1] - a[2][1] * a[0][0];
+   m2.m[0][2] = a[0][1] * a[1][2] - a[0][2] * a[1][1];
+   m2.m[1][2] = a[0][2] * a[1][0] - a[0][0] * a[1][2];
+   m2.m[2][2] = a[0][0] * a[1][1] - a[0][1] * a[1][0];
+
+   float det = a[0][0] * m2.m[0][0] + a[0][1] * m2.m[1][0] + a[0][2] * m2.m[2][0];
+   if (invertible) *invertible = matrix_invertible(det, m.m, 3);
+   float invDet = 1.0f / det;
+   for (int i = 0; i < 3; i++)
+      for (int j = 0; j < 3; j++) m2.m[i][j] *= invDet;
+
+   // The translation is undone after the rotation/scale: -(inverse * t)
+   for (int i = 0; i < 3; i++)
+      m2.m[i][3] = -(m2.m[i][0] * a[0][3] + m2.m[i][1] * a[1][3] + m2.m[i][2] * a[2][3]);
+   return m2;
+}
+
+/// @brief: Creates the matrix that transforms normals: the inverse transpose of the rotation/scale
+/// part, so normals stay perpendicular to their surface under non-uniform scale. The translation
+/// is 0, directions do not move
+/// @param m: Matrix the positions are transformed with (eg. model-view)
+/// @return mat3x4
+///
+constexpr mat3x4 matrix_normal(const mat3x4 &m) {
+   // Transposing the inverse only swaps rows and columns of the 3x3 part
+   mat3x4 inverse = matrix_inverse(m);
+   mat3x4 n;
+   for (int r = 0; r < 3; r++) {
+      for (int c = 0; c < 3; c++) n.m[r][c] = inverse.m[c][r];
+      n.m[r][3] = 0.0f;
+   }
+   return n;
+}
+
+
+/// @brief: The 6 planes bounding what a camera sees. Each plane is stored in a vec4 as the unit
+/// normal (x,y,z, pointing inside) and the distance w, so a point p is inside a plane when
+/// p.x*x + p.y*y + p.z*z + w >= 0
+struct frustum {
+
+   // Left, right, bottom, top, near, far
+   vec4 planes[6];
+
+   /// @brief: Signed distance from a plane to a point, negative outside
+   static constexpr float distance(const vec4 &plane, const vec3 &p) {
+      return plane.x * p.x + plane.y * p.y + plane.z * p.z + plane.w;
+   }
+
+   /// @brief: False only if the sphere is completely outside one of the planes (for culling, spheres
+   /// near the corners can pass without being visible)
+   constexpr bool sphereVisible(const vec3 &center, float radius) const {
+      for (int i = 0; i < 6; i++)
+         if (distance(planes[i], center) < -radius) return false;
+      return true;
+   }
+};
+
+/// @brief: Extracts the frustum planes from a projection or a combined view-projection matrix
+/// (Gribb-Hartmann). With only a projection the planes are in view space, with view * project they
+/// are in world space, with model * view * project in the object's space
+/// @param m: Matrix from matrix_project, eg. view.toMat4() * project
+/// @return frustum
+///
+constexpr frustum matrix_frustum(const mat4x4 &m) {
+   // Clip space is inside when -w <= x,y,z <= w. Row i of the math matrix is (m[0][i] .. m[3][i])
+   // since the storage is by columns, and w +- row i >= 0 is the plane
+   frustum f;
+   for (int i = 0; i < 3; i++) {
+      for (int side = 0; side < 2; side++) {
+         float sign = side == 0 ? 1.0f : -1.0f;
+         vec4 plane(m.m[0][3] + sign * m.m[0][i], m.m[1][3] + sign * m.m[1][i], m.m[2][3] + sign * m.m[2][i], m.m[3][3] + sign * m.m[3][i]);
+         // Normalized so distance is in world units
+         float length = math_sqrt(plane.x * plane.x + plane.y * plane.y + plane.z * plane.z);
+         f.planes[i * 2 + side] = plane / length;
+      }
+   }
+   return f;
+}
@@ -0,0 +1,406 @@
+//////////////////////////////////////////////////////////////////
+// Headers
+//////////////////////////////////////////////////////////////////
+#include "noise.hpp"
+#include "parallel.hpp"
+#include "simd.hpp"
+
+#include <algorithm>
+#include <bit>
+#include <cmath>
+#include <vector>
+
+
+// The noise is written once as templates over the number types: F (floats), I (unsigned 32 bit ints)
+// and the masks of their compares. float and std::uint32_t make one sample, the SIMD structs below 8
+// (AVX2) or 4 (SSE) at a time. There are no branches on the values so every lane runs the same code
+
+//////////////////////////////////////////////////////////////////
+// Scalar
+//////////////////////////////////////////////////////////////////
+static inline float floorF(float x) { return std::floor(x); }
+static inline float maxF(float a, float b) { return a > b ? a : b; }
+static inline float absF(float x) { return std::fabs(x); }
+static inline std::uint32_t toInt(float x) { return std::uint32_t(std::int32_t(x)); }
+static inline float toFloat(std::uint32_t x) { return float(std::int32_t(x)); }
+static inline bool greater(float a, float b) { return a > b; }
+static inline bool greaterEqual(float a, float b) { return a >= b; }
+static inline bool lessI(std::uint32_t a, std::uint32_t b) { return a < b; }
+static inline bool equalI(std::uint32_t a, std::uint32_t b) { return a == b; }
+static inline float choose(bool mask, float a, float b) { return mask ? a : b; }
+static inline float one(bool mask) { return mask ? 1.0f : 0.0f; }
+// x with the sign flipped where the given bit of h is set
+static inline float flip(float x, std::uint32_t h, int bit) {
+   return std::bit_cast<float>(std::bit_cast<std::uint32_t>(x) ^ ((h << (31 - bit)) & 0x80000000u));
+}
+
+
+#if defined(MATH_AVX2)
+//////////////////////////////////////////////////////////////////
+// AVX2, 8 lanes
+//////////////////////////////////////////////////////////////////
+struct f8 {
+   __m256 v;
+   f8() = default;
+   f8(__m256 _v) : v(_v) {}
+   f8(float x) : v(_mm256_set1_ps(x)) {}
+   static f8 load(const float* p) { return _mm256_load_ps(p); }
+   void store(float* p) const { _mm256_store_ps(p, v); }
+};
+struct i8 {
+   __m256i v;
+   i8() = default;
+   i8(__m256i _v) : v(_v) {}
+   i8(std::uint32_t x) : v(_mm256_set1_epi32(int(x))) {}
+};
+struct m8 { __m256 v; };
+
+static inline f8 operator+(f8 a, f8 b) { return _mm256_add_ps(a.v, b.v); }
+static inline f8 operator-(f8 a, f8 b) { return _mm256_sub_ps(a.v, b.v); }
+static inline f8 operator*(f8 a, f8 b) { return _mm256_mul_ps(a.v, b.v); }
+static inline i8 operator+(i8 a, i8 b) { return _mm256_add_epi32(a.v, b.v); }
+static inline i8 operator*(i8 a, i8 b) { return _mm256_mullo_epi32(a.v, b.v); }
+static inline i8 operator^(i8 a, i8 b) { return _mm256_xor_si256(a.v, b.v); }
+static inline i8 operator&(i8 a, i8 b) { return _mm256_and_si256(a.v, b.v); }
+static inline i8 operator>>(i8 a, int n) { return _mm256_srl_epi32(a.v, _mm_cvtsi32_si128(n)); }
+static inline i8 operator<<(i8 a, int n) { return _mm256_sll_epi32(a.v, _mm_cvtsi32_si128(n)); }
+static inline f8 floorF(f8 x) { return _mm256_floor_ps(x.v); }
+static inline f8 maxF(f8 a, f8 b) { return _mm256_max_ps(a.v, b.v); }
+static inline f8 absF(f8 x) { return _mm256_andnot_ps(_mm256_set1_ps(-0.0f), x.v); }
+static inline i8 toInt(f8 x) { return _mm256_cvttps_epi32(x.v); }
+static inline f8 toFloat(i8 x) { return _mm256_cvtepi32_ps(x.v); }
+static inline m8 greater(f8 a, f8 b) { return {_mm256_cmp_ps(a.v, b.v, _CMP_GT_OQ)}; }
+static inline m8 greaterEqual(f8 a, f8 b) { return {_mm256_cmp_ps(a.v, b.v, _CMP_GE_OQ)}; }
+// Only used on small positive values so the signed compare is fine
+static inline m8 lessI(i8 a, i8 b) { return {_mm256_castsi256_ps(_mm256_cmpgt_epi32(b.v, a.v))}; }
+static inline m8 equalI(i8 a, i8 b) { return {_mm256_castsi256_ps(_mm256_cmpeq_epi32(a.v, b.v))}; }
+static inline f8 choose(m8 mask, f8 a, f8 b) { return _mm256_blendv_ps(b.v, a.v, mask.v); }
+static inline f8 one(m8 mask) { return _mm256_and_ps(mask.v, _mm256_set1_ps(1.0f)); }
+static inline f8 flip(f8 x, i8 h, int bit) {
+   return _mm256_xor_ps(x.v, _mm256_castsi256_ps((h << (31 - bit) & i8(0x80000000u)).v));
+}
+#endif
+
+
+#if defined(MATH_SSE)
+//////////////////////////////////////////////////////////////////
+// SSE4.1, 4 lanes
+//////////////////////////////////////////////////////////////////
+struct f4 {
+   __m128 v;
+   f4() = default;
+   f4(__m128 _v) : v(_v) {}
+   f4(float x) : v(_mm_set1_ps(x)) {}
+   static f4 load(const float* p) { return _mm_load_ps(p); }
+   void store(float* p) const { _mm_store_ps(p, v); }
+};
+struct i4 {
+   __m128i v;
+   i4() = default;
+   i4(__m128i _v) : v(_v) {}
+   i4(std::uint32_t x) : v(_mm_set1_epi32(int(x))) {}
+};
+struct m4 { __m128 v; };
+
+static inline f4 operator+(f4 a, f4 b) { return _mm_add_ps(a.v, b.v); }
+static inline f4 operator-(f4 a, f4 b) { return _mm_sub_ps(a.v, b.v); }
+static inline f4 operator*(f4 a, f4 b) { return _mm_mul_ps(a.v, b.v); }
+static inline i4 operator+(i4 a, i4 b) { return _mm_add_epi32(a.v, b.v); }
+static inline i4 operator*(i4 a, i4 b) { return _mm_mullo_epi32(a.v, b.v); }
+static inline i4 operator^(i4 a, i4 b) { return _mm_xor_si128(a.v, b.v); }
+static inline i4 operator&(i4 a, i4 b) { return _mm_and_si128(a.v, b.v); }
+static inline i4 operator>>(i4 a, int n) { return _mm_srl_epi32(a.v, _mm_cvtsi32_si128(n)); }
+static inline i4 operator<<(i4 a, int n) { return _mm_sll_epi32(a.v, _mm_cvtsi32_si128(n)); }
+static inline f4 floorF(f4 x) { return _mm_floor_ps(x.v); }
+static inline f4 maxF(f4 a, f4 b) { return _mm_max_ps(a.v, b.v); }
+static inline f4 absF(f4 x) { return _mm_andnot_ps(_mm_set1_ps(-0.0f), x.v); }
+static inline i4 toInt(f4 x) { return _mm_cvttps_epi32(x.v); }
+static inline f4 toFloat(i4 x) { return _mm_cvtepi32_ps(x.v); }
+static inline m4 greater(f4 a, f4 b) { return {_mm_cmpgt_ps(a.v, b.v)}; }
+static inline m4 greaterEqual(f4 a, f4 b) { return {_mm_cmpge_ps(a.v, b.v)}; }
+static inline m4 lessI(i4 a, i4 b) { return {_mm_castsi128_ps(_mm_cmplt_epi32(a.v, b.v))}; }
+static inline m4 equalI(i4 a, i4 b) { return {_mm_castsi128_ps(_mm_cmpeq_epi32(a.v, b.v))}; }
+static inline f4 choose(m4 mask, f4 a, f4 b) { return _mm_blendv_ps(b.v, a.v, mask.v); }
+static inline f4 one(m4 mask) { return _mm_and_ps(mask.v, _mm_set1_ps(1.0f)); }
+static inline f4 flip(f4 x, i4 h, int bit) {
+   return _mm_xor_ps(x.v, _mm_castsi128_ps((h << (31 - bit) & i4(0x80000000u)).v));
+}
+#endif
+
+
+
+//////////////////////////////////////////////////////////////////
+// Kernels
+//////////////////////////////////////////////////////////////////
+// Hash of a lattice point, one multiply per axis and a final mix
+template <typename I, int dims>
+static inline I hash(I seed, const I (&cell)[dims]) {
+   static const std::uint32_t primes[4] = {501125321u, 1136930381u, 1720413743u, 1066037191u};
+   I h = seed;
+   for (int d = 0; d < dims; d++) h = h ^ cell[d] * I(primes[d]);
+   h = h * I(0x27d4eb2du);
+   return h ^ (h >> 15);
+}
+
+// Gradients with a length of about 1, picked and signed by the low bits of the hash
+template <typename F, typename I>
+static inline F grad(I h, F x, F y) {
+   // (+-1, +-0.5) and (+-0.5, +-1)
+   auto swap = equalI(h & I(4u), I(0u));
+   return flip(choose(swap, x, y), h, 0) + flip(choose(swap, y, x), h, 1) * 0.5f;
+}
+
+template <typename F, typename I>
+static inline F grad(I h, F x, F y, F z) {
+   // The 12 edges of a cube (Perlin's improved noise)
+   I c = h & I(15u);
+   F u = choose(lessI(c, I(8u)), x, y);
+   F v = choose(lessI(c, I(4u)), y, choose(equalI(c & I(13u), I(12u)), x, z));
+   return flip(u, h, 0) + flip(v, h, 1);
+}
+
+template <typename F, typename I>
+static inline F grad(I h, F x, F y, F z, F w) {
+   // The 32 edges of a tesseract, one axis left out and the other three signed
+   I c = h & I(31u);
+   F u = choose(lessI(c, I(24u)), x, y);
+   F v = choose(lessI(c, I(16u)), y, z);
+   F t = choose(lessI(c, I(8u)), z, w);
+   return flip(u, h, 0) + flip(v, h, 1) + flip(t, h, 2);
+}
+
+// Falloff of a simplex corner, (0.5 - r^2)^4 so nothing reaches past the neighbouring simplices
+template <typename F>
+static inline F falloff(F t) {
+   t = maxF(t, F(0.0f));
+   t = t * t;
+   return t * t;
+}
+
+
+// The scales bring the largest possible sums to 1 (measured)
+template <typename F, typename I>
+static F simplex(F x, F y, I seed) {
+   const float skew = 0.36602540378f, unskew = 0.21132486540f;
+   F s = (x + y) * skew;
+   F fi = floorF(x + s), fj = floorF(y + s);
+   F t = (fi + fj) * unskew;
+   F x0 = x - (fi - t), y0 = y - (fj - t);
+   // Which of the 2 triangles of the skewed square
+   F i1 = one(greater(x0, y0)), j1 = F(1.0f) - i1;
+   F x1 = x0 - i1 + unskew, y1 = y0 - j1 + unskew;
+   F x2 = x0 - 1.0f + 2.0f * unskew, y2 = y0 - 1.0f + 2.0f * unskew;
+
+   I i = toInt(fi), j = toInt(fj);
+   F n = falloff(F(0.5f) - x0 * x0 - y0 * y0) * grad(hash(seed, {i, j}), x0, y0);
+   n = n + falloff(F(0.5f) - x1 * x1 - y1 * y1) * grad(hash(seed, {i + toInt(i1), j + toInt(j1)}), x1, y1);
+   n = n + falloff(F(0.5f) - x2 * x2 - y2 * y2) * grad(hash(seed, {i + I(1u), j + I(1u)}), x2, y2);
+   return n * 89.5f;
+}
+
+template <typename F, typename I>
+static F simplex(F x, F y, F z, I seed) {
+   const float skew = 1.0f / 3.0f, unskew = 1.0f / 6.0f;
+   F s = (x + y + z) * skew;
+   F fi = floorF(x + s), fj = floorF(y + s), fk = floorF(z + s);
+   F t = (fi + fj + fk) * unskew;
+   F x0 = x - (fi - t), y0 = y - (fj - t), z0 = z - (fk - t);
+   // Rank of every axis, the simplex walks from the largest coordinate to the smallest (ties go to the first axis)
+   F rx = one(greater(x0, y0)) + one(greater(x0, z0));
+   F ry = one(greaterEqual(y0, x0)) + one(greater(y0, z0));
+   F rz = one(greaterEqual(z0, x0)) + one(greaterEqual(z0, y0));
+   F i1 = one(greater(rx, 1.5f)), j1 = one(greater(ry, 1.5f)), k1 = one(greater(rz, 1.5f));
+   F i2 = one(greater(rx, 0.5f)), j2 = one(greater(ry, 0.5f)), k2 = one(greater(rz, 0.5f));
+   F x1 = x0 - i1 + unskew, y1 = y0 - j1 + unskew, z1 = z0 - k1 + unskew;
+   F x2 = x0 - i2 + 2.0f * unskew, y2 = y0 - j2 + 2.0f * unskew, z2 = z0 - k2 + 2.0f * unskew;
+   F x3 = x0 - 1.0f + 3.0f * unskew, y3 = y0 - 1.0f + 3.0f * unskew, z3 = z0 - 1.0f + 3.0f * unskew;
+
+   I i = toInt(fi), j = toInt(fj), k = toInt(fk);
+   F n = falloff(F(0.5f) - x0 * x0 - y0 * y0 - z0 * z0) * grad(hash(seed, {i, j, k}), x0, y0, z0);
+   n = n + falloff(F(0.5f) - x1 * x1 - y1 * y1 - z1 * z1) * grad(hash(seed, {i + toInt(i1), j + toInt(j1), k + toInt(k1)}), x1, y1, z1);
+   n = n + falloff(F(0.5f) - x2 * x2 - y2 * y2 - z2 * z2) * grad(hash(seed, {i + toInt(i2), j + toInt(j2), k + toInt(k2)}), x2, y2, z2);
+   n = n + falloff(F(0.5f) - x3 * x3 - y3 * y3 - z3 * z3) * grad(hash(seed, {i + I(1u), j + I(1u), k + I(1u)}), x3, y3, z3);
+   return n * 76.0f;
+}
+
+template <typename F, typename I>
+static F simplex(F x, F y, F z, F w, I seed) {
+   const float skew = 0.30901699437f, unskew = 0.13819660113f;
+   F s = (x + y + z + w) * skew;
+   F fi = floorF(x + s), fj = floorF(y + s), fk = floorF(z + s), fl = floorF(w + s);
+   F t = (fi + fj + fk + fl) * unskew;
+   F x0 = x - (fi - t), y0 = y - (fj - t), z0 = z - (fk - t), w0 = w - (fl - t);
+   F rx = one(greater(x0, y0)) + one(greater(x0, z0)) + one(greater(x0, w0));
+   F ry = one(greaterEqual(y0, x0)) + one(greater(y0, z0)) + one(greater(y0, w0));
+   F rz = one(greaterEqual(z0, x0)) + one(greaterEqual(z0, y0)) + one(greater(z0, w0));
+   F rw = one(greaterEqual(w0, x0)) + one(greaterEqual(w0, y0)) + one(greaterEqual(w0, z0));
+
+   I i = toInt(fi), j = toInt(fj), k = toInt(fk), l = toInt(fl);
+   F n = falloff(F(0.5f) - x0 * x0 - y0 * y0 - z0 * z0 - w0 * w0) * grad(hash(seed, {i, j, k, l}), x0, y0, z0, w0);
+   // Corners 1 to 3 step along the axes with a rank of at least 3 - c
+   for (int c = 1; c < 4; c++) {
+      float rank = 2.5f - float(c - 1), offset = float(c) * unskew;
+      F ic = one(greater(rx, rank)), jc = one(greater(ry, rank)), kc = one(greater(rz, rank)), lc = one(greater(rw, rank));
+      F xc = x0 - ic + offset, yc = y0 - jc + offset, zc = z0 - kc + offset, wc = w0 - lc + offset;
+      I h = hash(seed, {i + toInt(ic), j + toInt(jc), k + toInt(kc), l + toInt(lc)});
+      n = n + falloff(F(0.5f) - xc * xc - yc * yc - zc * zc - wc * wc) * grad(h, xc, yc, zc, wc);
+   }
+   F x4 = x0 - 1.0f + 4.0f * unskew, y4 = y0 - 1.0f + 4.0f * unskew, z4 = z0 - 1.0f + 4.0f * unskew, w4 = w0 - 1.0f + 4.0f * unskew;
+   n = n + falloff(F(0.5f) - x4 * x4 - y4 * y4 - z4 * z4 - w4 * w4) * grad(hash(seed, {i + I(1u), j + I(1u), k + I(1u), l + I(1u)}), x4, y4, z4, w4);
+   return n * 62.0f;
+}
+
+
+template <typename F, typename I, int dims>
+static F value(const F (&p)[dims], I seed) {
+   I cell[dims];
+   F u[dims];
+   for (int d = 0; d < dims; d++) {
+      F fl = floorF(p[d]);
+      cell[d] = toInt(fl);
+      // Quintic blend, flat at both ends so the slope is continuous across cells
+      F f = p[d] - fl;
+      u[d] = f * f * f * (f * (f * 6.0f - 15.0f) + 10.0f);
+   }
+   // Bit d of a corner is its step along axis d
+   F v[1 << dims] = {};
+   for (int c = 0; c < (1 << dims); c++) {
+      I corner[dims] = {};
+      for (int d = 0; d < dims; d++) corner[d] = (c >> d) & 1 ? cell[d] + I(1u) : cell[d];
+      v[c] = toFloat(hash(seed, corner) >> 8) * (2.0f / 16777216.0f) - 1.0f;
+   }
+   // Blend away one axis at a time
+   for (int d = 0, n = 1 << dims; d < dims; d++) {
+      n >>= 1;
+      for (int c = 0; c < n; c++) v[c] = v[2 * c] + (v[2 * c + 1] - v[2 * c]) * u[d];
+   }
+   return v[0];
+}
+
+
+template <typename F, typename I, int dims>
+static inline F base(const noiseSettings& settings, const F (&p)[dims], I seed) {
+   if (settings.type == NOISE_VALUE) return value(p, seed);
+   if constexpr (dims == 2) return simplex(p[0], p[1], seed);
+   else if constexpr (dims == 3) return simplex(p[0], p[1], p[2], seed);
+   else return simplex(p[0], p[1], p[2], p[3], seed);
+}
+
+
+template <typename F, typename I, int dims>
+static F layer(const noiseSettings& settings, const F (&point)[dims]) {
+   F p[dims] = {};
+   for (int d = 0; d < dims; d++) p[d] = point[d] * settings.frequency;
+
+   if (settings.warp != 0.0f) {
+      // Moved by one octave of the same noise with other seeds, one per axis
+      F q[dims] = {};
+      for (int d = 0; d < dims; d++) q[d] = base(settings, p, I(settings.seed + 0x68E31DA4u * std::uint32_t(d + 1)));
+      for (int d = 0; d < dims; d++) p[d] = p[d] + q[d] * (settings.warp * settings.frequency);
+   }
+   if (settings.fractal == NOISE_SINGLE) return base(settings, p, I(settings.seed));
+
+   F sum = 0.0f;
+   float amplitude = 1.0f, total = 0.0f;
+   for (int octave = 0; octave < std::max(1, settings.octaves); octave++) {
+      F n = base(settings, p, I(settings.seed + 0x9E3779B9u * std::uint32_t(octave)));
+      if (settings.fractal == NOISE_RIDGED) {
+         // Folded at 0 and squared so the creases are sharp peaks, then back to [-1, 1]
+         F r = F(1.0f) - absF(n);
+         n = r * r * 2.0f - 1.0f;
+      }
+      sum = sum + n * amplitude;
+      total += amplitude;
+      amplitude *= settings.gain;
+      for (int d = 0; d < dims; d++) p[d] = p[d] * settings.lacunarity;
+   }
+   return sum * (1.0f / total);
+}
+
+
+
+//////////////////////////////////////////////////////////////////
+// Public functions
+//////////////////////////////////////////////////////////////////
+float noise_simplex(const vec2& p, std::uint32_t seed) { return simplex(p.x, p.y, seed); }
+float noise_simplex(const vec3& p, std::uint32_t seed) { return simplex(p.x, p.y, p.z, seed); }
+float noise_simplex(const vec4& p, std::uint32_t seed) { return simplex(p.x, p.y, p.z, p.w, seed); }
+
+float noise_value(const vec2& p, std::uint32_t seed) { return value<float, std::uint32_t, 2>({p.x, p.y}, seed); }
+float noise_value(const vec3& p, std::uint32_t seed) { return value<float, std::uint32_t, 3>({p.x, p.y, p.z}, seed); }
+float noise_value(const vec4& p, std::uint32_t seed) { return value<float, std::uint32_t, 4>({p.x, p.y, p.z, p.w}, seed); }
+
+float noise_sample(const noiseSettings& settings, const vec2& p) { return layer<float, std::uint32_t, 2>(settings, {p.x, p.y}); }
+float noise_sample(const noiseSettings& settings, const vec3& p) { return layer<float, std::uint32_t, 3>(settings, {p.x, p.y, p.z}); }
+float noise_sample(const noiseSettings& settings, const vec4& p) { return layer<float, std::uint32_t, 4>(settings, {p.x, p.y, p.z, p.w}); }
+
+
+static inline void coordinates(const vec2& v, float* c) { c[0] = v.x; c[1] = v.y; }
+static inline void coordinates(const vec3& v, float* c) { c[0] = v.x; c[1] = v.y; c[2] = v.z; }
+static inline void coordinates(const vec4& v, float* c) { c[0] = v.x; c[1] = v.y; c[2] = v.z; c[3] = v.w; }
+
+
+// Samples points [begin, end) on the calling thread, a partial last group is padded with zeros so
+// every point of a build goes through the same code
+template <int dims, typename V>
+static void sampleRange(const noiseSettings& settings, const V* points, float* out, std::size_t begin, std::size_t end) {
+#if defined(MATH_AVX2) || defined(MATH_SSE)
+#if defined(MATH_AVX2)
+   using F = f8;
+   using I = i8;
+   const std::size_t width = 8;
+#else
+   using F = f4;
+   using I = i4;
+   const std::size_t width = 4;
+#endif
+   alignas(32) float lanes[dims][width];
+   alignas(32) float result[width];
+   for (std::size_t i = begin; i < end; i += width) {
+      std::size_t n = std::min(width, end - i);
+      for (std::size_t k = 0; k < width; k++) {
+         float c[4] = {0.0f, 0.0f, 0.0f, 0.0f};
+         if (k < n) coordinates(points[i + k], c);
+         for (int d = 0; d < dims; d++) lanes[d][k] = c[d];
+      }
+      F p[dims] = {};
+      for (int d = 0; d < dims; d++) p[d] = F::load(lanes[d]);
+      layer<F, I, dims>(settings, p).store(result);
+      std::copy(result, result + n, out + i);
+   }
+#else
+   for (std::size_t i = begin; i < end; i++) {
+      float c[4];
+      coordinates(points[i], c);
+      float p[dims];
+      std::copy(c, c + dims, p);
+      out[i] = layer<float, std::uint32_t, dims>(settings, p);
+   }
+#endif
+}
+
+
+void noise_batch(const noiseSettings& settings, const vec2* points, float* out, std::size_t count) {
+   parallel_for(count, 4096, [&](std::size_t begin, std::size_t end) { sampleRange<2>(settings, points, out, begin, end); });
+}
+
+void noise_batch(const noiseSettings& settings, const vec3* points, float* out, std::size_t count) {
+   parallel_for(count, 4096, [&](std::size_t begin, std::size_t end) { sampleRange<3>(settings, points, out, begin, end); });
+}
+
+void noise_batch(const noiseSettings& settings, const vec4* points, float* out, std::size_t count) {
+   parallel_for(count, 4096, [&](std::size_t begin, std::size_t end) { sampleRange<4>(settings, points, out, begin, end); });
+}
+
+
+void noise_grid(const noiseSettings& settings, float* out, int width, int height, const vec2& origin, float step) {
+   // A few rows per thread at least, each row is one batch
+   std::size_t minRows = std::max<std::size_t>(1, 4096 / std::max(1, width));
+   parallel_for(std::size_t(height), minRows, [&](std::size_t begin, std::size_t end) {
+      std::vector<vec2> row(width);
+      for (std::size_t y = begin; y < end; y++) {
+         for (int x = 0; x < width; x++) row[x] = vec2(origin.x + float(x) * step, origin.y + float(y) * step);
+         sampleRange<2>(settings, row.data(), out + y * width, 0, width);
+      }
+   }, 1);
+}
@@ -0,0 +1,89 @@
+#pragma once
+
+//////////////////////////////////////////////////////////////////
+// Headers
+//////////////////////////////////////////////////////////////////
+#include <cstddef>
+#include <cstdint>
+#include "matrix.hpp"
+
+//////////////////////////////////////////////////////////////////
+/// \brief Base noise of a layer. Simplex is smooth gradient noise (less
+/// grid pattern, cheaper in 4D), value noise is blobbier and cheaper in 2D
+//////////////////////////////////////////////////////////////////
+enum noiseType {
+   NOISE_SIMPLEX,
+   NOISE_VALUE,
+};
+
+//////////////////////////////////////////////////////////////////
+/// \brief How the octaves are added up. Fbm sums smaller and smaller
+/// copies (hills), ridged folds each one around 0 (mountain ridges)
+//////////////////////////////////////////////////////////////////
+enum noiseFractal {
+   NOISE_SINGLE,
+   NOISE_FBM,
+   NOISE_RIDGED,
+};
+
+//////////////////////////////////////////////////////////////////
+/// \brief Everything that describes one noise layer. Every sample is in
+/// [-1, 1] whatever the settings
+/// \param frequency: Features per unit of the first octave
+/// \param lacunarity: Frequency multiplier from one octave to the next
+/// \param gain: Amplitude multiplier from one octave to the next
+/// \param warp: Domain warp, the points are moved by up to this much by
+/// another noise before sampling (0 turns it off)
+/// \param seed: Different seeds give unrelated noise
+//////////////////////////////////////////////////////////////////
+struct noiseSettings {
+   noiseType type = NOISE_SIMPLEX;
+   noiseFractal fractal = NOISE_FBM;
+   int octaves = 5;
+   float frequency = 1.0f;
+   float lacunarity = 2.0f;
+   float gain = 0.5f;
+   float warp = 0.0f;
+   std::uint32_t seed = 0;
+};
+
+
+//////////////////////////////////////////////////////////////////
+/// \brief Single octave simplex noise in [-1, 1], in 2, 3 or 4
+/// dimensions (the 4th is w, eg. time for animated noise)
+//////////////////////////////////////////////////////////////////
+float noise_simplex(const vec2& p, std::uint32_t seed = 0);
+float noise_simplex(const vec3& p, std::uint32_t seed = 0);
+float noise_simplex(const vec4& p, std::uint32_t seed = 0);
+
+//////////////////////////////////////////////////////////////////
+/// \brief Single octave value noise in [-1, 1], random values on the
+/// integer grid blended with a quintic curve
+//////////////////////////////////////////////////////////////////
+float noise_value(const vec2& p, std::uint32_t seed = 0);
+float noise_value(const vec3& p, std::uint32_t seed = 0);
+float noise_value(const vec4& p, std::uint32_t seed = 0);
+
+//////////////////////////////////////////////////////////////////
+/// \brief One sample of a whole layer (base noise, fractal and warp)
+//////////////////////////////////////////////////////////////////
+float noise_sample(const noiseSettings& settings, const vec2& p);
+float noise_sample(const noiseSettings& settings, const vec3& p);
+float noise_sample(const noiseSettings& settings, const vec4& p);
+
+//////////////////////////////////////////////////////////////////
+/// \brief Samples a layer at many points, 8 at a time with AVX2 (4 with
+/// SSE) and split over the hardware threads when there are enough. Gives
+/// the same values as noise_sample up to float rounding
+/// \param points: Positions to sample (eg. the vertices of a planet)
+/// \param out: One value per point
+//////////////////////////////////////////////////////////////////
+void noise_batch(const noiseSettings& settings, const vec2* points, float* out, std::size_t count);
+void noise_batch(const noiseSettings& settings, const vec3* points, float* out, std::size_t count);
+void noise_batch(const noiseSettings& settings, const vec4* points, float* out, std::size_t count);
+
+//////////////////////////////////////////////////////////////////
+/// \brief Fills a 2D height map, out[y * width + x] is the sample at
+/// origin + (x, y) * step. Rows are split over the hardware threads
+//////////////////////////////////////////////////////////////////
+void noise_grid(const noiseSettings& settings, float* out, int width, int height, const vec2& origin, float step);
@@ -0,0 +1,37 @@
+#pragma once
+
+//////////////////////////////////////////////////////////////////
+// Headers
+//////////////////////////////////////////////////////////////////
+#include <algorithm>
+#include <cstddef>
+#include <thread>
+#include <vector>
+
+//////////////////////////////////////////////////////////////////
+/// \brief Splits [0, count) into one contiguous range per hardware thread and
+/// calls f(begin, end) for every range, the last one on the calling thread.
+/// Small jobs (less than 2 ranges of minRange) just run on the calling thread
+/// \param count: Number of elements
+/// \param minRange: Smallest range worth starting a thread for
+/// \param f: Callable taking (std::size_t begin, std::size_t end)
+/// \param align: Range boundaries are rounded to a multiple of this so SIMD
+/// loops only see a partial batch at the very end (Default: 16)
+//////////////////////////////////////////////////////////////////
+template <typename F>
+void parallel_for(std::size_t count, std::size_t minRange, F f, std::size_t align = 16) {
+
+   std::size_t threads = std::max<std::size_t>(1, std::thread::hardware_concurrency());
+   threads = std::min(threads, count / std::max<std::size_t>(1, minRange));
+   if (threads <= 1) { f(0, count); return; }
+
+   std::size_t range = (count / threads + align - 1) / align * align;
+   std::vector<std::thread> workers;
+   std::size_t begin = 0;
+   while (begin + range < count) {
+      workers.emplace_back(f, begin, begin + range);
+      begin += range;
+   }
+   f(begin, count);
+   for (std::thread& worker : workers) worker.join();
+}
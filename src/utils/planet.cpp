@@ -0,0 +1,225 @@
+//////////////////////////////////////////////////////////////////
+// Headers
+//////////////////////////////////////////////////////////////////
+#include "planet.hpp"
+#include "parallel.hpp"
+
+#include <algorithm>
+
+
+// The 20 triangles of the icosahedron with their shared edges. Every corner and edge is owned by
+// the first face that uses it, only the owner writes its vertices
+struct icosahedron {
+   vec3 corners[12];
+   int faces[20][3];
+   int edges[30][2];
+   int faceEdges[20][3];
+   int edgeOwner[30];
+   int cornerOwner[12];
+};
+
+static const icosahedron& icosahedron_base() {
+   static const icosahedron ico = [] {
+      icosahedron b;
+      const float t = 1.61803398875f;
+      const float corners[12][3] = {{-1, t, 0}, {1, t, 0}, {-1, -t, 0}, {1, -t, 0}, {0, -1, t}, {0, 1, t},
+                                    {0, -1, -t}, {0, 1, -t}, {t, 0, -1}, {t, 0, 1}, {-t, 0, -1}, {-t, 0, 1}};
+      const int faces[20][3] = {{0, 11, 5}, {0, 5, 1}, {0, 1, 7}, {0, 7, 10}, {0, 10, 11}, {1, 5, 9}, {5, 11, 4},
+                                {11, 10, 2}, {10, 7, 6}, {7, 1, 8}, {3, 9, 4}, {3, 4, 2}, {3, 2, 6}, {3, 6, 8},
+                                {3, 8, 9}, {4, 9, 5}, {2, 4, 11}, {6, 2, 10}, {8, 6, 7}, {9, 8, 1}};
+      for (int c = 0; c < 12; c++) {
+         b.corners[c] = vec3(corners[c][0], corners[c][1], corners[c][2]).normal();
+         b.cornerOwner[c] = -1;
+      }
+      int edgeCount = 0;
+      for (int f = 0; f < 20; f++)
+         for (int k = 0; k < 3; k++) {
+            b.faces[f][k] = faces[f][k];
+            if (b.cornerOwner[faces[f][k]] < 0) b.cornerOwner[faces[f][k]] = f;
+            // Edges k: corner 0 to 1, 0 to 2 and 1 to 2
+            int from = faces[f][k == 2 ? 1 : 0], to = faces[f][k == 0 ? 1 : 2];
+            int lo = std::min(from, to), hi = std::max(from, to), e = 0;
+            while (e < edgeCount && (b.edges[e][0] != lo || b.edges[e][1] != hi)) e++;
+            if (e == edgeCount) {
+               b.edges[e][0] = lo;
+               b.edges[e][1] = hi;
+               b.edgeOwner[e] = f;
+               edgeCount++;
+            }
+            b.faceEdges[f][k] = e;
+         }
+      return b;
+   }();
+   return ico;
+}
+
+
+// Every face is a triangular grid, (i, j) is i steps from corner 0 towards corner 1 and j towards
+// corner 2 with i + j <= n. Rows of j are stored one after the other
+static inline std::size_t gridIndex(int n, int i, int j) { return std::size_t(j) * (n + 1) - std::size_t(j) * (j - 1) / 2 + i; }
+
+// Index of a grid point of face f in the whole mesh: the 12 corners, then n - 1 vertices per edge
+// (from its lower corner up) and the inside of every face row by row
+static int globalIndex(const icosahedron& b, int n, int f, int i, int j) {
+   const int* c = b.faces[f];
+   if (i == 0 && j == 0) return c[0];
+   if (j == 0 && i == n) return c[1];
+   if (i == 0 && j == n) return c[2];
+   int edge = -1, from = 0, t = 0;
+   if (j == 0) { edge = b.faceEdges[f][0]; from = c[0]; t = i; }
+   else if (i == 0) { edge = b.faceEdges[f][1]; from = c[0]; t = j; }
+   else if (i + j == n) { edge = b.faceEdges[f][2]; from = c[1]; t = j; }
+   if (edge >= 0) return 12 + edge * (n - 1) + (b.edges[edge][0] == from ? t - 1 : n - 1 - t);
+   int row = (j - 1) * (n - 1) - (j - 1) * j / 2;
+   return 12 + 30 * (n - 1) + f * (n - 1) * (n - 2) / 2 + row + i - 1;
+}
+
+// Who writes a grid point, corners and edges only once for the whole mesh
+static bool owns(const icosahedron& b, int n, int f, int i, int j) {
+   if (i == 0 && j == 0) return b.cornerOwner[b.faces[f][0]] == f;
+   if (j == 0 && i == n) return b.cornerOwner[b.faces[f][1]] == f;
+   if (i == 0 && j == n) return b.cornerOwner[b.faces[f][2]] == f;
+   if (j == 0) return b.edgeOwner[b.faceEdges[f][0]] == f;
+   if (i == 0) return b.edgeOwner[b.faceEdges[f][1]] == f;
+   if (i + j == n) return b.edgeOwner[b.faceEdges[f][2]] == f;
+   return true;
+}
+
+
+// The directions of the unit sphere and the triangles, global is the index of every grid point of
+// every face in the whole mesh
+static void subdivide(int level, std::vector<vec3>& directions, std::vector<int>& global, std::vector<int>& indices) {
+   const icosahedron& b = icosahedron_base();
+   const int n = 1 << level;
+   const std::size_t gridSize = gridIndex(n, 0, n) + 1;
+   const std::size_t trianglesPerFace = std::size_t(n) * n;
+   directions.resize(planet_vertexCount(level));
+   global.resize(20 * gridSize);
+   indices.resize(20 * trianglesPerFace * 3);
+
+   parallel_for(20, 1, [&](std::size_t begin, std::size_t end) {
+      std::vector<vec3> grid(gridSize);
+      for (std::size_t f = begin; f < end; f++) {
+         int* map = &global[f * gridSize];
+         for (int j = 0; j <= n; j++)
+            for (int i = 0; i <= n - j; i++) map[gridIndex(n, i, j)] = globalIndex(b, n, int(f), i, j);
+
+         // Halving the step every pass is the same as splitting every triangle in 4, each new point
+         // is the midpoint of the edge it lies on. The same two ends on the same edge of the
+         // neighbouring face give exactly the same point
+         grid[gridIndex(n, 0, 0)] = b.corners[b.faces[f][0]];
+         grid[gridIndex(n, n, 0)] = b.corners[b.faces[f][1]];
+         grid[gridIndex(n, 0, n)] = b.corners[b.faces[f][2]];
+         for (int s = n / 2; s >= 1; s /= 2)
+            for (int j = 0; j <= n; j += s)
+               for (int i = 0; i <= n - j; i += s) {
+                  bool oddI = (i / s) & 1, oddJ = (j / s) & 1;
+                  if (!oddI && !oddJ) continue;
+                  vec3 p = oddI && oddJ ? grid[gridIndex(n, i - s, j + s)] + grid[gridIndex(n, i + s, j - s)]
+                         : oddI         ? grid[gridIndex(n, i - s, j)] + grid[gridIndex(n, i + s, j)]
+                                        : grid[gridIndex(n, i, j - s)] + grid[gridIndex(n, i, j + s)];
+                  grid[gridIndex(n, i, j)] = p.normal();
+               }
+         for (int j = 0; j <= n; j++)
+            for (int i = 0; i <= n - j; i++)
+               if (owns(b, n, int(f), i, j)) directions[map[gridIndex(n, i, j)]] = grid[gridIndex(n, i, j)];
+
+         // Up triangles (i, j) (i + 1, j) (i, j + 1) and the down ones between them keep the
+         // winding of the face
+         int* out = &indices[f * trianglesPerFace * 3];
+         for (int j = 0; j < n; j++)
+            for (int i = 0; i < n - j; i++) {
+               int a = map[gridIndex(n, i, j)], r = map[gridIndex(n, i + 1, j)], u = map[gridIndex(n, i, j + 1)];
+               *out++ = a; *out++ = r; *out++ = u;
+               if (i + 1 < n - j) {
+                  *out++ = r; *out++ = map[gridIndex(n, i + 1, j + 1)]; *out++ = u;
+               }
+            }
+      }
+   }, 1);
+}
+
+
+// Builds the mesh around the directions of the unit sphere, heights fills in the height of every
+// vertex from the directions
+template <typename H>
+static planetMesh generate(int level, float radius, H heights) {
+   const int n = 1 << level;
+   const std::size_t gridSize = gridIndex(n, 0, n) + 1;
+   const std::size_t vertexCount = planet_vertexCount(level);
+
+   std::vector<vec3> directions;
+   std::vector<int> global;
+   planetMesh mesh;
+   subdivide(level, directions, global, mesh.indices);
+
+   std::vector<float> height(vertexCount, 0.0f);
+   heights(directions, height);
+   std::vector<vec3> positions(vertexCount);
+   parallel_for(vertexCount, 4096, [&](std::size_t begin, std::size_t end) {
+      for (std::size_t v = begin; v < end; v++) positions[v] = directions[v] * (radius + height[v]);
+   });
+
+   // Normals: area weighted sum of the triangles around each vertex. Every face sums its own
+   // triangles, the inside of a face is then final and the corners and edges add up the faces
+   // around them in face order, so the result does not depend on the threads
+   std::vector<vec3> normals(vertexCount);
+   std::vector<vec3> sums(20 * gridSize);
+   parallel_for(20, 1, [&](std::size_t begin, std::size_t end) {
+      for (std::size_t f = begin; f < end; f++) {
+         const int* map = &global[f * gridSize];
+         vec3* sum = &sums[f * gridSize];
+         auto add = [&](std::size_t a, std::size_t r, std::size_t u) {
+            vec3 pa = positions[map[a]];
+            vec3 normal = (positions[map[r]] - pa).cross(positions[map[u]] - pa);
+            sum[a] += normal; sum[r] += normal; sum[u] += normal;
+         };
+         for (int j = 0; j < n; j++)
+            for (int i = 0; i < n - j; i++) {
+               add(gridIndex(n, i, j), gridIndex(n, i + 1, j), gridIndex(n, i, j + 1));
+               if (i + 1 < n - j) add(gridIndex(n, i + 1, j), gridIndex(n, i + 1, j + 1), gridIndex(n, i, j + 1));
+            }
+         for (int j = 1; j < n; j++)
+            for (int i = 1; i < n - j; i++) normals[map[gridIndex(n, i, j)]] = sum[gridIndex(n, i, j)];
+      }
+   }, 1);
+   for (int f = 0; f < 20; f++)
+      for (int j = 0; j <= n; j++)
+         for (int i = 0; i <= n - j; i++)
+            if (i == 0 || j == 0 || i + j == n) normals[global[f * gridSize + gridIndex(n, i, j)]] += sums[f * gridSize + gridIndex(n, i, j)];
+
+   mesh.vertices.resize(vertexCount * planetMesh::stride);
+   parallel_for(vertexCount, 4096, [&](std::size_t begin, std::size_t end) {
+      for (std::size_t v = begin; v < end; v++) {
+         vec3 normal = normals[v].normal();
+         float* out = &mesh.vertices[v * planetMesh::stride];
+         out[0] = positions[v].x; out[1] = positions[v].y; out[2] = positions[v].z;
+         out[3] = normal.x; out[4] = normal.y; out[5] = normal.z;
+      }
+   });
+   return mesh;
+}
+
+
+planetMesh planet_generate(int level, float radius, const std::function<float(const vec3&)>& height) {
+   return generate(level, radius, [&](const std::vector<vec3>& directions, std::vector<float>& heights) {
+      if (!height) return;
+      parallel_for(directions.size(), 4096, [&](std::size_t begin, std::size_t end) {
+         for (std::size_t v = begin; v < end; v++) heights[v] = height(directions[v]);
+      });
+   });
+}
+
+
+planetMesh planet_generate(int level, float radius, const noiseSettings& terrain, float amplitude) {
+   return generate(level, radius, [&](const std::vector<vec3>& directions, std::vector<float>& heights) {
+      noise_batch(terrain, directions.data(), heights.data(), directions.size());
+      for (float& h : heights) h *= amplitude;
+   });
+}
+
+
+void planet_sphere(int level, std::vector<vec3>& directions, std::vector<int>& indices) {
+   std::vector<int> global;
+   subdivide(level, directions, global, indices);
+}
@@ -0,0 +1,68 @@
+#pragma once
+
+//////////////////////////////////////////////////////////////////
+// Headers
+//////////////////////////////////////////////////////////////////
+#include <cstddef>
+#include <functional>
+#include <vector>
+#include "matrix.hpp"
+#include "noise.hpp"
+
+//////////////////////////////////////////////////////////////////
+/// \brief Vertices and triangles of a generated planet, laid out the
+/// way gl_object keeps them so they can be moved straight in (see
+/// gl_vao::load(planetMesh&&))
+/// \param vertices: Position xyz then normal xyz of every vertex
+/// \param indices: 3 vertex indices per triangle, counter clockwise
+/// seen from outside
+//////////////////////////////////////////////////////////////////
+struct planetMesh {
+   std::vector<float> vertices;
+   std::vector<int> indices;
+
+   // Floats per vertex
+   static const int stride = 6;
+
+   vec3 position(std::size_t vertex) const { return vec3(vertices[vertex * stride], vertices[vertex * stride + 1], vertices[vertex * stride + 2]); }
+   vec3 normal(std::size_t vertex) const { return vec3(vertices[vertex * stride + 3], vertices[vertex * stride + 4], vertices[vertex * stride + 5]); }
+   std::size_t vertexCount() const { return vertices.size() / stride; }
+   std::size_t triangleCount() const { return indices.size() / 3; }
+};
+
+//////////////////////////////////////////////////////////////////
+/// \brief Vertex and triangle counts of a level, every level splits each
+/// triangle of the icosahedron in 4 (level 8: 655362 vertices and
+/// 1310720 triangles)
+//////////////////////////////////////////////////////////////////
+constexpr std::size_t planet_vertexCount(int level) { return 10 * (std::size_t(1) << (2 * level)) + 2; }
+constexpr std::size_t planet_triangleCount(int level) { return 20 * (std::size_t(1) << (2 * level)); }
+
+//////////////////////////////////////////////////////////////////
+/// \brief Subdivided icosahedron, every new vertex is the midpoint of an
+/// edge pushed out onto the sphere, and then moved along its direction
+/// by the height. Every vertex is made once and shared by all of its
+/// triangles: the index of a vertex follows from the corner, edge or face
+/// it lies on, so the 20 faces of the icosahedron are built in parallel
+/// without a shared midpoint cache
+/// \param level: Number of subdivisions
+/// \param radius: Radius of the sphere at height 0
+/// \param height: Height above the radius for a unit direction (Default: none, a sphere)
+//////////////////////////////////////////////////////////////////
+planetMesh planet_generate(int level, float radius, const std::function<float(const vec3&)>& height = nullptr);
+
+//////////////////////////////////////////////////////////////////
+/// \brief Same with the height from a noise layer sampled on the unit
+/// sphere, all vertices in one noise_batch (SIMD and all threads)
+/// \param amplitude: Height of a noise value of 1
+//////////////////////////////////////////////////////////////////
+planetMesh planet_generate(int level, float radius, const noiseSettings& terrain, float amplitude);
+
+//////////////////////////////////////////////////////////////////
+/// \brief Only the unit directions and the triangles of the same
+/// subdivision, without heights and normals (eg. for the tile grid)
+/// \param directions: Filled with planet_vertexCount(level) directions
+/// \param indices: Filled with 3 vertex indices per triangle, counter
+/// clockwise seen from outside
+//////////////////////////////////////////////////////////////////
+void planet_sphere(int level, std::vector<vec3>& directions, std::vector<int>& indices);
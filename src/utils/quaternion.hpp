@@ -0,0 +1,148 @@
+#pragma once
+
+#include "matrix.hpp"
+
+
+//XXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXX
+// Quaternion rotations
+//XXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXX
+// Orientations are kept as unit quaternions and only turned into a matrix once per update. Small
+// rotations can be stacked on top of each other forever without the gimbal lock of Euler angles,
+// and renormalizing now and then is all it takes to stop rounding errors from building up.
+
+/// @brief: Rotation stored as a unit quaternion (x,y,z is the axis scaled by sin(angle/2), w is cos(angle/2))
+/// @param x,y,z,w: Components (Default: identity, no rotation)
+struct quat {
+
+   float x,y,z,w;
+
+   // Constructors (member initializer list)
+   constexpr quat() : x(0), y(0), z(0), w(1) {}
+   constexpr quat(float _x, float _y, float _z, float _w) : x(_x), y(_y), z(_z), w(_w) {}
+
+   // Member functions
+   //---------------------------------------------------------------------------------------------
+   /// @brief: Dot product of 2 quaternions, 1 or -1 means the same rotation
+   constexpr float dot(const quat& q) const { return x * q.x + y * q.y + z * q.z + w * q.w; }
+   /// @brief: Returns the quaternion scaled to length 1
+   constexpr quat normal() const { float m = 1.0f / math_sqrt(dot(*this)); return quat(x * m, y * m, z * m, w * m); }
+   /// @brief: Scales the quaternion to length 1, call after stacking many rotations
+   constexpr void normalize() { *this = normal(); }
+   /// @brief: Opposite rotation (the inverse for a unit quaternion)
+   constexpr quat conjugate() const { return quat(-x, -y, -z, w); }
+
+   // Operator overloads
+   //---------------------------------------------------------------------------------------------
+   // Combines two rotations in the same order as the matrices, this rotation is applied first and then q
+   // (the Hamilton product q * this)
+   constexpr quat operator * (const quat& q) const {
+      return quat(q.w * x + q.x * w + q.y * z - q.z * y,
+                  q.w * y - q.x * z + q.y * w + q.z * x,
+                  q.w * z + q.x * y - q.y * x + q.z * w,
+                  q.w * w - q.x * x - q.y * y - q.z * z);
+   }
+   constexpr void operator *= (const quat& q) { *this = *this * q; }
+};
+
+
+// Overload for rotating a vector by a quaternion, same as v * matrix_rotate(q) without building the
+// matrix
+constexpr vec3 operator * (const vec3& v, const quat& q) {
+   // v + 2w(q x v) + 2q x (q x v), written with t = 2(q x v)
+   float tx = 2.0f * (q.y * v.z - q.z * v.y);
+   float ty = 2.0f * (q.z * v.x - q.x * v.z);
+   float tz = 2.0f * (q.x * v.y - q.y * v.x);
+   return vec3(v.x + q.w * tx + (q.y * tz - q.z * ty),
+               v.y + q.w * ty + (q.z * tx - q.x * tz),
+               v.z + q.w * tz + (q.x * ty - q.y * tx));
+}
+
+constexpr void operator *= (vec3& v, const quat& q) { v = v * q; }
+
+
+/// @brief: Rotation around an axis
+/// @param axis: Axis to rotate around, does not have to be normalized
+/// @param angle: Angle in radians
+/// @return quat
+///
+constexpr quat quat_axisAngle(const vec3 &axis, float angle) {
+   float s, c;
+   math_sincos(angle * 0.5f, s, c);
+   s /= math_sqrt(axis.x * axis.x + axis.y * axis.y + axis.z * axis.z);
+   return quat(axis.x * s, axis.y * s, axis.z * s, c);
+}
+
+/// @brief: Same rotation as the u, v and w angles of matrix_transform
+/// @param u: u rotation in radians
+/// @param v: v rotation in radians
+/// @param w: w rotation in radians
+/// @return quat
+///
+constexpr quat quat_euler(float u, float v, float w) {
+   // matrix_transform rotates around x by u, then around y by -v and last around z by w. The product
+   // of those three single axis quaternions is written out so each angle needs one sincos
+   float su, cu, sv, cv, sw, cw;
+   math_sincos(u * 0.5f, su, cu);
+   math_sincos(-v * 0.5f, sv, cv);
+   math_sincos(w * 0.5f, sw, cw);
+   return quat(cw * cv * su - sw * sv * cu,
+               cw * sv * cu + sw * cv * su,
+               sw * cv * cu - cw * sv * su,
+               cw * cv * cu + sw * sv * su);
+}
+
+/// @brief: Interpolates between two rotations at a constant angular speed, always the short way around
+/// @param a: Rotation at t = 0
+/// @param b: Rotation at t = 1
+/// @param t: Interpolation factor between 0 and 1
+/// @return quat
+///
+inline quat quat_slerp(const quat &a, const quat &b, float t) {
+   // q and -q are the same rotation, flip b if that makes the path shorter
+   float d = a.dot(b);
+   quat end = b;
+   if (d < 0.0f) { d = -d; end = quat(-b.x, -b.y, -b.z, -b.w); }
+
+   float wa, wb;
+   if (d > 0.9995f) {
+      // Nearly the same rotation, sin(angle) would divide by almost 0 so blend linearly instead
+      wa = 1.0f - t;
+      wb = t;
+   }
+   else {
+      float angle = std::acos(d);
+      float invSin = 1.0f / std::sin(angle);
+      wa = std::sin((1.0f - t) * angle) * invSin;
+      wb = std::sin(t * angle) * invSin;
+   }
+   quat q(a.x * wa + end.x * wb, a.y * wa + end.y * wb, a.z * wa + end.z * wb, a.w * wa + end.w * wb);
+   return q.normal();
+}
+
+/// @brief: Creates a matrix that scales, then rotates and then translates a vertex, the same as
+/// matrix_scale * matrix_rotate * translation but built in one go
+/// @param pos: Translation
+/// @param q: Rotation
+/// @param scale: Scale along each axis (Default: no scaling)
+/// @return mat3x4
+///
+constexpr mat3x4 matrix_transform(const vec3 &pos, const quat &q, const vec3 &scale = vec3(1.0f, 1.0f, 1.0f)) {
+   // Standard unit quaternion to rotation matrix, every column is multiplied by its scale
+   float xx = q.x * q.x, yy = q.y * q.y, zz = q.z * q.z;
+   float xy = q.x * q.y, xz = q.x * q.z, yz = q.y * q.z;
+   float wx = q.w * q.x, wy = q.w * q.y, wz = q.w * q.z;
+
+   mat3x4 m;
+   m.m[0][0] = (1.0f - 2.0f * (yy + zz)) * scale.x; m.m[0][1] = 2.0f * (xy - wz) * scale.y;          m.m[0][2] = 2.0f * (xz + wy) * scale.z;          m.m[0][3] = pos.x;
+   m.m[1][0] = 2.0f * (xy + wz) * scale.x;          m.m[1][1] = (1.0f - 2.0f * (xx + zz)) * scale.y; m.m[1][2] = 2.0f * (yz - wx) * scale.z;          m.m[1][3] = pos.y;
+   m.m[2][0] = 2.0f * (xz - wy) * scale.x;          m.m[2][1] = 2.0f * (yz + wx) * scale.y;          m.m[2][2] = (1.0f - 2.0f * (xx + yy)) * scale.z; m.m[2][3] = pos.z;
+   return m;
+}
+
+/// @brief: Creates the rotation matrix of a unit quaternion (no trig, only multiplies and adds)
+/// @param q: Rotation
+/// @return mat3x4
+///
+constexpr mat3x4 matrix_rotate(const quat &q) {
+   return matrix_transform(vec3(0.0f, 0.0f, 0.0f), q);
+}
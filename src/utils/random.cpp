@@ -1,51 +1,317 @@
-
 //////////////////////////////////////////////////////////////////
 // Headers
 //////////////////////////////////////////////////////////////////
 #include "random.hpp"
+#include "simd.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <random>
 
 
 randObj::randObj(int _seed){
-   // !!!! TRY FLAME GRAPH TO FIND CPU DRAGS !!!!!!!!!!!
-   //!!!!! DO NOT CREATE A NEW ENGINE EVERYTIME !!!!!!!!
+   // The generator is made once here, iRand/fRand only step it
    if (_seed == -1) { // If there was no seed provided then get one from hardware
-      // std::random_device rd; // Obtain a random number from hardware
+      std::random_device rd; // Obtain a random number from hardware
       seed = rd();
    }
    else {seed = _seed;}
-   gen.seed(seed); // Create and seed the generator (Was using mt19937 but that is a little unecessary
+   gen.seed(std::uint32_t(seed));
 }
+
+
+
+//////////////////////////////////////////////////////////////////
+// randBatch
 //////////////////////////////////////////////////////////////////
-int randObj::iRand(int min, int max) {
+// Words made per pass of the bulk functions, kept small enough to stay in L1
+static const std::size_t chunkWords = 1024;
 
-   std::uniform_int_distribution<> distr(min, max); // Use the random number against a distribution range
-   return distr(gen);
+
+randBatch::randBatch(std::uint64_t seed) {
+   // Every lane gets its own 128 bits from splitmix64, the retry generator what comes after
+   for (int lane = 0; lane < lanes; lane++)
+      for (int word = 0; word < 4; word += 2) {
+         std::uint64_t z = xoshiro256::splitmix64(seed);
+         s[word][lane] = std::uint32_t(z);
+         s[word + 1][lane] = std::uint32_t(z >> 32);
+      }
+   retry.seed(xoshiro256::splitmix64(seed));
 }
 
-//////////////////////////////////////////////////////////////////
-float randObj::fRand(float min, float max) {
 
-   std::uniform_real_distribution<> distr(min, max); // Use the random number against a distribution range
-   return distr(gen);
+// Steps all lanes blocks times, writing 8 words per step (xoshiro128**, the multiplies by 5 and 9
+// are shifts and adds so SSE/AVX2 need no 32 bit multiply)
+static void generate(std::uint32_t (&s)[4][randBatch::lanes], std::uint32_t* out, std::size_t blocks) {
+   std::size_t b = 0;
+#if defined(MATH_AVX2)
+   __m256i s0 = _mm256_load_si256((const __m256i*)s[0]), s1 = _mm256_load_si256((const __m256i*)s[1]);
+   __m256i s2 = _mm256_load_si256((const __m256i*)s[2]), s3 = _mm256_load_si256((const __m256i*)s[3]);
+   for (; b < blocks; b++) {
+      __m256i x = _mm256_add_epi32(s1, _mm256_slli_epi32(s1, 2));
+      x = _mm256_or_si256(_mm256_slli_epi32(x, 7), _mm256_srli_epi32(x, 25));
+      _mm256_storeu_si256((__m256i*)(out + b * 8), _mm256_add_epi32(x, _mm256_slli_epi32(x, 3)));
+      __m256i t = _mm256_slli_epi32(s1, 9);
+      s2 = _mm256_xor_si256(s2, s0);
+      s3 = _mm256_xor_si256(s3, s1);
+      s1 = _mm256_xor_si256(s1, s2);
+      s0 = _mm256_xor_si256(s0, s3);
+      s2 = _mm256_xor_si256(s2, t);
+      s3 = _mm256_or_si256(_mm256_slli_epi32(s3, 11), _mm256_srli_epi32(s3, 21));
+   }
+   _mm256_store_si256((__m256i*)s[0], s0); _mm256_store_si256((__m256i*)s[1], s1);
+   _mm256_store_si256((__m256i*)s[2], s2); _mm256_store_si256((__m256i*)s[3], s3);
+#elif defined(MATH_SSE)
+   // Lanes 0-3 and 4-7 in two registers per word, stepped together
+   __m128i s0[2], s1[2], s2[2], s3[2];
+   for (int h = 0; h < 2; h++) {
+      s0[h] = _mm_load_si128((const __m128i*)(s[0] + h * 4)); s1[h] = _mm_load_si128((const __m128i*)(s[1] + h * 4));
+      s2[h] = _mm_load_si128((const __m128i*)(s[2] + h * 4)); s3[h] = _mm_load_si128((const __m128i*)(s[3] + h * 4));
+   }
+   for (; b < blocks; b++)
+      for (int h = 0; h < 2; h++) {
+         __m128i x = _mm_add_epi32(s1[h], _mm_slli_epi32(s1[h], 2));
+         x = _mm_or_si128(_mm_slli_epi32(x, 7), _mm_srli_epi32(x, 25));
+         _mm_storeu_si128((__m128i*)(out + b * 8 + h * 4), _mm_add_epi32(x, _mm_slli_epi32(x, 3)));
+         __m128i t = _mm_slli_epi32(s1[h], 9);
+         s2[h] = _mm_xor_si128(s2[h], s0[h]);
+         s3[h] = _mm_xor_si128(s3[h], s1[h]);
+         s1[h] = _mm_xor_si128(s1[h], s2[h]);
+         s0[h] = _mm_xor_si128(s0[h], s3[h]);
+         s2[h] = _mm_xor_si128(s2[h], t);
+         s3[h] = _mm_or_si128(_mm_slli_epi32(s3[h], 11), _mm_srli_epi32(s3[h], 21));
+      }
+   for (int h = 0; h < 2; h++) {
+      _mm_store_si128((__m128i*)(s[0] + h * 4), s0[h]); _mm_store_si128((__m128i*)(s[1] + h * 4), s1[h]);
+      _mm_store_si128((__m128i*)(s[2] + h * 4), s2[h]); _mm_store_si128((__m128i*)(s[3] + h * 4), s3[h]);
+   }
+#else
+   for (; b < blocks; b++)
+      for (int lane = 0; lane < randBatch::lanes; lane++) {
+         std::uint32_t x = s[1][lane] * 5;
+         x = (x << 7) | (x >> 25);
+         out[b * 8 + lane] = x * 9;
+         std::uint32_t t = s[1][lane] << 9;
+         s[2][lane] ^= s[0][lane];
+         s[3][lane] ^= s[1][lane];
+         s[1][lane] ^= s[2][lane];
+         s[0][lane] ^= s[3][lane];
+         s[2][lane] ^= t;
+         s[3][lane] = (s[3][lane] << 11) | (s[3][lane] >> 21);
+      }
+#endif
 }
 
 
+// Runs f(bits, first, n) over [0, count) in pieces, with wordsPer random words for every value
+template <typename F>
+static void chunks(std::uint32_t (&s)[4][randBatch::lanes], std::size_t count, std::size_t wordsPer, F f) {
+   alignas(32) std::uint32_t buffer[chunkWords];
+   std::size_t perChunk = chunkWords / wordsPer;
+   for (std::size_t first = 0; first < count; first += perChunk) {
+      std::size_t n = std::min(perChunk, count - first);
+      generate(s, buffer, (n * wordsPer + randBatch::lanes - 1) / randBatch::lanes);
+      f(buffer, first, n);
+   }
+}
 
 
-//////////////////////////////////////////////////////////////////
-int iRand(int min, int max) {
+void randBatch::bits(std::uint32_t* out, std::size_t count) {
+   std::size_t blocks = count / lanes;
+   generate(s, out, blocks);
+   if (count % lanes) {
+      std::uint32_t last[lanes];
+      generate(s, last, 1);
+      std::copy(last, last + count % lanes, out + blocks * lanes);
+   }
+}
 
-   std::random_device rd; // Obtain a random number from hardware
-   std::minstd_rand gen(rd()); // Create and seed the generator (Was using mt19937 but that is a little unecessary
-   std::uniform_int_distribution<> distr(min, max); // Use the random number against a distribution range
-   return distr(gen);
+
+void randBatch::uniform(float* out, std::size_t count, float min, float max) {
+   float scale = (max - min) * 0x1.0p-24f;
+   chunks(s, count, 1, [&](const std::uint32_t* b, std::size_t first, std::size_t n) {
+      // Simple enough for the compiler to vectorize
+      for (std::size_t i = 0; i < n; i++) out[first + i] = min + float(b[i] >> 8) * scale;
+   });
+}
+
+
+void randBatch::uniform(int* out, std::size_t count, int min, int max) {
+   std::uint32_t range = std::uint32_t(max) - std::uint32_t(min) + 1;
+   auto next = [&] { return std::uint32_t(retry() >> 32); };
+   if (range == 0) {
+      // The whole int range, every 32 bit value is fine
+      chunks(s, count, 1, [&](const std::uint32_t* b, std::size_t first, std::size_t n) { std::copy(b, b + n, (std::uint32_t*)out + first); });
+      return;
+   }
+   // 2^32 mod range, lows under it would favor some results (see rand_bounded)
+   std::uint32_t threshold = -range % range;
+   chunks(s, count, 1, [&](const std::uint32_t* b, std::size_t first, std::size_t n) {
+      // Multiply and shift for all of them first, then redo the rare biased ones
+      bool biased = false;
+      std::size_t i = 0;
+#if defined(MATH_AVX2)
+      // 32x32 -> 64 bit multiplies of the even and odd words, the high halves are the results
+      __m256i r = _mm256_set1_epi32(range), offset = _mm256_set1_epi32(min);
+      __m256i sign = _mm256_set1_epi32(int(0x80000000u)), limit = _mm256_set1_epi32(int(threshold ^ 0x80000000u));
+      __m256i any = _mm256_setzero_si256();
+      for (; i + 8 <= n; i += 8) {
+         __m256i v = _mm256_loadu_si256((const __m256i*)(b + i));
+         __m256i even = _mm256_mul_epu32(v, r), odd = _mm256_mul_epu32(_mm256_srli_epi64(v, 32), r);
+         __m256i high = _mm256_blend_epi32(_mm256_srli_epi64(even, 32), odd, 0xAA);
+         __m256i low = _mm256_blend_epi32(even, _mm256_slli_epi64(odd, 32), 0xAA);
+         _mm256_storeu_si256((__m256i*)(out + first + i), _mm256_add_epi32(high, offset));
+         // Unsigned low < threshold, AVX2 only compares signed so both sides are flipped
+         any = _mm256_or_si256(any, _mm256_cmpgt_epi32(limit, _mm256_xor_si256(low, sign)));
+      }
+      biased = !_mm256_testz_si256(any, any);
+#elif defined(MATH_SSE)
+      __m128i r = _mm_set1_epi32(range), offset = _mm_set1_epi32(min);
+      __m128i sign = _mm_set1_epi32(int(0x80000000u)), limit = _mm_set1_epi32(int(threshold ^ 0x80000000u));
+      __m128i any = _mm_setzero_si128();
+      for (; i + 4 <= n; i += 4) {
+         __m128i v = _mm_loadu_si128((const __m128i*)(b + i));
+         __m128i even = _mm_mul_epu32(v, r), odd = _mm_mul_epu32(_mm_srli_epi64(v, 32), r);
+         __m128i high = _mm_blend_epi16(_mm_srli_epi64(even, 32), odd, 0xCC);
+         __m128i low = _mm_blend_epi16(even, _mm_slli_epi64(odd, 32), 0xCC);
+         _mm_storeu_si128((__m128i*)(out + first + i), _mm_add_epi32(high, offset));
+         any = _mm_or_si128(any, _mm_cmpgt_epi32(limit, _mm_xor_si128(low, sign)));
+      }
+      biased = !_mm_testz_si128(any, any);
+#endif
+      for (; i < n; i++) {
+         std::uint64_t m = std::uint64_t(b[i]) * range;
+         out[first + i] = int(std::uint32_t(min) + std::uint32_t(m >> 32));
+         biased |= std::uint32_t(m) < threshold;
+      }
+      if (!biased) return;
+      for (std::size_t i = 0; i < n; i++)
+         if (b[i] * range < threshold) out[first + i] = int(std::uint32_t(min) + rand_bounded(b[i], range, next));
+   });
 }
 
+
+void randBatch::normal(float* out, std::size_t count, float mean, float deviation) {
+   const float tau = 6.28318530717958647692f;
+   // Every pair of words makes 2 values, an odd count wastes the last one
+   chunks(s, (count + 1) / 2, 2, [&](const std::uint32_t* b, std::size_t first, std::size_t n) {
+      for (std::size_t i = 0; i < n; i++) {
+         // 1 - u so the log never sees 0
+         float u = 1.0f - float(b[2 * i] >> 8) * 0x1.0p-24f;
+         float r = deviation * std::sqrt(-2.0f * std::log(u));
+         float sn, cs;
+         math_sincos(tau * float(b[2 * i + 1] >> 8) * 0x1.0p-24f, sn, cs);
+         std::size_t j = 2 * (first + i);
+         out[j] = mean + r * cs;
+         if (j + 1 < count) out[j + 1] = mean + r * sn;
+      }
+   });
+}
+
+
+void randBatch::sphere(vec3* out, std::size_t count) {
+   const float tau = 6.28318530717958647692f;
+   // Uniform height and angle around the axis is uniform over the surface (Archimedes)
+   chunks(s, count, 2, [&](const std::uint32_t* b, std::size_t first, std::size_t n) {
+      for (std::size_t i = 0; i < n; i++) {
+         float z = 1.0f - float(b[2 * i] >> 8) * 0x1.0p-23f;
+         float r = std::sqrt(std::max(0.0f, 1.0f - z * z));
+         float sn, cs;
+         math_sincos(tau * float(b[2 * i + 1] >> 8) * 0x1.0p-24f, sn, cs);
+         out[first + i] = vec3(r * cs, r * sn, z);
+      }
+   });
+}
+
+
+void randBatch::box(vec3* out, std::size_t count, const vec3& min, const vec3& max) {
+   vec3 scale = (max - min) * 0x1.0p-24f;
+   chunks(s, count, 3, [&](const std::uint32_t* b, std::size_t first, std::size_t n) {
+      for (std::size_t i = 0; i < n; i++)
+         out[first + i] = vec3(min.x + float(b[3 * i] >> 8) * scale.x, min.y + float(b[3 * i + 1] >> 8) * scale.y,
+                               min.z + float(b[3 * i + 2] >> 8) * scale.z);
+   });
+}
+
+
+
+//////////////////////////////////////////////////////////////////
+// randCounter
 //////////////////////////////////////////////////////////////////
-float fRand(float min, float max) {
+// Philox4x32-10 of the indices first to first + n, word 0 only, the counters are (index, stream)
+// and the key the seed as in randCounter::block. The multiplies are the even/odd 32x32 -> 64 bit
+// ones of SSE/AVX2 with the high and low halves blended back together
+static void philox(const randCounter& rc, std::uint32_t* out, std::uint64_t first, std::size_t n) {
+   std::size_t i = 0;
+#if defined(MATH_AVX2)
+   const __m256i m0 = _mm256_set1_epi32(int(0xD2511F53)), m1 = _mm256_set1_epi32(int(0xCD9E8D57));
+   const __m256i lanes = _mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7);
+   for (; i + 8 <= n; i += 8) {
+      std::uint64_t index = first + i;
+      // The low counter word would wrap inside these 8, rare enough to leave to the scalar code
+      if (std::uint32_t(index) > 0xFFFFFFF8u) {
+         for (int k = 0; k < 8; k++) out[i + k] = rc.bits(index + k);
+         continue;
+      }
+      __m256i c0 = _mm256_add_epi32(_mm256_set1_epi32(int(std::uint32_t(index))), lanes);
+      __m256i c1 = _mm256_set1_epi32(int(std::uint32_t(index >> 32)));
+      __m256i c2 = _mm256_set1_epi32(int(std::uint32_t(rc.stream))), c3 = _mm256_set1_epi32(int(std::uint32_t(rc.stream >> 32)));
+      std::uint32_t k0 = std::uint32_t(rc.seed), k1 = std::uint32_t(rc.seed >> 32);
+      for (int round = 0; round < 10; round++) {
+         if (round > 0) { k0 += 0x9E3779B9; k1 += 0xBB67AE85; }
+         __m256i e0 = _mm256_mul_epu32(c0, m0), o0 = _mm256_mul_epu32(_mm256_srli_epi64(c0, 32), m0);
+         __m256i e1 = _mm256_mul_epu32(c2, m1), o1 = _mm256_mul_epu32(_mm256_srli_epi64(c2, 32), m1);
+         __m256i hi0 = _mm256_blend_epi32(_mm256_srli_epi64(e0, 32), o0, 0xAA), lo0 = _mm256_blend_epi32(e0, _mm256_slli_epi64(o0, 32), 0xAA);
+         __m256i hi1 = _mm256_blend_epi32(_mm256_srli_epi64(e1, 32), o1, 0xAA), lo1 = _mm256_blend_epi32(e1, _mm256_slli_epi64(o1, 32), 0xAA);
+         c0 = _mm256_xor_si256(_mm256_xor_si256(hi1, c1), _mm256_set1_epi32(int(k0)));
+         c2 = _mm256_xor_si256(_mm256_xor_si256(hi0, c3), _mm256_set1_epi32(int(k1)));
+         c1 = lo1;
+         c3 = lo0;
+      }
+      _mm256_storeu_si256((__m256i*)(out + i), c0);
+   }
+#elif defined(MATH_SSE)
+   const __m128i m0 = _mm_set1_epi32(int(0xD2511F53)), m1 = _mm_set1_epi32(int(0xCD9E8D57));
+   const __m128i lanes = _mm_setr_epi32(0, 1, 2, 3);
+   for (; i + 4 <= n; i += 4) {
+      std::uint64_t index = first + i;
+      if (std::uint32_t(index) > 0xFFFFFFFCu) {
+         for (int k = 0; k < 4; k++) out[i + k] = rc.bits(index + k);
+         continue;
+      }
+      __m128i c0 = _mm_add_epi32(_mm_set1_epi32(int(std::uint32_t(index))), lanes);
+      __m128i c1 = _mm_set1_epi32(int(std::uint32_t(index >> 32)));
+      __m128i c2 = _mm_set1_epi32(int(std::uint32_t(rc.stream))), c3 = _mm_set1_epi32(int(std::uint32_t(rc.stream >> 32)));
+      std::uint32_t k0 = std::uint32_t(rc.seed), k1 = std::uint32_t(rc.seed >> 32);
+      for (int round = 0; round < 10; round++) {
+         if (round > 0) { k0 += 0x9E3779B9; k1 += 0xBB67AE85; }
+         __m128i e0 = _mm_mul_epu32(c0, m0), o0 = _mm_mul_epu32(_mm_srli_epi64(c0, 32), m0);
+         __m128i e1 = _mm_mul_epu32(c2, m1), o1 = _mm_mul_epu32(_mm_srli_epi64(c2, 32), m1);
+         __m128i hi0 = _mm_blend_epi16(_mm_srli_epi64(e0, 32), o0, 0xCC), lo0 = _mm_blend_epi16(e0, _mm_slli_epi64(o0, 32), 0xCC);
+         __m128i hi1 = _mm_blend_epi16(_mm_srli_epi64(e1, 32), o1, 0xCC), lo1 = _mm_blend_epi16(e1, _mm_slli_epi64(o1, 32), 0xCC);
+         c0 = _mm_xor_si128(_mm_xor_si128(hi1, c1), _mm_set1_epi32(int(k0)));
+         c2 = _mm_xor_si128(_mm_xor_si128(hi0, c3), _mm_set1_epi32(int(k1)));
+         c1 = lo1;
+         c3 = lo0;
+      }
+      _mm_storeu_si128((__m128i*)(out + i), c0);
+   }
+#endif
+   for (; i < n; i++) out[i] = rc.bits(first + i);
+}
 
-   std::random_device rd; // Obtain a random number from hardware
-   std::minstd_rand gen(rd()); // Create and seed the generator (Was using mt19937 but that is a little unecessary
-   std::uniform_real_distribution<> distr(min, max); // Use the random number against a distribution range
-   return distr(gen);
+
+void randCounter::bits(std::uint32_t* out, std::uint64_t first, std::size_t count) const {
+   philox(*this, out, first, count);
+}
+
+
+void randCounter::uniform(float* out, std::uint64_t first, std::size_t count, float min, float max) const {
+   // Same math as fRand so a value does not depend on which of the two made it
+   alignas(32) std::uint32_t buffer[chunkWords];
+   for (std::size_t done = 0; done < count; done += chunkWords) {
+      std::size_t n = std::min(chunkWords, count - done);
+      philox(*this, buffer, first + done, n);
+      for (std::size_t i = 0; i < n; i++) out[done + i] = min + (max - min) * (float(buffer[i] >> 8) * 0x1.0p-24f);
+   }
 }
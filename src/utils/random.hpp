@@ -3,32 +3,276 @@
 //////////////////////////////////////////////////////////////////
 // Headers
 //////////////////////////////////////////////////////////////////
-#include <random>
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include "matrix.hpp"
 
 //////////////////////////////////////////////////////////////////
-/// \brief This is an objet to have persistant (and recuersive) seed
+/// \brief xoshiro256** generator (Blackman and Vigna). 32 bytes of
+/// state, a few shifts and multiplies per number and good quality in
+/// every bit. It meets the UniformRandomBitGenerator requirements so it
+/// also works with the std distributions
+/// \param seed: Expanded into the 4 state words with splitmix64 so any
+/// seed (even 0) gives a good state
+//////////////////////////////////////////////////////////////////
+class xoshiro256 {
+
+public:
+
+   using result_type = std::uint64_t;
+
+   explicit xoshiro256(std::uint64_t seed = 0) { this->seed(seed); }
+
+   void seed(std::uint64_t seed) {
+      for (std::uint64_t& word : s) word = splitmix64(seed);
+   }
+
+   std::uint64_t operator()() {
+      std::uint64_t result = rotl(s[1] * 5, 7) * 9;
+      std::uint64_t t = s[1] << 17;
+      s[2] ^= s[0];
+      s[3] ^= s[1];
+      s[1] ^= s[2];
+      s[0] ^= s[3];
+      s[2] ^= t;
+      s[3] = rotl(s[3], 45);
+      return result;
+   }
+
+   /// \brief Advances the state by 2^128 numbers, calling this n times on
+   /// copies of one generator gives n streams that never overlap
+   void jump() {
+      static const std::uint64_t steps[4] = {0x180ec6d33cfd0aba, 0xd5a61266f0c9392c, 0xa9582618e03fc9aa, 0x39abdc4529b1661c};
+      std::uint64_t j[4] = {0, 0, 0, 0};
+      for (std::uint64_t step : steps)
+         for (int b = 0; b < 64; b++) {
+            if (step & (std::uint64_t(1) << b))
+               for (int i = 0; i < 4; i++) j[i] ^= s[i];
+            (*this)();
+         }
+      for (int i = 0; i < 4; i++) s[i] = j[i];
+   }
+
+   static constexpr std::uint64_t min() { return 0; }
+   static constexpr std::uint64_t max() { return std::numeric_limits<std::uint64_t>::max(); }
+
+   // Used to expand seeds, also a decent 64 bit hash on its own
+   static constexpr std::uint64_t splitmix64(std::uint64_t& x) {
+      std::uint64_t z = (x += 0x9e3779b97f4a7c15);
+      z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9;
+      z = (z ^ (z >> 27)) * 0x94d049bb133111eb;
+      return z ^ (z >> 31);
+   }
+
+private:
+
+   static std::uint64_t rotl(std::uint64_t x, int k) { return (x << k) | (x >> (64 - k)); }
+
+   std::uint64_t s[4];
+};
+
+
+//////////////////////////////////////////////////////////////////
+/// \brief Unbiased integer in [0, range) with Lemire's multiply and
+/// shift. Only retries (rarely) when the low half lands in the biased
+/// part, so there is no division in the common case
+/// \param bits: 32 random bits
+/// \param next: Called for new bits when a retry is needed
+//////////////////////////////////////////////////////////////////
+template <typename F>
+constexpr std::uint32_t rand_bounded(std::uint32_t bits, std::uint32_t range, F next) {
+   std::uint64_t m = std::uint64_t(bits) * range;
+   std::uint32_t low = std::uint32_t(m);
+   if (low < range) {
+      // 2^32 mod range, the number of low values that would favor some results
+      std::uint32_t threshold = -range % range;
+      while (low < threshold) {
+         m = std::uint64_t(next()) * range;
+         low = std::uint32_t(m);
+      }
+   }
+   return std::uint32_t(m >> 32);
+}
+
+//////////////////////////////////////////////////////////////////
+/// \brief Float in [0, 1) from the top 24 bits, every value is a
+/// multiple of 2^-24 so there is no rounding up to 1
+//////////////////////////////////////////////////////////////////
+inline float rand_unit(std::uint64_t bits) {
+   return float(bits >> 40) * 0x1.0p-24f;
+}
+
+
+//////////////////////////////////////////////////////////////////
+/// \brief This is an objet to have persistant (and recuersive) seed.
+/// The same seed always gives the same numbers. Cheap to create and
+/// not thread safe, use one per thread (the free functions below do)
+/// \param seed: -1 takes a seed from std::random_device (Default: -1)
 //////////////////////////////////////////////////////////////////
 class randObj {
 
 public:
 
    int seed;
-   std::random_device rd;
-   std::minstd_rand gen;
+   xoshiro256 gen;
 
    randObj(int _seed = -1);
-   
 
-   float fRand(float min, float max);
-   int iRand(int min, int max);
+   /// \brief Float in [min, max)
+   float fRand(float min, float max) { return min + (max - min) * rand_unit(gen()); }
 
+   /// \brief Integer in [min, max], both included
+   int iRand(int min, int max) {
+      std::uint32_t range = std::uint32_t(max) - std::uint32_t(min) + 1;
+      std::uint32_t bits = std::uint32_t(gen() >> 32);
+      // The whole int range wraps to 0, every 32 bit value is fine then
+      if (range == 0) return int(bits);
+      return int(std::uint32_t(min) + rand_bounded(bits, range, [&] { return std::uint32_t(gen() >> 32); }));
+   }
 };
+
+
 //////////////////////////////////////////////////////////////////
-/// \brief Gets a random integer between the 2 given integers
+/// \brief Generator of the calling thread, seeded from hardware the
+/// first time each thread uses it
 //////////////////////////////////////////////////////////////////
-int iRand(int min, int max);
+inline randObj& rand_thread() {
+   thread_local randObj generator;
+   return generator;
+}
 
 //////////////////////////////////////////////////////////////////
 /// \brief Gets a random integer between the 2 given integers
 //////////////////////////////////////////////////////////////////
-float fRand(float min, float max);
+inline int iRand(int min, int max) { return rand_thread().iRand(min, max); }
+
+//////////////////////////////////////////////////////////////////
+/// \brief Gets a random float between the 2 given floats
+//////////////////////////////////////////////////////////////////
+inline float fRand(float min, float max) { return rand_thread().fRand(min, max); }
+
+
+//////////////////////////////////////////////////////////////////
+/// \brief Fills whole arrays with random numbers for spawning large
+/// numbers of objects or particles. Runs 8 xoshiro128** generators
+/// side by side, lane k makes values k, k + 8, k + 16 ... With AVX2
+/// all 8 lanes step in one instruction, with SSE 4, otherwise one at a
+/// time. Every build gives the same numbers for the same seed (random.cpp
+/// is compiled without fused multiply-adds), normal and sphere as long
+/// as the C library's log, sin and cos are the same.
+/// Each call continues from where the last one stopped (values left
+/// over in the last group of 8 are dropped)
+/// \param seed: eg. from randObj::gen() to tie it to a randObj
+//////////////////////////////////////////////////////////////////
+class randBatch {
+
+public:
+
+   explicit randBatch(std::uint64_t seed);
+
+   /// \brief Floats in [min, max)
+   void uniform(float* out, std::size_t count, float min = 0.0f, float max = 1.0f);
+
+   /// \brief Integers in [min, max], both included, without bias
+   void uniform(int* out, std::size_t count, int min, int max);
+
+   /// \brief Normal (gaussian) distribution with Box-Muller
+   void normal(float* out, std::size_t count, float mean = 0.0f, float deviation = 1.0f);
+
+   /// \brief Directions spread evenly over the unit sphere
+   void sphere(vec3* out, std::size_t count);
+
+   /// \brief Points spread evenly inside a box (axis aligned)
+   void box(vec3* out, std::size_t count, const vec3& min, const vec3& max);
+
+   /// \brief 32 random bits per value, the raw output of the lanes
+   void bits(std::uint32_t* out, std::size_t count);
+
+   static const int lanes = 8;
+
+private:
+
+   // s[word][lane] so each word of all 8 lanes loads as one register
+   alignas(32) std::uint32_t s[4][lanes];
+   // Only used for the rare retries of the bounded integers
+   xoshiro256 retry;
+};
+
+
+//////////////////////////////////////////////////////////////////
+/// \brief Counter based generator (Philox4x32-10, Salmon et al.). There
+/// is no state that changes, every (seed, stream, index) is hashed
+/// straight to 128 random bits, so any thread can make value i of a
+/// stream in any order and get exactly what a serial loop would.
+/// Use the stream to keep different uses apart (eg. one per planet
+/// layer) and the index for the element (vertex, tile, unit ...)
+/// \param seed: 64 bit key
+/// \param stream: Independent sequence for the same seed (Default: 0)
+//////////////////////////////////////////////////////////////////
+class randCounter {
+
+public:
+
+   constexpr randCounter(std::uint64_t _seed, std::uint64_t _stream = 0) : seed(_seed), stream(_stream) {}
+
+   /// \brief The 4 random words of an index
+   constexpr void block(std::uint64_t index, std::uint32_t out[4]) const {
+      std::uint32_t c[4] = {std::uint32_t(index), std::uint32_t(index >> 32), std::uint32_t(stream), std::uint32_t(stream >> 32)};
+      std::uint32_t k0 = std::uint32_t(seed), k1 = std::uint32_t(seed >> 32);
+      for (int round = 0; round < 10; round++) {
+         if (round > 0) { k0 += 0x9E3779B9; k1 += 0xBB67AE85; }
+         std::uint64_t p0 = std::uint64_t(0xD2511F53) * c[0], p1 = std::uint64_t(0xCD9E8D57) * c[2];
+         std::uint32_t n0 = std::uint32_t(p1 >> 32) ^ c[1] ^ k0, n2 = std::uint32_t(p0 >> 32) ^ c[3] ^ k1;
+         c[0] = n0; c[1] = std::uint32_t(p1); c[2] = n2; c[3] = std::uint32_t(p0);
+      }
+      for (int i = 0; i < 4; i++) out[i] = c[i];
+   }
+
+   /// \brief 32 random bits for an index (the first word of its block)
+   constexpr std::uint32_t bits(std::uint64_t index) const {
+      std::uint32_t b[4];
+      block(index, b);
+      return b[0];
+   }
+
+   /// \brief Float in [min, max) for an index
+   constexpr float fRand(std::uint64_t index, float min, float max) const {
+      return min + (max - min) * (float(bits(index) >> 8) * 0x1.0p-24f);
+   }
+
+   /// \brief Integer in [min, max] for an index. The other 3 words of the block are the retries
+   /// of Lemire's method. If all 4 are biased (up to 1 in 16 for ranges just above 2^31) more
+   /// words come from splitmix64 seeded with the block, so it stays unbiased and the same for
+   /// an index
+   constexpr int iRand(std::uint64_t index, int min, int max) const {
+      std::uint32_t b[4];
+      block(index, b);
+      std::uint32_t range = std::uint32_t(max) - std::uint32_t(min) + 1;
+      if (range == 0) return int(b[0]);
+      int retry = 1;
+      std::uint64_t more = std::uint64_t(b[2]) << 32 | b[3];
+      return int(std::uint32_t(min) + rand_bounded(b[0], range, [&] {
+         return retry < 4 ? b[retry++] : std::uint32_t(xoshiro256::splitmix64(more) >> 32);
+      }));
+   }
+
+   /// \brief Point in a box for an index, one word per axis
+   constexpr vec3 box(std::uint64_t index, const vec3& min, const vec3& max) const {
+      std::uint32_t b[4];
+      block(index, b);
+      return vec3(min.x + (max.x - min.x) * (float(b[0] >> 8) * 0x1.0p-24f),
+                  min.y + (max.y - min.y) * (float(b[1] >> 8) * 0x1.0p-24f),
+                  min.z + (max.z - min.z) * (float(b[2] >> 8) * 0x1.0p-24f));
+   }
+
+   /// \brief out[i] = fRand(first + i, min, max) for count values, 8 blocks at a time with AVX2 (4 with
+   /// SSE). Any split of a range over threads gives the same numbers
+   void uniform(float* out, std::uint64_t first, std::size_t count, float min = 0.0f, float max = 1.0f) const;
+
+   /// \brief out[i] = bits(first + i) for count values
+   void bits(std::uint32_t* out, std::uint64_t first, std::size_t count) const;
+
+   std::uint64_t seed;
+   std::uint64_t stream;
+};
@@ -0,0 +1,64 @@
+//////////////////////////////////////////////////////////////////
+// Headers
+//////////////////////////////////////////////////////////////////
+#include "scene.hpp"
+
+#include <iostream>
+
+
+// Bits of the changes array, a new camera only needs the view matrices rebuilt, not the children
+static const unsigned char worldChanged = 1;
+static const unsigned char cameraChanged = 2;
+
+
+unsigned int sceneGraph::add(unsigned int parent, const vec3& position, const quat& rotation, const vec3& scale) {
+   // Only existing nodes can be parents, that is what keeps the arrays parent-sorted
+   if (parent != none && parent >= parents.size()) {
+      std::cerr << "Scene node parent " << parent << " does not exist, adding the node at the top level" << std::endl;
+      parent = none;
+   }
+   parents.push_back(parent);
+   positions.push_back(position);
+   rotations.push_back(rotation);
+   scales.push_back(scale);
+   dirty.push_back(1);
+   changes.push_back(1);
+   worlds.emplace_back();
+   modelViews.emplace_back();
+   mvps.emplace_back();
+   normalMatrices.emplace_back();
+   return parents.size() - 1;
+}
+
+
+void sceneGraph::setCamera(const mat3x4& view, const mat4x4& project) {
+   viewMatrix = view;
+   viewProjectMatrix = view.toMat4() * project;
+   cameraDirty = true;
+}
+
+
+std::size_t sceneGraph::update() {
+   std::size_t recomputed = 0;
+
+   // Parents come first, so when a node is reached its parent already knows if it changed
+   for (std::size_t i = 0; i < parents.size(); i++) {
+      unsigned int p = parents[i];
+      bool moved = dirty[i] || (p != none && (changes[p] & worldChanged));
+      if (moved) {
+         mat3x4 local = matrix_transform(positions[i], rotations[i], scales[i]);
+         worlds[i] = p == none ? local : local * worlds[p];
+         dirty[i] = 0;
+         recomputed++;
+      }
+      changes[i] = (moved ? worldChanged : 0) | (cameraDirty ? cameraChanged : 0);
+      if (changes[i]) {
+         modelViews[i] = worlds[i] * viewMatrix;
+         mvps[i] = worlds[i].toMat4() * viewProjectMatrix;
+
+         normalMatrices[i] = matrix_normal(modelViews[i]);
+      }
+   }
+   cameraDirty = false;
+   return recomputed;
+}
@@ -0,0 +1,104 @@
+#pragma once
+
+//////////////////////////////////////////////////////////////////
+// Headers
+//////////////////////////////////////////////////////////////////
+#include <cstddef>
+#include <vector>
+#include "matrix.hpp"
+#include "quaternion.hpp"
+
+//////////////////////////////////////////////////////////////////
+/// \brief Transform hierarchy of scene nodes. Every node has a local position, rotation and
+/// scale relative to its parent. The nodes are stored as flat arrays (one array per field) in
+/// parent-sorted order: a node can only be added under a node that already exists, so a
+/// parent always comes before its children and one pass from front to back sees every
+/// parent's world matrix before its children need it.
+/// Changing a local transform only marks the node dirty. update then recomputes the world
+/// matrix (and model-view-projection) of dirty nodes and everything below them, static
+/// nodes cost one flag check each
+//////////////////////////////////////////////////////////////////
+class sceneGraph {
+
+public:
+
+   // Parent of the top level nodes
+   static const unsigned int none = ~0u;
+
+   //////////////////////////////////////////////////////////////////
+   /// \brief Adds a node at the end of the arrays
+   /// \param parent: Node the transform is relative to (Default: none, relative to the world)
+   /// \param position: Local translation
+   /// \param rotation: Local rotation
+   /// \param scale: Local scale along each axis
+   /// \return Index of the node, used with every other function
+   //////////////////////////////////////////////////////////////////
+   unsigned int add(unsigned int parent = none, const vec3& position = vec3(), const quat& rotation = quat(), const vec3& scale = vec3(1.0f, 1.0f, 1.0f));
+
+   //////////////////////////////////////////////////////////////////
+   /// \brief Changing the local transform marks the node (and so its subtree) dirty
+   //////////////////////////////////////////////////////////////////
+   void setPosition(unsigned int node, const vec3& position) { positions[node] = position; dirty[node] = 1; }
+   void setRotation(unsigned int node, const quat& rotation) { rotations[node] = rotation; dirty[node] = 1; }
+   void setScale(unsigned int node, const vec3& scale) { scales[node] = scale; dirty[node] = 1; }
+
+   const vec3& position(unsigned int node) const { return positions[node]; }
+   const quat& rotation(unsigned int node) const { return rotations[node]; }
+   const vec3& scale(unsigned int node) const { return scales[node]; }
+   unsigned int parent(unsigned int node) const { return parents[node]; }
+
+   //////////////////////////////////////////////////////////////////
+   /// \brief Sets the camera, the model-view-projection of every node is rebuilt on the next update
+   /// \param view: View matrix (matrix_view)
+   /// \param project: Projection matrix (matrix_project)
+   //////////////////////////////////////////////////////////////////
+   void setCamera(const mat3x4& view, const mat4x4& project);
+
+   const mat3x4& view() const { return viewMatrix; }
+   // Projection applied after the view, for shaders that build the model matrix themselves (instancing)
+   const mat4x4& viewProject() const { return viewProjectMatrix; }
+
+   //////////////////////////////////////////////////////////////////
+   /// \brief Recomputes the world matrices of dirty nodes and their descendants in one linear
+   /// pass, and the model-view-projection of every node whose world matrix or camera changed
+   /// \return Number of world matrices that were recomputed
+   //////////////////////////////////////////////////////////////////
+   std::size_t update();
+
+   //////////////////////////////////////////////////////////////////
+   /// \brief Results of the last update
+   //////////////////////////////////////////////////////////////////
+   // Local to world matrix
+   const mat3x4& world(unsigned int node) const { return worlds[node]; }
+   // Local to view space (view applied after world)
+   const mat3x4& modelView(unsigned int node) const { return modelViews[node]; }
+   // Local to clip space
+   const mat4x4& mvp(unsigned int node) const { return mvps[node]; }
+   // Inverse transpose of the model-view rotation/scale (translation is 0), turns normals into view
+   // space and keeps them perpendicular under non-uniform scale
+   const mat3x4& normalMatrix(unsigned int node) const { return normalMatrices[node]; }
+   // True if the matrices of the node changed in the last update (eg. to only upload those)
+   bool changed(unsigned int node) const { return changes[node] != 0; }
+
+   std::size_t size() const { return parents.size(); }
+
+private:
+
+   std::vector<unsigned int> parents;
+   std::vector<vec3> positions;
+   std::vector<quat> rotations;
+   std::vector<vec3> scales;
+   // Set when the local transform changed since the last update
+   std::vector<unsigned char> dirty;
+   // Set by update for every node whose matrices it rebuilt
+   std::vector<unsigned char> changes;
+
+   std::vector<mat3x4> worlds;
+   std::vector<mat3x4> modelViews;
+   std::vector<mat4x4> mvps;
+   std::vector<mat3x4> normalMatrices;
+
+   mat3x4 viewMatrix;
+   mat4x4 viewProjectMatrix;
+   bool cameraDirty = true;
+};
@@ -0,0 +1,21 @@
+#pragma once
+
+//XXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXX
+// Compile time selection of the SIMD instruction set used by the math code
+//XXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXX
+// The compiler defines __AVX2__/__SSE4_1__/__ARM_NEON from the -march flags (GL_NATIVE_ARCH in
+// CMakeLists.txt). Define MATH_NO_SIMD to force the scalar code, eg. to compare results.
+
+#if !defined(MATH_NO_SIMD) && defined(__AVX2__) && defined(__FMA__)
+   #define MATH_AVX2
+#endif
+#if !defined(MATH_NO_SIMD) && defined(__SSE4_1__)
+   #define MATH_SSE
+   #include <immintrin.h>
+#elif !defined(MATH_NO_SIMD) && (defined(__ARM_NEON) || defined(__ARM_NEON__))
+   #define MATH_NEON
+   #include <arm_neon.h>
+#endif
+#if defined(MATH_SSE) || defined(MATH_NEON)
+   #define MATH_SIMD
+#endif
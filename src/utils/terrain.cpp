@@ -0,0 +1,317 @@
+//////////////////////////////////////////////////////////////////
+// Headers
+//////////////////////////////////////////////////////////////////
+#include "terrain.hpp"
+
+#include <algorithm>
+#include <cmath>
+
+
+static const float quarterPi = 0.78539816339f;
+
+// Normal, right and up of every cube face, right x up = normal so the chunks wind outwards
+static const float faceAxes[6][3][3] = {
+   {{1, 0, 0}, {0, 0, -1}, {0, 1, 0}},
+   {{-1, 0, 0}, {0, 0, 1}, {0, 1, 0}},
+   {{0, 1, 0}, {1, 0, 0}, {0, 0, -1}},
+   {{0, -1, 0}, {1, 0, 0}, {0, 0, 1}},
+   {{0, 0, 1}, {1, 0, 0}, {0, 1, 0}},
+   {{0, 0, -1}, {-1, 0, 0}, {0, 1, 0}},
+};
+
+
+vec3 terrainTree::direction(int face, float u, float v) {
+   // Equal angles instead of equal steps on the cube, the cells near the corners are not squeezed
+   float tu = std::tan(u * quarterPi), tv = std::tan(v * quarterPi);
+   const float (*a)[3] = faceAxes[face];
+   return vec3(a[0][0] + a[1][0] * tu + a[2][0] * tv, a[0][1] + a[1][1] * tu + a[2][1] * tv, a[0][2] + a[1][2] * tu + a[2][2] * tv).normal();
+}
+
+
+// Inner vertex k of boundary edge e, the edges go around the chunk counter clockwise
+static inline int edgeVertex(int n, int e, int k) {
+   int i = e == 0 ? k : e == 1 ? n : e == 2 ? n - k : 0;
+   int j = e == 0 ? 0 : e == 1 ? k : e == 2 ? n : n - k;
+   return j * (n + 1) + i;
+}
+
+
+// Center and bounding sphere of a chunk from its height range
+static void chunkBounds(const terrainSettings& settings, std::uint64_t key, float low, float high, vec3& center, float& bound) {
+   const int f = terrainTree::face(key);
+   const float size = 2.0f / float(1u << terrainTree::level(key));
+   const float u0 = -1.0f + float(terrainTree::x(key)) * size, v0 = -1.0f + float(terrainTree::y(key)) * size;
+   const float depth = settings.skirt * settings.radius * 2.0f * quarterPi * size;
+   vec3 middle = terrainTree::direction(f, u0 + size * 0.5f, v0 + size * 0.5f);
+   center = middle * (settings.radius + (low + high) * 0.5f);
+   // The corners are the farthest points of the patch at the top and at the bottom of the skirts
+   bound = 0.0f;
+   for (int c = 0; c < 5; c++) {
+      vec3 d = c < 4 ? terrainTree::direction(f, u0 + size * float(c & 1), v0 + size * float(c >> 1)) : middle;
+      bound = std::max(bound, std::max((d * (settings.radius + high) - center).mag(), (d * (settings.radius + low - depth) - center).mag()));
+   }
+}
+
+
+terrainTree::terrainTree(const terrainSettings& _settings) : settings(_settings) {
+   settings.resolution = std::max(2, settings.resolution);
+   settings.maxLevel = std::clamp(settings.maxLevel, 0, 24);
+   settings.capacity = std::max<std::size_t>(settings.capacity, 6);
+
+   // The grid, then a skirt hanging down from every edge. Going around counter clockwise the
+   // outside is on the right so every skirt faces away from its chunk
+   const int n = settings.resolution;
+   for (int j = 0; j < n; j++)
+      for (int i = 0; i < n; i++) {
+         int a = j * (n + 1) + i, b = a + 1, c = a + n + 1, d = c + 1;
+         shared.insert(shared.end(), {a, b, d, a, d, c});
+      }
+   const int base = (n + 1) * (n + 1);
+   for (int e = 0; e < 4; e++)
+      for (int k = 0; k < n; k++) {
+         int top = edgeVertex(n, e, k), next = edgeVertex(n, e, k + 1), skirt = base + e * (n + 1) + k;
+         shared.insert(shared.end(), {top, skirt, skirt + 1, top, skirt + 1, next});
+      }
+
+   // The 6 roots are made right away so there is always something to draw
+   for (int f = 0; f < 6; f++) {
+      done.push_back(generate(settings, key(f, 0, 0, 0)));
+      doneKeys.insert(done.back().key);
+   }
+
+   int threads = settings.workers > 0 ? settings.workers : std::max(1, int(std::thread::hardware_concurrency()) - 1);
+   for (int t = 0; t < threads; t++) workers.emplace_back(&terrainTree::work, this);
+}
+
+
+terrainTree::~terrainTree() {
+   {
+      std::lock_guard<std::mutex> lock(mutex);
+      stop = true;
+   }
+   wake.notify_all();
+   for (std::thread& worker : workers) worker.join();
+}
+
+
+void terrainTree::work() {
+   for (;;) {
+      std::uint64_t next;
+      {
+         std::unique_lock<std::mutex> lock(mutex);
+         wake.wait(lock, [&] { return stop || !queue.empty(); });
+         if (stop) return;
+         next = queue.front();
+         queue.pop_front();
+         working.insert(next);
+      }
+      terrainChunk chunk = generate(settings, next);
+      std::lock_guard<std::mutex> lock(mutex);
+      working.erase(next);
+      doneKeys.insert(next);
+      done.push_back(std::move(chunk));
+   }
+}
+
+
+terrainChunk terrainTree::generate(const terrainSettings& settings, std::uint64_t key) {
+   const int f = face(key);
+   const float size = 2.0f / float(1u << level(key));
+   const float u0 = -1.0f + float(x(key)) * size, v0 = -1.0f + float(y(key)) * size;
+
+   if (!settings.vertices) {
+      // Only the bounds, from a coarse grid. The vertices in between can reach a bit higher or
+      // lower than the samples so the range is widened by a quarter
+      const int cells = std::min(settings.resolution, 8);
+      std::vector<vec3> directions((cells + 1) * (cells + 1));
+      for (int j = 0; j <= cells; j++)
+         for (int i = 0; i <= cells; i++) directions[j * (cells + 1) + i] = direction(f, u0 + size * float(i) / float(cells), v0 + size * float(j) / float(cells));
+      std::vector<float> heights(directions.size());
+      noise_batch(settings.terrain, directions.data(), heights.data(), directions.size());
+      auto [low, high] = std::minmax_element(heights.begin(), heights.end());
+      float margin = (*high - *low) * 0.25f;
+      terrainChunk chunk;
+      chunk.key = key;
+      chunk.low = std::max(-1.0f, *low - margin) * settings.amplitude;
+      chunk.high = std::min(1.0f, *high + margin) * settings.amplitude;
+      chunkBounds(settings, key, chunk.low, chunk.high, chunk.center, chunk.bound);
+      return chunk;
+   }
+
+   const int n = settings.resolution, side = n + 3;
+   const float step = size / float(n);
+
+   // One sample more all around so the normals on the edges match the neighbouring chunk
+   std::vector<vec3> directions(side * side);
+   for (int j = 0; j < side; j++)
+      for (int i = 0; i < side; i++) directions[j * side + i] = direction(f, u0 + float(i - 1) * step, v0 + float(j - 1) * step);
+   std::vector<float> heights(directions.size());
+   noise_batch(settings.terrain, directions.data(), heights.data(), directions.size());
+   std::vector<vec3> positions(directions.size());
+   for (std::size_t i = 0; i < directions.size(); i++) positions[i] = directions[i] * (settings.radius + settings.amplitude * heights[i]);
+
+   terrainChunk chunk;
+   chunk.key = key;
+   chunk.low = settings.amplitude;
+   chunk.high = -settings.amplitude;
+   for (int j = 1; j <= n + 1; j++)
+      for (int i = 1; i <= n + 1; i++) {
+         chunk.low = std::min(chunk.low, settings.amplitude * heights[j * side + i]);
+         chunk.high = std::max(chunk.high, settings.amplitude * heights[j * side + i]);
+      }
+   chunk.center = direction(f, u0 + size * 0.5f, v0 + size * 0.5f) * (settings.radius + (chunk.low + chunk.high) * 0.5f);
+   chunk.bound = 0.0f;
+   chunk.vertices.resize(vertexCount(n) * 6);
+   float* out = chunk.vertices.data();
+   std::vector<vec3> normals((n + 1) * (n + 1));
+   for (int j = 0; j <= n; j++)
+      for (int i = 0; i <= n; i++) {
+         const vec3* p = &positions[(j + 1) * side + i + 1];
+         vec3 normal = (p[1] - p[-1]).cross(p[side] - p[-side]).normal();
+         normals[j * (n + 1) + i] = normal;
+         *out++ = p->x; *out++ = p->y; *out++ = p->z;
+         *out++ = normal.x; *out++ = normal.y; *out++ = normal.z;
+         chunk.bound = std::max(chunk.bound, (*p - chunk.center).mag());
+      }
+   // The skirts reach down by a part of the chunk size, coarser chunks leave bigger cracks
+   const float depth = settings.skirt * settings.radius * 2.0f * quarterPi * size;
+   for (int e = 0; e < 4; e++)
+      for (int k = 0; k <= n; k++) {
+         int v = edgeVertex(n, e, k), i = v % (n + 1), j = v / (n + 1);
+         std::size_t sample = (j + 1) * side + i + 1;
+         vec3 p = directions[sample] * (settings.radius + settings.amplitude * heights[sample] - depth);
+         *out++ = p.x; *out++ = p.y; *out++ = p.z;
+         *out++ = normals[v].x; *out++ = normals[v].y; *out++ = normals[v].z;
+         chunk.bound = std::max(chunk.bound, (p - chunk.center).mag());
+      }
+   return chunk;
+}
+
+
+void terrainTree::bounds(std::uint64_t key, float low, float high, vec3& center, float& bound) const {
+   chunkBounds(settings, key, low, high, center, bound);
+}
+
+
+bool terrainTree::visible(const vec3& center, float bound, const vec3& camera, const frustum* view) const {
+   if (view && !view->sphereVisible(center, bound)) return false;
+   // Behind the horizon: the lowest ground hides everything farther around the planet than the
+   // camera's horizon plus the horizon of the highest peak
+   float low = settings.radius - settings.amplitude, high = settings.radius + settings.amplitude;
+   float distance = camera.mag(), size = center.mag();
+   if (distance <= low || size <= 0.0f) return true;
+   float angle = std::acos(std::clamp(camera.dot(center) / (distance * size), -1.0f, 1.0f));
+   float radius = std::asin(std::min(1.0f, bound / size));
+   return angle - radius <= std::acos(low / distance) + std::acos(std::min(1.0f, low / high));
+}
+
+
+void terrainTree::visit(std::uint64_t node, float low, float high, const vec3& camera, float pixelScale, const frustum* view) {
+   // A ready chunk has its real bounds, the others are guessed from the heights of the parent
+   vec3 center;
+   float bound;
+   auto it = ready.find(node);
+   if (it != ready.end()) {
+      center = it->second.center;
+      bound = it->second.bound;
+      low = it->second.low;
+      high = it->second.high;
+   }
+   else bounds(node, low, high, center, bound);
+   if (!visible(center, bound, camera, view)) return;
+
+   // Space between the vertices of the chunk on screen, seen from its closest point
+   const int l = level(node);
+   float spacing = settings.radius * 2.0f * quarterPi / float(1u << l) / float(settings.resolution);
+   float distance = std::max((camera - center).mag() - bound, settings.radius * 1e-6f);
+   if (l < settings.maxLevel && spacing * pixelScale / distance > settings.maxPixelError) {
+      // The children can reach a bit past the heights sampled on the parent's vertices
+      float margin = (high - low) * 0.5f;
+      // Only split once all 4 children are there (or culled), until then the chunk stays
+      std::uint64_t children[4];
+      bool all = true;
+      for (int c = 0; c < 4; c++) {
+         children[c] = key(face(node), l + 1, x(node) * 2 + (c & 1), y(node) * 2 + (c >> 1));
+         auto child = ready.find(children[c]);
+         vec3 childCenter;
+         float childBound;
+         if (child != ready.end()) {
+            childCenter = child->second.center;
+            childBound = child->second.bound;
+         }
+         else bounds(children[c], low - margin, high + margin, childCenter, childBound);
+         if (!visible(childCenter, childBound, camera, view)) continue;
+         // A ready child waiting for the others counts as used, it is not evicted
+         if (child != ready.end()) child->second.last = frame;
+         else {
+            all = false;
+            wanted.push_back(children[c]);
+         }
+      }
+      if (all) {
+         for (std::uint64_t child : children) visit(child, low - margin, high + margin, camera, pixelScale, view);
+         return;
+      }
+   }
+   if (it != ready.end()) {
+      it->second.last = frame;
+      drawn.push_back(node);
+   }
+   else wanted.push_back(node);
+}
+
+
+const std::vector<std::uint64_t>& terrainTree::select(const vec3& camera, float pixelScale, const frustum* view) {
+   frame++;
+   drawn.clear();
+   wanted.clear();
+   for (int f = 0; f < 6; f++) visit(key(f, 0, 0, 0), -settings.amplitude, settings.amplitude, camera, pixelScale, view);
+
+   // Coarse chunks first, they unlock the splits above the finer ones. The old queue is dropped,
+   // chunks the camera moved away from are not made anymore
+   std::stable_sort(wanted.begin(), wanted.end(), [](std::uint64_t a, std::uint64_t b) { return level(a) < level(b); });
+   {
+      std::lock_guard<std::mutex> lock(mutex);
+      queue.clear();
+      for (std::uint64_t k : wanted)
+         if (!working.count(k) && !doneKeys.count(k)) queue.push_back(k);
+   }
+   wake.notify_all();
+   return drawn;
+}
+
+
+void terrainTree::collect(std::size_t max, std::vector<terrainChunk>& finished, std::vector<std::uint64_t>& evicted) {
+   finished.clear();
+   evicted.clear();
+   std::lock_guard<std::mutex> lock(mutex);
+   std::size_t take = std::min(max, done.size());
+
+   if (ready.size() + take > settings.capacity) {
+      // Make room by dropping the chunks drawn the longest ago, never the roots or what is on screen
+      std::vector<std::pair<unsigned int, std::uint64_t>> old;
+      for (const auto& [k, chunk] : ready)
+         if (level(k) > 0 && chunk.last != frame) old.push_back({chunk.last, k});
+      std::size_t need = std::min(ready.size() + take - settings.capacity, old.size());
+      std::partial_sort(old.begin(), old.begin() + need, old.end());
+      for (std::size_t i = 0; i < need; i++) {
+         ready.erase(old[i].second);
+         evicted.push_back(old[i].second);
+      }
+      take = std::min(take, settings.capacity - std::min(settings.capacity, ready.size()));
+   }
+
+   std::stable_sort(done.begin(), done.end(), [](const terrainChunk& a, const terrainChunk& b) { return level(a.key) < level(b.key); });
+   for (std::size_t i = 0; i < take; i++) {
+      ready[done[i].key] = {frame, done[i].low, done[i].high, done[i].center, done[i].bound};
+      doneKeys.erase(done[i].key);
+      finished.push_back(std::move(done[i]));
+   }
+   done.erase(done.begin(), done.begin() + take);
+}
+
+
+bool terrainTree::idle() {
+   std::lock_guard<std::mutex> lock(mutex);
+   return queue.empty() && working.empty() && done.empty();
+}
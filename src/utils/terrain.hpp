@@ -0,0 +1,175 @@
+#pragma once
+
+//////////////////////////////////////////////////////////////////
+// Headers
+//////////////////////////////////////////////////////////////////
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <mutex>
+#include <thread>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+#include "matrix.hpp"
+#include "noise.hpp"
+
+//////////////////////////////////////////////////////////////////
+/// \brief Everything that describes a level of detail planet
+/// \param radius: Radius of the sphere at height 0
+/// \param amplitude: Height of a noise value of 1
+/// \param terrain: Noise layer sampled on the unit sphere
+/// \param resolution: Quads along the side of a chunk
+/// \param maxLevel: Deepest split of a cube face
+/// \param maxPixelError: A chunk is split when the space between its
+/// vertices is larger than this on screen (in pixels)
+/// \param skirt: Depth of the skirts that hide the cracks between
+/// chunks of different levels, relative to the size of the chunk
+/// \param capacity: Chunks kept ready to draw (eg. slots on the GPU)
+/// \param workers: Threads generating chunks (Default: 0, one less than
+/// the hardware threads)
+/// \param vertices: Make the vertices of the chunks on the worker threads.
+/// When false the vertices are left to the GPU (gl_terrain with a compute
+/// program) and the workers only sample a coarse grid for the bounds
+//////////////////////////////////////////////////////////////////
+struct terrainSettings {
+   float radius = 1.0f;
+   float amplitude = 0.02f;
+   noiseSettings terrain;
+   int resolution = 32;
+   int maxLevel = 16;
+   float maxPixelError = 4.0f;
+   float skirt = 0.05f;
+   std::size_t capacity = 512;
+   int workers = 0;
+   bool vertices = true;
+};
+
+//////////////////////////////////////////////////////////////////
+/// \brief The mesh of one chunk, position xyz then normal xyz of every
+/// vertex (the same layout as planetMesh): the (resolution + 1)^2 grid
+/// row by row, then the skirt under each of the 4 edges going around
+/// counter clockwise. All chunks share one index list
+/// (terrainTree::indices). Empty when the GPU makes the vertices
+//////////////////////////////////////////////////////////////////
+struct terrainChunk {
+   std::uint64_t key;
+   std::vector<float> vertices;
+   // Bounding sphere of the vertices, lowest and highest height above the radius
+   vec3 center;
+   float bound;
+   float low, high;
+};
+
+
+//////////////////////////////////////////////////////////////////
+/// \brief Quadtree level of detail for a planet. The sphere is a cube
+/// with its points pushed out to the radius (equal angle, so the cells
+/// stay about the same size), every face the root of a quadtree of
+/// chunks. select picks the chunks for a camera from their screen space
+/// error, so about the same number of triangles is drawn at any height,
+/// skipping the chunks outside the frustum or behind the horizon.
+/// Missing chunks are made on the worker threads, until all 4 children
+/// of a chunk are ready the chunk itself is drawn. Skirts around every
+/// chunk hide the cracks where two levels meet.
+/// Every frame: select, then collect the finished chunks (at most a few
+/// per frame to spread out the uploads), then draw selection()
+//////////////////////////////////////////////////////////////////
+class terrainTree {
+
+public:
+
+   explicit terrainTree(const terrainSettings& settings);
+   ~terrainTree();
+
+   terrainTree(const terrainTree&) = delete;
+   terrainTree& operator=(const terrainTree&) = delete;
+
+   //////////////////////////////////////////////////////////////////
+   /// \brief Picks the chunks to draw and queues the ones that are missing
+   /// \param camera: Position of the camera in the planet's space
+   /// \param pixelScale: From pixelScale, turns a size over a distance into pixels
+   /// \param view: Chunks outside are skipped (Default: nullptr, no culling)
+   /// \return The chunks to draw, every one of them was collected before
+   //////////////////////////////////////////////////////////////////
+   const std::vector<std::uint64_t>& select(const vec3& camera, float pixelScale, const frustum* view = nullptr);
+
+   //////////////////////////////////////////////////////////////////
+   /// \brief Hands out finished chunks, they count as ready from now on
+   /// \param max: Most chunks to hand out (the upload budget of a frame)
+   /// \param finished: Filled with the new chunks
+   /// \param evicted: Filled with the chunks dropped to make room, the
+   /// least recently drawn ones
+   //////////////////////////////////////////////////////////////////
+   void collect(std::size_t max, std::vector<terrainChunk>& finished, std::vector<std::uint64_t>& evicted);
+
+   const std::vector<std::uint64_t>& selection() const { return drawn; }
+   const std::vector<int>& indices() const { return shared; }
+   std::size_t vertexCount() const { return vertexCount(settings.resolution); }
+   std::size_t triangleCount() const { return shared.size() / 3; }
+   std::size_t capacity() const { return settings.capacity; }
+   // True when no chunk is queued, being made or waiting to be collected
+   bool idle();
+
+   //////////////////////////////////////////////////////////////////
+   /// \brief Pixels per unit of size at a distance of 1, from the same
+   /// projection matrix (matrix_project) and viewport height as the camera
+   //////////////////////////////////////////////////////////////////
+   static float pixelScale(const mat4x4& project, float viewportHeight) { return project.m[1][1] * viewportHeight * 0.5f; }
+
+   const terrainSettings& parameters() const { return settings; }
+
+   //////////////////////////////////////////////////////////////////
+   /// \brief Makes the mesh of a chunk, what the workers run. Also the
+   /// reference the compute program of gl_terrain is checked against
+   //////////////////////////////////////////////////////////////////
+   static terrainChunk generate(const terrainSettings& settings, std::uint64_t key);
+
+   // Chunk keys: cube face in bits 61-63, level in 56-60 and x, y in the quadtree in 28 bits each
+   static std::uint64_t key(int face, int level, std::uint32_t x, std::uint32_t y) {
+      return (std::uint64_t(face) << 61) | (std::uint64_t(level) << 56) | (std::uint64_t(x) << 28) | y;
+   }
+   static int face(std::uint64_t key) { return int(key >> 61); }
+   static int level(std::uint64_t key) { return int(key >> 56) & 31; }
+   static std::uint32_t x(std::uint64_t key) { return std::uint32_t(key >> 28) & 0xFFFFFFF; }
+   static std::uint32_t y(std::uint64_t key) { return std::uint32_t(key) & 0xFFFFFFF; }
+
+   // Direction through a point of a cube face, u and v in [-1, 1]
+   static vec3 direction(int face, float u, float v);
+   static std::size_t vertexCount(int resolution) { return std::size_t(resolution + 1) * (resolution + 1) + 4 * std::size_t(resolution + 1); }
+
+private:
+
+   // Center and bounding sphere of a chunk before it exists, from its corners and a height range
+   void bounds(std::uint64_t key, float low, float high, vec3& center, float& bound) const;
+   // Inside the frustum and not behind the horizon
+   bool visible(const vec3& center, float bound, const vec3& camera, const frustum* view) const;
+   void visit(std::uint64_t key, float low, float high, const vec3& camera, float pixelScale, const frustum* view);
+   void work();
+
+   terrainSettings settings;
+   std::vector<int> shared;
+   unsigned int frame = 0;
+
+   // Main thread only, the ready chunks with the frame they were last drawn in
+   struct readyChunk {
+      unsigned int last;
+      float low, high;
+      vec3 center;
+      float bound;
+   };
+   std::unordered_map<std::uint64_t, readyChunk> ready;
+   std::vector<std::uint64_t> drawn;
+   std::vector<std::uint64_t> wanted;
+
+   // Shared with the workers, behind the mutex
+   std::mutex mutex;
+   std::condition_variable wake;
+   std::deque<std::uint64_t> queue;
+   std::unordered_set<std::uint64_t> working;
+   std::vector<terrainChunk> done;
+   std::unordered_set<std::uint64_t> doneKeys;
+   bool stop = false;
+   std::vector<std::thread> workers;
+};
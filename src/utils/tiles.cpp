@@ -0,0 +1,175 @@
+//////////////////////////////////////////////////////////////////
+// Headers
+//////////////////////////////////////////////////////////////////
+#include "tiles.hpp"
+#include "parallel.hpp"
+
+#include <algorithm>
+#include <cmath>
+
+
+// Cell of the lookup table: the cube face of the largest axis, then the other two axes divided by
+// it on a side x side grid
+static inline std::size_t lookupCell(const vec3& d, int side) {
+   float ax = std::fabs(d.x), ay = std::fabs(d.y), az = std::fabs(d.z);
+   int axis = ax >= ay && ax >= az ? 0 : ay >= az ? 1 : 2;
+   float c[3] = {d.x, d.y, d.z};
+   float m = std::fabs(c[axis]);
+   if (m <= 0.0f) return 0;
+   int face = axis * 2 + (c[axis] < 0.0f);
+   float u = c[(axis + 1) % 3] / m, v = c[(axis + 2) % 3] / m;
+   int i = std::clamp(int((u + 1.0f) * 0.5f * float(side)), 0, side - 1);
+   int j = std::clamp(int((v + 1.0f) * 0.5f * float(side)), 0, side - 1);
+   return (std::size_t(face) * side + j) * side + i;
+}
+
+// Direction through the middle of a cell
+static inline vec3 cellDirection(int face, int i, int j, int side) {
+   float c[3];
+   int axis = face / 2;
+   c[axis] = face & 1 ? -1.0f : 1.0f;
+   c[(axis + 1) % 3] = (float(i) + 0.5f) / float(side) * 2.0f - 1.0f;
+   c[(axis + 2) % 3] = (float(j) + 0.5f) / float(side) * 2.0f - 1.0f;
+   return vec3(c[0], c[1], c[2]);
+}
+
+
+int tileGrid::locate(const vec3& direction, int tile) const {
+   // On the icosphere the closest center always has a neighbour closer than any other tile, so
+   // walking downhill ends at the closest one
+   float best = x[tile] * direction.x + y[tile] * direction.y + z[tile] * direction.z;
+   for (;;) {
+      int next = -1;
+      for (int k = offsets[tile]; k < offsets[tile + 1]; k++) {
+         int n = neighbors[k];
+         float d = x[n] * direction.x + y[n] * direction.y + z[n] * direction.z;
+         if (d > best) {
+            best = d;
+            next = n;
+         }
+      }
+      if (next < 0) return tile;
+      tile = next;
+   }
+}
+
+
+int tileGrid::locate(const vec3& direction) const {
+   return locate(direction, lookup[lookupCell(direction, lookupSide)]);
+}
+
+
+tileGrid tiles_generate(int level) {
+   std::vector<vec3> directions;
+   std::vector<int> indices;
+   planet_sphere(level, directions, indices);
+   const std::size_t tiles = directions.size(), triangles = indices.size() / 3;
+
+   tileGrid grid;
+   grid.x.resize(tiles);
+   grid.y.resize(tiles);
+   grid.z.resize(tiles);
+   parallel_for(tiles, 4096, [&](std::size_t begin, std::size_t end) {
+      for (std::size_t t = begin; t < end; t++) {
+         grid.x[t] = directions[t].x;
+         grid.y[t] = directions[t].y;
+         grid.z[t] = directions[t].z;
+      }
+   });
+
+   // Every triangle is a corner of its 3 tiles
+   grid.cornerX.resize(triangles);
+   grid.cornerY.resize(triangles);
+   grid.cornerZ.resize(triangles);
+   parallel_for(triangles, 4096, [&](std::size_t begin, std::size_t end) {
+      for (std::size_t c = begin; c < end; c++) {
+         vec3 p = (directions[indices[c * 3]] + directions[indices[c * 3 + 1]] + directions[indices[c * 3 + 2]]).normal();
+         grid.cornerX[c] = p.x;
+         grid.cornerY[c] = p.y;
+         grid.cornerZ[c] = p.z;
+      }
+   });
+
+   // The triangles around every tile, in triangle order (a counting sort)
+   grid.offsets.assign(tiles + 1, 0);
+   for (int v : indices) grid.offsets[v + 1]++;
+   for (std::size_t t = 0; t < tiles; t++) grid.offsets[t + 1] += grid.offsets[t];
+   std::vector<int> around(indices.size()), fill(grid.offsets.begin(), grid.offsets.end() - 1);
+   for (std::size_t i = 0; i < indices.size(); i++) around[fill[indices[i]]++] = int(i / 3);
+
+   // Put them in order: a triangle (tile, a, b) is counter clockwise, so the next one around the
+   // tile starts with b. Neighbour k is a of triangle k and corner k is triangle k, which lies
+   // between a and b (the next neighbour)
+   grid.neighbors.resize(indices.size());
+   grid.corners.resize(indices.size());
+   parallel_for(tiles, 4096, [&](std::size_t begin, std::size_t end) {
+      for (std::size_t t = begin; t < end; t++) {
+         const int first = grid.offsets[t], count = grid.offsets[t + 1] - first;
+         int a[6], b[6];
+         for (int k = 0; k < count; k++) {
+            const int* tri = &indices[std::size_t(around[first + k]) * 3];
+            int at = tri[0] == int(t) ? 0 : tri[1] == int(t) ? 1 : 2;
+            a[k] = tri[(at + 1) % 3];
+            b[k] = tri[(at + 2) % 3];
+         }
+         int k = 0;
+         for (int step = 0; step < count; step++) {
+            grid.neighbors[first + step] = a[k];
+            grid.corners[first + step] = around[first + k];
+            int next = 0;
+            while (next < count && a[next] != b[k]) next++;
+            k = next;
+         }
+      }
+   });
+
+   // Lookup: about one cell per tile. Every row walks from the closest tile of its first cell,
+   // which the first row of a face finds from tile 0
+   grid.lookupSide = std::max(1, int(std::ceil(std::sqrt(double(tiles) / 6.0))));
+   const int side = grid.lookupSide;
+   grid.lookup.resize(std::size_t(6) * side * side);
+   parallel_for(std::size_t(6) * side, 1, [&](std::size_t begin, std::size_t end) {
+      for (std::size_t row = begin; row < end; row++) {
+         int face = int(row / side), j = int(row % side);
+         int tile = grid.locate(cellDirection(face, 0, j, side), 0);
+         for (int i = 0; i < side; i++) {
+            tile = grid.locate(cellDirection(face, i, j, side), tile);
+            grid.lookup[(std::size_t(face) * side + j) * side + i] = tile;
+         }
+      }
+   }, 1);
+   return grid;
+}
+
+
+void tiles_mesh(const tileGrid& grid, float radius, std::vector<tileVertex>& vertices, std::vector<int>& indices) {
+   vertices.resize(grid.size() + grid.neighbors.size());
+   indices.resize(grid.neighbors.size() * 3);
+   parallel_for(grid.size(), 4096, [&](std::size_t begin, std::size_t end) {
+      for (std::size_t t = begin; t < end; t++) {
+         const int first = grid.offsets[t], count = grid.offsets[t + 1] - first;
+         const int base = int(t) + first;
+         const std::uint32_t tile = std::uint32_t(t);
+         vertices[base] = {grid.x[t] * radius, grid.y[t] * radius, grid.z[t] * radius, 0.0f, tile};
+         for (int k = 0; k < count; k++) {
+            int c = grid.corners[first + k];
+            vertices[base + 1 + k] = {grid.cornerX[c] * radius, grid.cornerY[c] * radius, grid.cornerZ[c] * radius, 1.0f, tile};
+            int* out = &indices[std::size_t(first + k) * 3];
+            out[0] = base;
+            out[1] = base + 1 + k;
+            out[2] = base + 1 + (k + 1) % count;
+         }
+      }
+   });
+}
+
+
+void tiles_ranges(std::vector<int>& tiles, int mergeGap, std::size_t stride, std::vector<tileRange>& ranges) {
+   ranges.clear();
+   std::sort(tiles.begin(), tiles.end());
+   for (std::size_t i = 0; i < tiles.size();) {
+      int first = tiles[i], last = first;
+      for (; i < tiles.size() && tiles[i] - last <= mergeGap; i++) last = tiles[i];
+      ranges.push_back({std::size_t(first) * stride, std::size_t(last - first + 1) * stride});
+   }
+}
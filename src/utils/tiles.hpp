@@ -0,0 +1,117 @@
+#pragma once
+
+//////////////////////////////////////////////////////////////////
+// Headers
+//////////////////////////////////////////////////////////////////
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+#include "matrix.hpp"
+#include "planet.hpp"
+
+//////////////////////////////////////////////////////////////////
+/// \brief Hexagon tiles covering the unit sphere (a Goldberg polyhedron),
+/// 12 of them pentagons. Every vertex of the subdivided icosahedron of
+/// planet_sphere is the center of a tile and every triangle a corner, so
+/// tile t is vertex t of the planet mesh of the same level.
+/// Everything is kept as structure of arrays so a pass over one field
+/// only reads that field. The neighbours are in compressed rows (CSR):
+/// the neighbours of tile t are neighbors[offsets[t]] up to
+/// neighbors[offsets[t + 1]], counter clockwise seen from outside, and
+/// corners[offsets[t] + k] is the corner between neighbours k and k + 1.
+/// The tiles of a face of the icosahedron are numbered row by row so the
+/// neighbours of a tile are close to it in memory
+/// \param x, y, z: Tile centers
+/// \param offsets: First neighbour of every tile, one more at the end
+/// \param neighbors: Tile index of every neighbour
+/// \param corners: Corner index between a neighbour and the next one
+/// \param cornerX, cornerY, cornerZ: Corner positions, the middle of a
+/// triangle of the icosphere pushed out onto the sphere
+//////////////////////////////////////////////////////////////////
+struct tileGrid {
+   std::vector<float> x, y, z;
+   std::vector<int> offsets;
+   std::vector<int> neighbors;
+   std::vector<int> corners;
+   std::vector<float> cornerX, cornerY, cornerZ;
+
+   std::size_t size() const { return x.size(); }
+   std::size_t cornerCount() const { return cornerX.size(); }
+   int degree(int tile) const { return offsets[tile + 1] - offsets[tile]; }
+   vec3 center(int tile) const { return vec3(x[tile], y[tile], z[tile]); }
+   vec3 corner(int c) const { return vec3(cornerX[c], cornerY[c], cornerZ[c]); }
+
+   //////////////////////////////////////////////////////////////////
+   /// \brief Tile with the closest center to a direction (does not have
+   /// to be normalized). A table of the cube around the sphere gives a
+   /// tile close by, then it walks to the closest neighbour until none is
+   /// closer, usually a step or two
+   //////////////////////////////////////////////////////////////////
+   int locate(const vec3& direction) const;
+
+   //////////////////////////////////////////////////////////////////
+   /// \brief Same, walking from a tile that is likely close (eg. the last
+   /// result for a moving cursor)
+   //////////////////////////////////////////////////////////////////
+   int locate(const vec3& direction, int start) const;
+
+   // Start tiles of the lookup, lookupSide^2 cells on each of the 6 cube faces
+   int lookupSide = 0;
+   std::vector<int> lookup;
+};
+
+//////////////////////////////////////////////////////////////////
+/// \brief Number of tiles of a level, every level has 4 times as many
+/// (level 9: 2621442 tiles)
+//////////////////////////////////////////////////////////////////
+constexpr std::size_t tiles_count(int level) { return planet_vertexCount(level); }
+
+//////////////////////////////////////////////////////////////////
+/// \brief Builds the tiles, corners, neighbours and the lookup table of a
+/// level on all threads
+/// \param level: Subdivisions of the icosahedron
+//////////////////////////////////////////////////////////////////
+tileGrid tiles_generate(int level);
+
+//////////////////////////////////////////////////////////////////
+/// \brief One vertex of the tile map mesh, the tile it belongs to is
+/// kept with it so a whole map is a single draw that looks the state of
+/// the tile up (see gl_tileMap)
+/// \param x, y, z: Position
+/// \param edge: 0 at the center of the tile and 1 on its border
+/// \param tile: Index of the tile
+//////////////////////////////////////////////////////////////////
+struct tileVertex {
+   float x, y, z;
+   float edge;
+   std::uint32_t tile;
+};
+
+//////////////////////////////////////////////////////////////////
+/// \brief Mesh of every tile as a fan around its center, the center
+/// then the corners of tile t start at vertex t + offsets[t] and its
+/// triangles at index 3 * offsets[t]. Counter clockwise seen from outside
+/// \param radius: Radius of the sphere
+/// \param vertices: Filled with size() + neighbors.size() vertices
+/// \param indices: Filled with 3 vertex indices per triangle
+//////////////////////////////////////////////////////////////////
+void tiles_mesh(const tileGrid& grid, float radius, std::vector<tileVertex>& vertices, std::vector<int>& indices);
+
+//////////////////////////////////////////////////////////////////
+/// \brief Byte range of a buffer with one element per tile
+//////////////////////////////////////////////////////////////////
+struct tileRange {
+   std::size_t offset;
+   std::size_t size;
+};
+
+//////////////////////////////////////////////////////////////////
+/// \brief Ranges to upload for changed tiles (see gl_tileMap::upload).
+/// Runs of tiles at most mergeGap apart become one range, sending a few
+/// unchanged elements costs less than another call
+/// \param tiles: Changed tiles, each once, sorted in place
+/// \param mergeGap: Largest step between two tiles of one range
+/// \param stride: Bytes per tile
+/// \param ranges: Filled with the ranges in order
+//////////////////////////////////////////////////////////////////
+void tiles_ranges(std::vector<int>& tiles, int mergeGap, std::size_t stride, std::vector<tileRange>& ranges);
@@ -0,0 +1,247 @@
+#include "transform.hpp"
+
+#include "parallel.hpp"
+
+
+// Batches smaller than this are not worth starting threads for
+static const std::size_t parallelRange = 1 << 16;
+
+
+// Structure of arrays kernel for the points in [begin, end)
+template <bool project>
+static void transformRange(const mat4x4 &m, const soa3 &in, const soa3 &out, std::size_t begin, std::size_t end) {
+   std::size_t i = begin;
+#if defined(MATH_AVX2)
+   // Every matrix element is broadcast once, then 8 points per iteration
+   __m256 m00 = _mm256_set1_ps(m.m[0][0]), m01 = _mm256_set1_ps(m.m[0][1]), m02 = _mm256_set1_ps(m.m[0][2]), m03 = _mm256_set1_ps(m.m[0][3]);
+   __m256 m10 = _mm256_set1_ps(m.m[1][0]), m11 = _mm256_set1_ps(m.m[1][1]), m12 = _mm256_set1_ps(m.m[1][2]), m13 = _mm256_set1_ps(m.m[1][3]);
+   __m256 m20 = _mm256_set1_ps(m.m[2][0]), m21 = _mm256_set1_ps(m.m[2][1]), m22 = _mm256_set1_ps(m.m[2][2]), m23 = _mm256_set1_ps(m.m[2][3]);
+   __m256 m30 = _mm256_set1_ps(m.m[3][0]), m31 = _mm256_set1_ps(m.m[3][1]), m32 = _mm256_set1_ps(m.m[3][2]), m33 = _mm256_set1_ps(m.m[3][3]);
+   for (; i + 8 <= end; i += 8) {
+      __m256 x = _mm256_loadu_ps(in.x + i);
+      __m256 y = _mm256_loadu_ps(in.y + i);
+      __m256 z = _mm256_loadu_ps(in.z + i);
+      __m256 rx = _mm256_fmadd_ps(x, m00, _mm256_fmadd_ps(y, m10, _mm256_fmadd_ps(z, m20, m30)));
+      __m256 ry = _mm256_fmadd_ps(x, m01, _mm256_fmadd_ps(y, m11, _mm256_fmadd_ps(z, m21, m31)));
+      __m256 rz = _mm256_fmadd_ps(x, m02, _mm256_fmadd_ps(y, m12, _mm256_fmadd_ps(z, m22, m32)));
+      if (project) {
+         __m256 w = _mm256_fmadd_ps(x, m03, _mm256_fmadd_ps(y, m13, _mm256_fmadd_ps(z, m23, m33)));
+         // 1/w where w is not 0 and 1 elsewhere so those points are left as they are
+         __m256 nonZero = _mm256_cmp_ps(w, _mm256_setzero_ps(), _CMP_NEQ_OQ);
+         __m256 invW = _mm256_blendv_ps(_mm256_set1_ps(1.0f), _mm256_div_ps(_mm256_set1_ps(1.0f), w), nonZero);
+         rx = _mm256_mul_ps(rx, invW);
+         ry = _mm256_mul_ps(ry, invW);
+         rz = _mm256_mul_ps(rz, invW);
+      }
+      _mm256_storeu_ps(out.x + i, rx);
+      _mm256_storeu_ps(out.y + i, ry);
+      _mm256_storeu_ps(out.z + i, rz);
+   }
+#elif defined(MATH_SSE)
+   __m128 c0 = _mm_load_ps(m.m[0]), c1 = _mm_load_ps(m.m[1]), c2 = _mm_load_ps(m.m[2]), c3 = _mm_load_ps(m.m[3]);
+   __m128 m00 = _mm_shuffle_ps(c0, c0, 0x00), m01 = _mm_shuffle_ps(c0, c0, 0x55), m02 = _mm_shuffle_ps(c0, c0, 0xAA), m03 = _mm_shuffle_ps(c0, c0, 0xFF);
+   __m128 m10 = _mm_shuffle_ps(c1, c1, 0x00), m11 = _mm_shuffle_ps(c1, c1, 0x55), m12 = _mm_shuffle_ps(c1, c1, 0xAA), m13 = _mm_shuffle_ps(c1, c1, 0xFF);
+   __m128 m20 = _mm_shuffle_ps(c2, c2, 0x00), m21 = _mm_shuffle_ps(c2, c2, 0x55), m22 = _mm_shuffle_ps(c2, c2, 0xAA), m23 = _mm_shuffle_ps(c2, c2, 0xFF);
+   __m128 m30 = _mm_shuffle_ps(c3, c3, 0x00), m31 = _mm_shuffle_ps(c3, c3, 0x55), m32 = _mm_shuffle_ps(c3, c3, 0xAA), m33 = _mm_shuffle_ps(c3, c3, 0xFF);
+   for (; i + 4 <= end; i += 4) {
+      __m128 x = _mm_loadu_ps(in.x + i);
+      __m128 y = _mm_loadu_ps(in.y + i);
+      __m128 z = _mm_loadu_ps(in.z + i);
+      __m128 rx = _mm_add_ps(_mm_add_ps(_mm_mul_ps(x, m00), _mm_mul_ps(y, m10)), _mm_add_ps(_mm_mul_ps(z, m20), m30));
+      __m128 ry = _mm_add_ps(_mm_add_ps(_mm_mul_ps(x, m01), _mm_mul_ps(y, m11)), _mm_add_ps(_mm_mul_ps(z, m21), m31));
+      __m128 rz = _mm_add_ps(_mm_add_ps(_mm_mul_ps(x, m02), _mm_mul_ps(y, m12)), _mm_add_ps(_mm_mul_ps(z, m22), m32));
+      if (project) {
+         __m128 w = _mm_add_ps(_mm_add_ps(_mm_mul_ps(x, m03), _mm_mul_ps(y, m13)), _mm_add_ps(_mm_mul_ps(z, m23), m33));
+         __m128 nonZero = _mm_cmpneq_ps(w, _mm_setzero_ps());
+         __m128 invW = _mm_blendv_ps(_mm_set1_ps(1.0f), _mm_div_ps(_mm_set1_ps(1.0f), w), nonZero);
+         rx = _mm_mul_ps(rx, invW);
+         ry = _mm_mul_ps(ry, invW);
+         rz = _mm_mul_ps(rz, invW);
+      }
+      _mm_storeu_ps(out.x + i, rx);
+      _mm_storeu_ps(out.y + i, ry);
+      _mm_storeu_ps(out.z + i, rz);
+   }
+#endif
+   // Whatever is left over (or everything without SIMD, the compiler can vectorize this itself)
+   for (; i < end; i++) {
+      float x = in.x[i], y = in.y[i], z = in.z[i];
+      float rx = x * m.m[0][0] + y * m.m[1][0] + z * m.m[2][0] + m.m[3][0];
+      float ry = x * m.m[0][1] + y * m.m[1][1] + z * m.m[2][1] + m.m[3][1];
+      float rz = x * m.m[0][2] + y * m.m[1][2] + z * m.m[2][2] + m.m[3][2];
+      if (project) {
+         float w = x * m.m[0][3] + y * m.m[1][3] + z * m.m[2][3] + m.m[3][3];
+         if (w != 0.0f) { rx /= w; ry /= w; rz /= w; }
+      }
+      out.x[i] = rx;
+      out.y[i] = ry;
+      out.z[i] = rz;
+   }
+}
+
+
+// Array of vec4 kernel for the points in [begin, end)
+template <bool project>
+static void transformRange(const mat4x4 &m, const vec4* in, vec4* out, std::size_t begin, std::size_t end) {
+   std::size_t i = begin;
+#if defined(MATH_AVX2)
+   // Same as the matrix multiply: one point per 128 bit lane, the components are broadcast in lane
+   __m256 c0 = _mm256_broadcast_ps((const __m128*)m.m[0]);
+   __m256 c1 = _mm256_broadcast_ps((const __m128*)m.m[1]);
+   __m256 c2 = _mm256_broadcast_ps((const __m128*)m.m[2]);
+   __m256 c3 = _mm256_broadcast_ps((const __m128*)m.m[3]);
+   for (; i + 2 <= end; i += 2) {
+      __m256 p = _mm256_loadu_ps(&in[i].x);
+      __m256 r;
+      if (project) {
+         r = _mm256_mul_ps(_mm256_permute_ps(p, 0xFF), c3);
+         r = _mm256_fmadd_ps(_mm256_permute_ps(p, 0x00), c0, r);
+         r = _mm256_fmadd_ps(_mm256_permute_ps(p, 0x55), c1, r);
+         r = _mm256_fmadd_ps(_mm256_permute_ps(p, 0xAA), c2, r);
+         // Divide x,y,z by w, not w itself and not where w is 0
+         __m256 w = _mm256_permute_ps(r, 0xFF);
+         __m256 divide = _mm256_and_ps(_mm256_cmp_ps(w, _mm256_setzero_ps(), _CMP_NEQ_OQ),
+                                       _mm256_castsi256_ps(_mm256_setr_epi32(-1, -1, -1, 0, -1, -1, -1, 0)));
+         r = _mm256_blendv_ps(r, _mm256_div_ps(r, w), divide);
+      }
+      else {
+         r = _mm256_mul_ps(_mm256_permute_ps(p, 0xFF), c3);
+         r = _mm256_fmadd_ps(_mm256_permute_ps(p, 0x00), c0, r);
+         r = _mm256_fmadd_ps(_mm256_permute_ps(p, 0x55), c1, r);
+         r = _mm256_fmadd_ps(_mm256_permute_ps(p, 0xAA), c2, r);
+         // Keep the w of the input points
+         r = _mm256_blend_ps(r, p, 0x88);
+      }
+      _mm256_storeu_ps(&out[i].x, r);
+   }
+#endif
+   for (; i < end; i++) {
+      vec4 r = in[i] * m;
+      if (project) out[i] = r.w != 0.0f ? vec4(r.x / r.w, r.y / r.w, r.z / r.w, r.w) : r;
+      else out[i] = vec4(r.x, r.y, r.z, in[i].w);
+   }
+}
+
+
+#if defined(MATH_SSE)
+// 4 packed points (x0 y0 z0 x1, y1 z1 x2 y2, z2 x3 y3 z3) to x, y and z registers and back
+static inline void deinterleave(const float* p, __m128 &x, __m128 &y, __m128 &z) {
+   __m128 a = _mm_loadu_ps(p), b = _mm_loadu_ps(p + 4), c = _mm_loadu_ps(p + 8);
+   x = _mm_shuffle_ps(a, _mm_shuffle_ps(b, c, _MM_SHUFFLE(1,1,2,2)), _MM_SHUFFLE(2,0,3,0));
+   y = _mm_shuffle_ps(_mm_shuffle_ps(a, b, _MM_SHUFFLE(0,0,1,1)), _mm_shuffle_ps(b, c, _MM_SHUFFLE(2,2,3,3)), _MM_SHUFFLE(2,0,2,0));
+   z = _mm_shuffle_ps(_mm_shuffle_ps(a, b, _MM_SHUFFLE(1,1,2,2)), c, _MM_SHUFFLE(3,0,2,0));
+}
+
+static inline void interleave(float* p, __m128 x, __m128 y, __m128 z) {
+   _mm_storeu_ps(p, _mm_shuffle_ps(_mm_shuffle_ps(x, y, _MM_SHUFFLE(0,0,0,0)), _mm_shuffle_ps(z, x, _MM_SHUFFLE(1,1,0,0)), _MM_SHUFFLE(2,0,2,0)));
+   _mm_storeu_ps(p + 4, _mm_shuffle_ps(_mm_shuffle_ps(y, z, _MM_SHUFFLE(1,1,1,1)), _mm_shuffle_ps(x, y, _MM_SHUFFLE(2,2,2,2)), _MM_SHUFFLE(2,0,2,0)));
+   _mm_storeu_ps(p + 8, _mm_shuffle_ps(_mm_shuffle_ps(z, x, _MM_SHUFFLE(3,3,2,2)), _mm_shuffle_ps(y, z, _MM_SHUFFLE(3,3,3,3)), _MM_SHUFFLE(2,0,2,0)));
+}
+#endif
+
+
+// Packed vec3 kernel for the points in [begin, end). The points are shuffled into x/y/z registers
+// so the math is the same as the structure of arrays kernel
+template <bool project>
+static void transformRange(const mat4x4 &m, const vec3* in, vec3* out, std::size_t begin, std::size_t end) {
+   std::size_t i = begin;
+#if defined(MATH_AVX2)
+   __m256 m00 = _mm256_set1_ps(m.m[0][0]), m01 = _mm256_set1_ps(m.m[0][1]), m02 = _mm256_set1_ps(m.m[0][2]), m03 = _mm256_set1_ps(m.m[0][3]);
+   __m256 m10 = _mm256_set1_ps(m.m[1][0]), m11 = _mm256_set1_ps(m.m[1][1]), m12 = _mm256_set1_ps(m.m[1][2]), m13 = _mm256_set1_ps(m.m[1][3]);
+   __m256 m20 = _mm256_set1_ps(m.m[2][0]), m21 = _mm256_set1_ps(m.m[2][1]), m22 = _mm256_set1_ps(m.m[2][2]), m23 = _mm256_set1_ps(m.m[2][3]);
+   __m256 m30 = _mm256_set1_ps(m.m[3][0]), m31 = _mm256_set1_ps(m.m[3][1]), m32 = _mm256_set1_ps(m.m[3][2]), m33 = _mm256_set1_ps(m.m[3][3]);
+   for (; i + 8 <= end; i += 8) {
+      // Two groups of 4 points, one per 128 bit lane
+      __m128 x0, y0, z0, x1, y1, z1;
+      deinterleave(&in[i].x, x0, y0, z0);
+      deinterleave(&in[i + 4].x, x1, y1, z1);
+      __m256 x = _mm256_set_m128(x1, x0), y = _mm256_set_m128(y1, y0), z = _mm256_set_m128(z1, z0);
+      __m256 rx = _mm256_fmadd_ps(x, m00, _mm256_fmadd_ps(y, m10, _mm256_fmadd_ps(z, m20, m30)));
+      __m256 ry = _mm256_fmadd_ps(x, m01, _mm256_fmadd_ps(y, m11, _mm256_fmadd_ps(z, m21, m31)));
+      __m256 rz = _mm256_fmadd_ps(x, m02, _mm256_fmadd_ps(y, m12, _mm256_fmadd_ps(z, m22, m32)));
+      if (project) {
+         __m256 w = _mm256_fmadd_ps(x, m03, _mm256_fmadd_ps(y, m13, _mm256_fmadd_ps(z, m23, m33)));
+         __m256 nonZero = _mm256_cmp_ps(w, _mm256_setzero_ps(), _CMP_NEQ_OQ);
+         __m256 invW = _mm256_blendv_ps(_mm256_set1_ps(1.0f), _mm256_div_ps(_mm256_set1_ps(1.0f), w), nonZero);
+         rx = _mm256_mul_ps(rx, invW);
+         ry = _mm256_mul_ps(ry, invW);
+         rz = _mm256_mul_ps(rz, invW);
+      }
+      interleave(&out[i].x, _mm256_castps256_ps128(rx), _mm256_castps256_ps128(ry), _mm256_castps256_ps128(rz));
+      interleave(&out[i + 4].x, _mm256_extractf128_ps(rx, 1), _mm256_extractf128_ps(ry, 1), _mm256_extractf128_ps(rz, 1));
+   }
+#elif defined(MATH_SSE)
+   __m128 c0 = _mm_load_ps(m.m[0]), c1 = _mm_load_ps(m.m[1]), c2 = _mm_load_ps(m.m[2]), c3 = _mm_load_ps(m.m[3]);
+   __m128 m00 = _mm_shuffle_ps(c0, c0, 0x00), m01 = _mm_shuffle_ps(c0, c0, 0x55), m02 = _mm_shuffle_ps(c0, c0, 0xAA), m03 = _mm_shuffle_ps(c0, c0, 0xFF);
+   __m128 m10 = _mm_shuffle_ps(c1, c1, 0x00), m11 = _mm_shuffle_ps(c1, c1, 0x55), m12 = _mm_shuffle_ps(c1, c1, 0xAA), m13 = _mm_shuffle_ps(c1, c1, 0xFF);
+   __m128 m20 = _mm_shuffle_ps(c2, c2, 0x00), m21 = _mm_shuffle_ps(c2, c2, 0x55), m22 = _mm_shuffle_ps(c2, c2, 0xAA), m23 = _mm_shuffle_ps(c2, c2, 0xFF);
+   __m128 m30 = _mm_shuffle_ps(c3, c3, 0x00), m31 = _mm_shuffle_ps(c3, c3, 0x55), m32 = _mm_shuffle_ps(c3, c3, 0xAA), m33 = _mm_shuffle_ps(c3, c3, 0xFF);
+   for (; i + 4 <= end; i += 4) {
+      __m128 x, y, z;
+      deinterleave(&in[i].x, x, y, z);
+      __m128 rx = _mm_add_ps(_mm_add_ps(_mm_mul_ps(x, m00), _mm_mul_ps(y, m10)), _mm_add_ps(_mm_mul_ps(z, m20), m30));
+      __m128 ry = _mm_add_ps(_mm_add_ps(_mm_mul_ps(x, m01), _mm_mul_ps(y, m11)), _mm_add_ps(_mm_mul_ps(z, m21), m31));
+      __m128 rz = _mm_add_ps(_mm_add_ps(_mm_mul_ps(x, m02), _mm_mul_ps(y, m12)), _mm_add_ps(_mm_mul_ps(z, m22), m32));
+      if (project) {
+         __m128 w = _mm_add_ps(_mm_add_ps(_mm_mul_ps(x, m03), _mm_mul_ps(y, m13)), _mm_add_ps(_mm_mul_ps(z, m23), m33));
+         __m128 nonZero = _mm_cmpneq_ps(w, _mm_setzero_ps());
+         __m128 invW = _mm_blendv_ps(_mm_set1_ps(1.0f), _mm_div_ps(_mm_set1_ps(1.0f), w), nonZero);
+         rx = _mm_mul_ps(rx, invW);
+         ry = _mm_mul_ps(ry, invW);
+         rz = _mm_mul_ps(rz, invW);
+      }
+      interleave(&out[i].x, rx, ry, rz);
+   }
+#endif
+   for (; i < end; i++) {
+      if (project) out[i] = in[i] * m;
+      else {
+         vec3 p = in[i];
+         out[i] = vec3(p.x * m.m[0][0] + p.y * m.m[1][0] + p.z * m.m[2][0] + m.m[3][0],
+                       p.x * m.m[0][1] + p.y * m.m[1][1] + p.z * m.m[2][1] + m.m[3][1],
+                       p.x * m.m[0][2] + p.y * m.m[1][2] + p.z * m.m[2][2] + m.m[3][2]);
+      }
+   }
+}
+
+
+void transform_affine(const mat4x4 &m, const soa3 &in, const soa3 &out, bool parallel) {
+   auto range = [&](std::size_t begin, std::size_t end) { transformRange<false>(m, in, out, begin, end); };
+   if (parallel) parallel_for(in.count, parallelRange, range);
+   else range(0, in.count);
+}
+
+
+void transform_project(const mat4x4 &m, const soa3 &in, const soa3 &out, bool parallel) {
+   auto range = [&](std::size_t begin, std::size_t end) { transformRange<true>(m, in, out, begin, end); };
+   if (parallel) parallel_for(in.count, parallelRange, range);
+   else range(0, in.count);
+}
+
+
+void transform_affine(const mat4x4 &m, const vec4* in, vec4* out, std::size_t count, bool parallel) {
+   auto range = [&](std::size_t begin, std::size_t end) { transformRange<false>(m, in, out, begin, end); };
+   if (parallel) parallel_for(count, parallelRange, range);
+   else range(0, count);
+}
+
+
+void transform_project(const mat4x4 &m, const vec4* in, vec4* out, std::size_t count, bool parallel) {
+   auto range = [&](std::size_t begin, std::size_t end) { transformRange<true>(m, in, out, begin, end); };
+   if (parallel) parallel_for(count, parallelRange, range);
+   else range(0, count);
+}
+
+
+void transform_affine(const mat4x4 &m, const vec3* in, vec3* out, std::size_t count, bool parallel) {
+   auto range = [&](std::size_t begin, std::size_t end) { transformRange<false>(m, in, out, begin, end); };
+   if (parallel) parallel_for(count, parallelRange, range);
+   else range(0, count);
+}
+
+
+void transform_project(const mat4x4 &m, const vec3* in, vec3* out, std::size_t count, bool parallel) {
+   auto range = [&](std::size_t begin, std::size_t end) { transformRange<true>(m, in, out, begin, end); };
+   if (parallel) parallel_for(count, parallelRange, range);
+   else range(0, count);
+}
@@ -0,0 +1,71 @@
+#pragma once
+
+#include <cstddef>
+#include "matrix.hpp"
+
+
+//XXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXX
+// Batch transforms of many points through one matrix
+//XXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXX
+// The structure of arrays versions take separate x/y/z arrays and transform 8 points per AVX2
+// instruction (4 with SSE). The arrays of vec4 versions do 2 points per AVX2 register and the
+// packed vec3 arrays (12 bytes per point) are shuffled into x/y/z registers, 8 points at a time.
+// Affine versions assume the matrix has no projection (last row 0,0,0,1) and never divide,
+// project versions divide by w like vec3 * mat4x4. Input and output may be the same arrays.
+// With parallel set, large batches are split over all cores (see parallel_for).
+
+/// @brief: Structure of arrays view of points, x/y/z each point to count floats
+struct soa3 {
+   float* x;
+   float* y;
+   float* z;
+   std::size_t count;
+};
+
+/// @brief: Transforms points by an affine matrix (no divide)
+/// @param m: Matrix without projection
+/// @param in: Points to transform
+/// @param out: Result, must hold in.count points
+/// @param parallel: Split the work over all cores (Default: false)
+///
+void transform_affine(const mat4x4 &m, const soa3 &in, const soa3 &out, bool parallel = false);
+
+/// @brief: Transforms points by any matrix and divides by the resulting w (skipped where w is 0)
+/// @param m: Matrix, eg. a view projection
+/// @param in: Points to transform
+/// @param out: Result, must hold in.count points
+/// @param parallel: Split the work over all cores (Default: false)
+///
+void transform_project(const mat4x4 &m, const soa3 &in, const soa3 &out, bool parallel = false);
+
+/// @brief: Array of vec4 version of transform_affine, same result as out[i] = in[i] * m for a mat3x4
+/// (the translation is scaled by w and w is kept)
+///
+void transform_affine(const mat4x4 &m, const vec4* in, vec4* out, std::size_t count, bool parallel = false);
+
+/// @brief: Packed array of vec3 version of transform_affine, same result as out[i] = in[i] * m for a mat3x4
+///
+void transform_affine(const mat4x4 &m, const vec3* in, vec3* out, std::size_t count, bool parallel = false);
+
+/// @brief: transform_affine taking the affine matrix type directly
+///
+inline void transform_affine(const mat3x4 &m, const soa3 &in, const soa3 &out, bool parallel = false) {
+   transform_affine(m.toMat4(), in, out, parallel);
+}
+
+inline void transform_affine(const mat3x4 &m, const vec4* in, vec4* out, std::size_t count, bool parallel = false) {
+   transform_affine(m.toMat4(), in, out, count, parallel);
+}
+
+inline void transform_affine(const mat3x4 &m, const vec3* in, vec3* out, std::size_t count, bool parallel = false) {
+   transform_affine(m.toMat4(), in, out, count, parallel);
+}
+
+/// @brief: Array of vec4 version of transform_project, same as (in[i] * m) with x, y and z divided by
+/// w, the clip space w is kept
+///
+void transform_project(const mat4x4 &m, const vec4* in, vec4* out, std::size_t count, bool parallel = false);
+
+/// @brief: Packed array of vec3 version of transform_project, same result as out[i] = in[i] * m
+///
+void transform_project(const mat4x4 &m, const vec3* in, vec3* out, std::size_t count, bool parallel = false);
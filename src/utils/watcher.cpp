@@ -0,0 +1,49 @@
+//////////////////////////////////////////////////////////////////
+// Headers
+//////////////////////////////////////////////////////////////////
+#include "watcher.hpp"
+
+#include <algorithm>
+#include <iostream>
+#include <sys/inotify.h>
+#include <unistd.h>
+
+
+fileWatcher::fileWatcher(std::string _directory, std::string _extension) : directory(_directory), extension(_extension) {
+
+   fd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+   if (fd == -1) {
+      std::cerr << "Could not start file watcher for: " << directory << std::endl;
+      return;
+   }
+   wd = inotify_add_watch(fd, directory.c_str(), IN_CLOSE_WRITE | IN_MOVED_TO | IN_CREATE);
+   if (wd == -1) std::cerr << "Could not watch directory: " << directory << std::endl;
+}
+//////////////////////////////////////////////////////////////////
+fileWatcher::~fileWatcher() {
+
+   if (fd != -1) close(fd);
+}
+//////////////////////////////////////////////////////////////////
+std::vector<std::string> fileWatcher::poll() {
+
+   std::vector<std::string> changed;
+   if (wd == -1) return changed;
+
+   // Events are variable length so they are read into a buffer aligned for inotify_event
+   alignas(inotify_event) char buffer[4096];
+   ssize_t length;
+   while ((length = read(fd, buffer, sizeof(buffer))) > 0) {
+      for (char* p = buffer; p < buffer + length; p += sizeof(inotify_event) + ((inotify_event*)p)->len) {
+         inotify_event* event = (inotify_event*)p;
+         if (event->len == 0) continue;
+
+         std::string name(event->name);
+         if (name.size() < extension.size() || name.compare(name.size() - extension.size(), extension.size(), extension) != 0) continue;
+
+         std::string path = directory + "/" + name;
+         if (std::find(changed.begin(), changed.end(), path) == changed.end()) changed.push_back(path);
+      }
+   }
+   return changed;
+}
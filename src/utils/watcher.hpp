@@ -0,0 +1,39 @@
+#pragma once
+
+//////////////////////////////////////////////////////////////////
+// Headers
+//////////////////////////////////////////////////////////////////
+#include <string>
+#include <vector>
+
+//////////////////////////////////////////////////////////////////
+/// \brief Watches a directory with inotify and reports files that were
+/// written. Editors often save by writing a temp file and renaming it over
+/// the original so renames into the directory count as changes too.
+/// Nothing ever blocks, poll just returns an empty list when nothing changed
+//////////////////////////////////////////////////////////////////
+class fileWatcher {
+
+public:
+
+   /// \param directory: Directory to watch (not recursive)
+   /// \param extension: Only report files ending with this (Default: all files)
+   fileWatcher(std::string directory, std::string extension = "");
+   ~fileWatcher();
+
+   fileWatcher(const fileWatcher&) = delete;
+   fileWatcher& operator=(const fileWatcher&) = delete;
+
+   //////////////////////////////////////////////////////////////////
+   /// \brief Returns the paths (directory + "/" + name) of every file changed since the
+   /// last call, each file only once even if the editor wrote it several times
+   //////////////////////////////////////////////////////////////////
+   std::vector<std::string> poll();
+
+private:
+
+   std::string directory;
+   std::string extension;
+   int fd = -1;
+   int wd = -1;
+};